@@ -36,6 +36,12 @@ SRCS := \
 	../pm_shared/pm_shared.cpp \
 	./studio/GameStudioModelRenderer.cpp \
 	./studio/StudioModelRenderer.cpp \
+	./studio/StudioPoseCache.cpp \
+	./studio/StudioBoneCache.cpp \
+	./studio/StudioModelInfo.cpp \
+	./studio/StudioPose.cpp \
+	./studio/StudioPosePrepass.cpp \
+	./studio/StudioAnimLOD.cpp \
 	./studio/studio_util.cpp \
 	./hud/ammo.cpp \
 	./hud/ammo_secondary.cpp \
@@ -69,6 +75,7 @@ SRCS := \
 	./com_weapons.cpp \
 	./cs_wpn/cs_baseentity.cpp \
 	./cs_wpn/cs_weapons.cpp \
+	./cs_wpn/pred_stats.cpp \
 	../dlls/wpn_shared/wpn_ak47.cpp \
 	../dlls/wpn_shared/wpn_aug.cpp \
 	../dlls/wpn_shared/wpn_awp.cpp \
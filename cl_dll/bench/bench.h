@@ -0,0 +1,129 @@
+/*
+bench.h - shared helpers for the headless client benchmarks
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+In addition, as a special exception, the author gives permission to
+link the code of this program with the Half-Life Game Engine ("HL
+Engine") and Modified Game Libraries ("MODs") developed by Valve,
+L.L.C ("Valve").  You must obey the GNU General Public License in all
+respects for all of the code used other than the HL Engine and MODs
+from Valve.  If you modify this file, you may extend this exception
+to your version of the file, but you are not obligated to do so.  If
+you do not wish to do so, delete this exception statement from your
+version.
+*/
+
+#pragma once
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cvardef.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// engine side of the cvar system, just enough for the client code to register its variables
+#define BENCH_MAX_CVARS	128
+
+static cvar_t g_BenchCvars[BENCH_MAX_CVARS];
+static int g_iBenchCvars;
+
+inline cvar_t *Bench_GetCvarPointer( const char *name )
+{
+	for( int i = 0; i < g_iBenchCvars; i++ )
+	{
+		if( !strcmp( g_BenchCvars[i].name, name ))
+			return &g_BenchCvars[i];
+	}
+
+	return NULL;
+}
+
+inline cvar_t *Bench_RegisterVariable( const char *name, const char *value, int flags )
+{
+	cvar_t *cv = Bench_GetCvarPointer( name );
+
+	if( cv )
+		return cv;
+
+	if( g_iBenchCvars >= BENCH_MAX_CVARS )
+	{
+		fprintf( stderr, "too many cvars\n" );
+		exit( 1 );
+	}
+
+	cv = &g_BenchCvars[g_iBenchCvars++];
+	cv->name = strdup( name );
+	cv->string = strdup( value );
+	cv->flags = flags;
+	cv->value = atof( value );
+
+	return cv;
+}
+
+inline void Bench_SetCvar( const char *name, float value )
+{
+	cvar_t *cv = Bench_GetCvarPointer( name );
+
+	if( cv )
+		cv->value = value;
+}
+
+inline void Bench_Con_Printf( const char *fmt, ... )
+{
+}
+
+inline void Bench_Con_NPrintf( int pos, char *fmt, ... )
+{
+}
+
+inline double Bench_Time( void )
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+
+	QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &count );
+
+	return (double)count.QuadPart / freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// runs func until at least 'iterations' calls and 0.2 seconds passed, prints nanoseconds per call
+#define BENCH_RUN( label, iterations, code ) \
+	do { \
+		long _count = 0; \
+		double _start = Bench_Time(), _elapsed; \
+		do { \
+			for( long _i = 0; _i < (iterations); _i++ ) { code; } \
+			_count += (iterations); \
+			_elapsed = Bench_Time() - _start; \
+		} while( _elapsed < 0.2 ); \
+		printf( "%-44s %12.1f ns/op\n", label, _elapsed * 1e9 / _count ); \
+	} while( 0 )
+
+#endif // BENCH_H
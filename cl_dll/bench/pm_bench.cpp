@@ -0,0 +1,823 @@
+/*
+pm_bench.cpp - offline player movement replay and throughput benchmark
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+In addition, as a special exception, the author gives permission to
+link the code of this program with the Half-Life Game Engine ("HL
+Engine") and Modified Game Libraries ("MODs") developed by Valve,
+L.L.C ("Valve").  You must obey the GNU General Public License in all
+respects for all of the code used other than the HL Engine and MODs
+from Valve.  If you modify this file, you may extend this exception
+to your version of the file, but you are not obligated to do so.  If
+you do not wish to do so, delete this exception statement from your
+version.
+*/
+
+// Runs pm_shared PM_Move against a box world instead of a BSP:
+//
+//   pm_bench -record <log>   drive a scripted player around the world and save
+//                            every usercmd with the resulting player state
+//   pm_bench -verify <log>   replay the usercmds from a log and compare states
+//   pm_bench [-verify <log>] [-moves <n>]
+//                            report PM_Move throughput, on the logged commands
+//                            when given, otherwise on a freshly scripted run
+//
+// bench/pm_golden.log is the reference run, re-record it only when a change
+// to movement behaviour is intended. Positions are compared with a small
+// tolerance, 32-bit x87 builds don't round the same way as SSE ones.
+
+#include <assert.h>
+#include <math.h>
+#include "mathlib.h"
+#include "const.h"
+#include "usercmd.h"
+#include "in_buttons.h"
+#include "pm_defs.h"
+#include "pm_shared.h"
+#include "pm_movevars.h"
+#include "com_model.h"
+
+#include "bench.h"
+
+#define PMB_MAX_CMDS		65536
+#define PMB_DEFAULT_CMDS	8192
+#define PMB_DIST_EPSILON	0.03125f
+#define PMB_ORIGIN_EPSILON	0.1f
+#define PMB_VELOCITY_EPSILON	1.0f
+
+typedef struct
+{
+	vec3_t mins, maxs;
+	int contents;
+	const char *texture;
+} pmb_box_t;
+
+typedef struct
+{
+	vec3_t origin;
+	vec3_t velocity;
+	int flags;
+	int onground;
+	int waterlevel;
+	int usehull;
+} pmb_state_t;
+
+// a 2048 unit arena: floor with a flooded pit, stairs, a crate, a low ceiling to crouch under
+static const pmb_box_t g_World[] =
+{
+	{ { -1024, -1024,  -64 }, {  256,  1024,    0 }, CONTENTS_SOLID, "CONCRETE1" },
+	{ {   512, -1024,  -64 }, { 1024,  1024,    0 }, CONTENTS_SOLID, "CONCRETE1" },
+	{ {   256, -1024,  -64 }, {  512,  -256,    0 }, CONTENTS_SOLID, "GRATE1" },
+	{ {   256,   256,  -64 }, {  512,  1024,    0 }, CONTENTS_SOLID, "GRATE1" },
+	{ {   256,  -256, -192 }, {  512,   256, -128 }, CONTENTS_SOLID, "DIRT1" },
+	{ {   240,  -256, -128 }, {  256,   256,    0 }, CONTENTS_SOLID, "DIRT1" },
+	{ {   512,  -256, -128 }, {  528,   256,    0 }, CONTENTS_SOLID, "DIRT1" },
+	{ {   256,  -272, -128 }, {  512,  -256,    0 }, CONTENTS_SOLID, "DIRT1" },
+	{ {   256,   256, -128 }, {  512,   272,    0 }, CONTENTS_SOLID, "DIRT1" },
+	{ { -1040, -1040,    0 }, { -1024,  1040,  256 }, CONTENTS_SOLID, "WALL1" },
+	{ {  1024, -1040,    0 }, {  1040,  1040,  256 }, CONTENTS_SOLID, "WALL1" },
+	{ { -1024, -1040,    0 }, {  1024, -1024,  256 }, CONTENTS_SOLID, "WALL1" },
+	{ { -1024,  1024,    0 }, {  1024,  1040,  256 }, CONTENTS_SOLID, "WALL1" },
+	{ {  -512,  -128,    0 }, { -448,   128,   48 }, CONTENTS_SOLID, "METAL1" },
+	{ {  -448,  -128,    0 }, { -384,   128,   32 }, CONTENTS_SOLID, "METAL1" },
+	{ {  -384,  -128,    0 }, { -320,   128,   16 }, CONTENTS_SOLID, "METAL1" },
+	{ {     0,   300,    0 }, {   64,   364,   64 }, CONTENTS_SOLID, "WOOD1" },
+	{ {  -200,  -600,   60 }, {    0,  -400,   90 }, CONTENTS_SOLID, "METAL2" },
+	{ {   256,  -256, -128 }, {  512,   256,  -16 }, CONTENTS_WATER, NULL },
+};
+
+#define PMB_WORLD_BOXES	( sizeof( g_World ) / sizeof( g_World[0] ))
+
+// waypoints the recorder steers through, some of them sit behind obstacles
+#define PMB_WAYPOINT_TIMEOUT	500
+static const float g_Route[][2] =
+{
+	{ -600, 0 }, { -600, 300 }, { -100, 332 }, { -100, -500 }, { 384, -600 }, { 384, 0 }, { 700, 0 }, { 900, 900 }, { -900, -900 }, { 0, 0 },
+};
+
+#define PMB_ROUTE_POINTS	( sizeof( g_Route ) / sizeof( g_Route[0] ))
+
+static playermove_t g_PlayerMove;
+static movevars_t g_MoveVars;
+static pmtrace_t g_TraceLineResult;
+
+static usercmd_t g_Cmds[PMB_MAX_CMDS];
+static pmb_state_t g_States[PMB_MAX_CMDS];
+static int g_iCmds;
+
+static unsigned int g_iRandomSeed;
+static double g_flSysTime;
+
+/*
+====================
+box world traces
+====================
+*/
+static void PMB_TraceBox( const pmb_box_t *box, const float *start, const float *end, const float *mins, const float *maxs, pmtrace_t *tr )
+{
+	float enterfrac = -1.0f, leavefrac = 1.0f;
+	int enterplane = -1;
+	bool getout = false, startout = false;
+	int i;
+
+	// planes of the box grown by the hull, the first three face negative axes
+	for( i = 0; i < 6; i++ )
+	{
+		int axis = i % 3;
+		float normal = ( i < 3 ) ? -1.0f : 1.0f;
+		float dist = ( i < 3 ) ? -( box->mins[axis] - maxs[axis] ) : box->maxs[axis] - mins[axis];
+		float d1 = start[axis] * normal - dist;
+		float d2 = end[axis] * normal - dist;
+
+		if( d2 > 0 )
+			getout = true;
+
+		if( d1 > 0 )
+			startout = true;
+
+		// completely in front of the face, no intersection
+		if( d1 > 0 && d2 >= d1 )
+			return;
+
+		if( d1 <= 0 && d2 <= 0 )
+			continue;
+
+		if( d1 > d2 )
+		{
+			float f = ( d1 - PMB_DIST_EPSILON ) / ( d1 - d2 );
+
+			if( f > enterfrac )
+			{
+				enterfrac = f;
+				enterplane = i;
+			}
+		}
+		else
+		{
+			float f = ( d1 + PMB_DIST_EPSILON ) / ( d1 - d2 );
+
+			if( f < leavefrac )
+				leavefrac = f;
+		}
+	}
+
+	if( !startout )
+	{
+		tr->startsolid = true;
+
+		if( !getout )
+		{
+			tr->allsolid = true;
+			tr->fraction = 0.0f;
+		}
+		return;
+	}
+
+	if( enterfrac < leavefrac && enterfrac > -1.0f && enterfrac < tr->fraction )
+	{
+		int axis = enterplane % 3;
+
+		tr->fraction = enterfrac < 0.0f ? 0.0f : enterfrac;
+		VectorClear( tr->plane.normal );
+		tr->plane.normal[axis] = ( enterplane < 3 ) ? -1.0f : 1.0f;
+		tr->plane.dist = ( enterplane < 3 ) ? -( box->mins[axis] - maxs[axis] ) : box->maxs[axis] - mins[axis];
+		tr->ent = 0;
+	}
+}
+
+static int PMB_PointContents( float *p, int *truecontents )
+{
+	int contents = CONTENTS_EMPTY;
+
+	for( size_t i = 0; i < PMB_WORLD_BOXES; i++ )
+	{
+		const pmb_box_t *box = &g_World[i];
+
+		if( p[0] <= box->mins[0] || p[1] <= box->mins[1] || p[2] <= box->mins[2] )
+			continue;
+
+		if( p[0] >= box->maxs[0] || p[1] >= box->maxs[1] || p[2] >= box->maxs[2] )
+			continue;
+
+		if( box->contents == CONTENTS_SOLID )
+		{
+			contents = CONTENTS_SOLID;
+			break;
+		}
+
+		contents = box->contents;
+	}
+
+	if( truecontents )
+		*truecontents = contents;
+
+	return contents;
+}
+
+static int PMB_TruePointContents( float *p )
+{
+	return PMB_PointContents( p, NULL );
+}
+
+static pmtrace_t PMB_Trace( float *start, float *end, const float *mins, const float *maxs )
+{
+	pmtrace_t tr;
+
+	memset( &tr, 0, sizeof( tr ));
+	tr.fraction = 1.0f;
+	tr.ent = -1;
+
+	for( size_t i = 0; i < PMB_WORLD_BOXES; i++ )
+	{
+		if( g_World[i].contents != CONTENTS_SOLID )
+			continue;
+
+		PMB_TraceBox( &g_World[i], start, end, mins, maxs, &tr );
+
+		if( tr.allsolid )
+			break;
+	}
+
+	if( tr.startsolid )
+		tr.ent = 0;
+
+	for( int i = 0; i < 3; i++ )
+		tr.endpos[i] = start[i] + tr.fraction * ( end[i] - start[i] );
+
+	tr.inwater = PMB_PointContents( tr.endpos, NULL ) == CONTENTS_WATER;
+	tr.inopen = !tr.inwater;
+
+	return tr;
+}
+
+static pmtrace_t PMB_PlayerTrace( float *start, float *end, int traceFlags, int ignore_pe )
+{
+	return PMB_Trace( start, end, g_PlayerMove._player_mins[g_PlayerMove.usehull], g_PlayerMove._player_maxs[g_PlayerMove.usehull] );
+}
+
+static struct pmtrace_s *PMB_TraceLine( float *start, float *end, int flags, int usehull, int ignore_pe )
+{
+	g_TraceLineResult = PMB_Trace( start, end, g_PlayerMove._player_mins[usehull], g_PlayerMove._player_maxs[usehull] );
+
+	return &g_TraceLineResult;
+}
+
+static int PMB_TestPlayerPosition( float *pos, pmtrace_t *ptrace )
+{
+	pmtrace_t tr = PMB_Trace( pos, pos, g_PlayerMove._player_mins[g_PlayerMove.usehull], g_PlayerMove._player_maxs[g_PlayerMove.usehull] );
+
+	if( ptrace )
+		*ptrace = tr;
+
+	return tr.startsolid ? 0 : -1;
+}
+
+static const char *PMB_TraceTexture( int ground, float *vstart, float *vend )
+{
+	static const vec3_t zero = { 0, 0, 0 };
+	const char *texture = NULL;
+	float fraction = 1.0f;
+
+	for( size_t i = 0; i < PMB_WORLD_BOXES; i++ )
+	{
+		pmtrace_t tr;
+
+		if( g_World[i].contents != CONTENTS_SOLID )
+			continue;
+
+		memset( &tr, 0, sizeof( tr ));
+		tr.fraction = 1.0f;
+		PMB_TraceBox( &g_World[i], vstart, vend, zero, zero, &tr );
+
+		if( tr.fraction < fraction )
+		{
+			fraction = tr.fraction;
+			texture = g_World[i].texture;
+		}
+	}
+
+	return texture;
+}
+
+/*
+====================
+engine stubs
+====================
+*/
+static const char *PMB_Info_ValueForKey( const char *s, const char *key )
+{
+	static char value[MAX_PHYSINFO_STRING];
+	size_t keylen = strlen( key );
+
+	while( *s == '\\' )
+	{
+		const char *k = s + 1;
+		const char *v = strchr( k, '\\' );
+		const char *next;
+
+		if( !v )
+			break;
+
+		next = strchr( v + 1, '\\' );
+
+		if( (size_t)( v - k ) == keylen && !strncmp( k, key, keylen ))
+		{
+			size_t len = next ? (size_t)( next - v - 1 ) : strlen( v + 1 );
+
+			len = len < sizeof( value ) - 1 ? len : sizeof( value ) - 1;
+			memcpy( value, v + 1, len );
+			value[len] = '\0';
+			return value;
+		}
+
+		if( !next )
+			break;
+
+		s = next;
+	}
+
+	return "";
+}
+
+static void PMB_Particle( float *origin, int color, float life, int zpos, int zvel )
+{
+}
+
+static void PMB_Con_NPrintf( int idx, const char *fmt, ... )
+{
+}
+
+static double PMB_Sys_FloatTime( void )
+{
+	return g_flSysTime;
+}
+
+static void PMB_StuckTouch( int hitent, pmtrace_t *ptraceresult )
+{
+}
+
+static int PMB_RandomLong( int lLow, int lHigh )
+{
+	g_iRandomSeed = g_iRandomSeed * 1103515245u + 12345u;
+
+	return lLow + (int)(( g_iRandomSeed >> 16 ) % (unsigned int)( lHigh - lLow + 1 ));
+}
+
+static float PMB_RandomFloat( float flLow, float flHigh )
+{
+	return flLow + ( flHigh - flLow ) * ( PMB_RandomLong( 0, 0x7fff ) / 32767.0f );
+}
+
+static int PMB_GetModelType( struct model_s *mod )
+{
+	return mod_brush;
+}
+
+static int PMB_COM_FileSize( char *filename )
+{
+	return -1;
+}
+
+static byte *PMB_COM_LoadFile( char *path, int usehunk, int *pLength )
+{
+	return NULL;
+}
+
+static void PMB_COM_FreeFile( void *buffer )
+{
+}
+
+static void PMB_PlaySound( int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch )
+{
+}
+
+static void PMB_PlaybackEventFull( int flags, int clientindex, unsigned short eventindex, float delay, float *origin, float *angles, float fparam1, float fparam2, int iparam1, int iparam2, int bparam1, int bparam2 )
+{
+}
+
+static void PMB_Init( void )
+{
+	playermove_t *pm = &g_PlayerMove;
+	static const float hullmins[4][3] = { { -16, -16, -36 }, { -16, -16, -18 }, { 0, 0, 0 }, { -32, -32, -32 } };
+	static const float hullmaxs[4][3] = { {  16,  16,  36 }, {  16,  16,  18 }, { 0, 0, 0 }, {  32,  32,  32 } };
+
+	g_MoveVars.gravity = 800.0f;
+	g_MoveVars.stopspeed = 75.0f;
+	g_MoveVars.maxspeed = 320.0f;
+	g_MoveVars.spectatormaxspeed = 500.0f;
+	g_MoveVars.accelerate = 5.0f;
+	g_MoveVars.airaccelerate = 10.0f;
+	g_MoveVars.wateraccelerate = 10.0f;
+	g_MoveVars.friction = 4.0f;
+	g_MoveVars.edgefriction = 2.0f;
+	g_MoveVars.waterfriction = 1.0f;
+	g_MoveVars.entgravity = 1.0f;
+	g_MoveVars.bounce = 1.0f;
+	g_MoveVars.stepsize = 18.0f;
+	g_MoveVars.maxvelocity = 2000.0f;
+	g_MoveVars.footsteps = 1;
+	g_MoveVars.rollangle = 0.0f;
+	g_MoveVars.rollspeed = 0.0f;
+
+	memset( pm, 0, sizeof( *pm ));
+	pm->movevars = &g_MoveVars;
+	memcpy( pm->_player_mins, hullmins, sizeof( hullmins ));
+	memcpy( pm->_player_maxs, hullmaxs, sizeof( hullmaxs ));
+
+	pm->PM_Info_ValueForKey = PMB_Info_ValueForKey;
+	pm->PM_Particle = PMB_Particle;
+	pm->PM_TestPlayerPosition = PMB_TestPlayerPosition;
+	pm->Con_NPrintf = PMB_Con_NPrintf;
+	pm->Con_DPrintf = Bench_Con_Printf;
+	pm->Con_Printf = Bench_Con_Printf;
+	pm->Sys_FloatTime = PMB_Sys_FloatTime;
+	pm->PM_StuckTouch = PMB_StuckTouch;
+	pm->PM_PointContents = PMB_PointContents;
+	pm->PM_TruePointContents = PMB_TruePointContents;
+	pm->PM_PlayerTrace = PMB_PlayerTrace;
+	pm->PM_TraceLine = PMB_TraceLine;
+	pm->RandomLong = PMB_RandomLong;
+	pm->RandomFloat = PMB_RandomFloat;
+	pm->PM_GetModelType = PMB_GetModelType;
+	pm->COM_FileSize = PMB_COM_FileSize;
+	pm->COM_LoadFile = PMB_COM_LoadFile;
+	pm->COM_FreeFile = PMB_COM_FreeFile;
+	pm->PM_PlaySound = PMB_PlaySound;
+	pm->PM_TraceTexture = PMB_TraceTexture;
+	pm->PM_PlaybackEventFull = PMB_PlaybackEventFull;
+
+	PM_Init( pm );
+}
+
+/*
+====================
+PMB_Reset
+
+Puts a fresh player at the start of the route, as after a respawn.
+====================
+*/
+static void PMB_Reset( void )
+{
+	playermove_t *pm = &g_PlayerMove;
+
+	pm->player_index = 0;
+	pm->multiplayer = true;
+	pm->runfuncs = true;
+	pm->time = 0.0f;
+	pm->physinfo[0] = '\0';
+
+	VectorClear( pm->velocity );
+	VectorClear( pm->basevelocity );
+	VectorClear( pm->punchangle );
+	VectorClear( pm->angles );
+	VectorClear( pm->oldangles );
+	VectorClear( pm->origin );
+	VectorClear( pm->view_ofs );
+	pm->origin[2] = 36.0f + 1.0f;
+	pm->view_ofs[2] = 17.0f;
+
+	pm->flDuckTime = 0.0f;
+	pm->bInDuck = false;
+	pm->flTimeStepSound = 0;
+	pm->iStepLeft = 0;
+	pm->flFallVelocity = 0.0f;
+	pm->flSwimTime = 0.0f;
+	pm->flags = 0;
+	pm->usehull = 0;
+	pm->gravity = 1.0f;
+	pm->friction = 1.0f;
+	pm->oldbuttons = 0;
+	pm->waterjumptime = 0.0f;
+	pm->dead = false;
+	pm->deadflag = 0;
+	pm->spectator = 0;
+	pm->movetype = MOVETYPE_WALK;
+	pm->onground = -1;
+	pm->waterlevel = 0;
+	pm->watertype = CONTENTS_EMPTY;
+	pm->oldwaterlevel = 0;
+	pm->maxspeed = 250.0f;
+	pm->clientmaxspeed = 250.0f;
+	pm->iuser1 = pm->iuser2 = pm->iuser3 = pm->iuser4 = 0;
+	pm->fuser1 = pm->fuser2 = pm->fuser3 = pm->fuser4 = 0.0f;
+
+	pm->numphysent = 1;
+	memset( &pm->physents[0], 0, sizeof( pm->physents[0] ));
+	pm->nummoveent = 0;
+	pm->numvisent = 0;
+
+	g_iRandomSeed = 0x5eed;
+}
+
+static void PMB_RunCmd( const usercmd_t *cmd, pmb_state_t *state )
+{
+	playermove_t *pm = &g_PlayerMove;
+
+	pm->cmd = *cmd;
+	VectorCopy( cmd->viewangles, pm->angles );
+
+	PM_Move( pm, false );
+
+	pm->oldbuttons = cmd->buttons;
+	pm->time += cmd->msec;
+	g_flSysTime += cmd->msec * 0.001;
+
+	if( state )
+	{
+		VectorCopy( pm->origin, state->origin );
+		VectorCopy( pm->velocity, state->velocity );
+		state->flags = pm->flags;
+		state->onground = pm->onground;
+		state->waterlevel = pm->waterlevel;
+		state->usehull = pm->usehull;
+	}
+}
+
+/*
+====================
+PMB_Script
+
+Closed loop driver: runs toward the next waypoint with some strafing,
+jumping and crouching thrown in. Angles are snapped to the 16 bit
+precision the engine sends them with.
+====================
+*/
+static float PMB_SnapAngle( float angle )
+{
+	return (int)( angle * 65536.0f / 360.0f ) * ( 360.0f / 65536.0f );
+}
+
+static void PMB_Script( int count )
+{
+	playermove_t *pm = &g_PlayerMove;
+	unsigned int seed = 1;
+	int waypoint = 0, waypointcmds = 0;
+	float yaw = 0.0f;
+
+	PMB_Reset();
+
+	for( g_iCmds = 0; g_iCmds < count; g_iCmds++ )
+	{
+		usercmd_t *cmd = &g_Cmds[g_iCmds];
+		float dx = g_Route[waypoint][0] - pm->origin[0];
+		float dy = g_Route[waypoint][1] - pm->origin[1];
+		float wish, delta;
+		int phase;
+
+		if( dx * dx + dy * dy < 48.0f * 48.0f || ++waypointcmds > PMB_WAYPOINT_TIMEOUT )
+		{
+			waypoint = ( waypoint + 1 ) % PMB_ROUTE_POINTS;
+			waypointcmds = 0;
+		}
+
+		// turn at most 6 degrees per command, like a mouse would
+		wish = atan2( dy, dx ) * ( 180.0 / M_PI );
+		delta = wish - yaw;
+
+		while( delta > 180.0f ) delta -= 360.0f;
+		while( delta < -180.0f ) delta += 360.0f;
+
+		yaw += delta > 6.0f ? 6.0f : delta < -6.0f ? -6.0f : delta;
+		yaw = yaw >= 360.0f ? yaw - 360.0f : yaw < 0.0f ? yaw + 360.0f : yaw;
+
+		seed = seed * 1103515245u + 12345u;
+		phase = ( g_iCmds / 64 ) % 8;
+
+		memset( cmd, 0, sizeof( *cmd ));
+		cmd->msec = 8 + (( seed >> 16 ) % 3 ) * 4;	// 8, 12 or 16 msec, a mix of cl_cmdrate settings
+		cmd->viewangles[0] = PMB_SnapAngle( phase == 5 ? 30.0f : 0.0f );
+		cmd->viewangles[1] = PMB_SnapAngle( yaw );
+		cmd->forwardmove = 250.0f;
+		cmd->buttons = IN_FORWARD;
+
+		if( phase == 2 || phase == 6 )
+		{
+			cmd->sidemove = ( phase == 2 ) ? 250.0f : -250.0f;
+			cmd->buttons |= ( phase == 2 ) ? IN_MOVERIGHT : IN_MOVELEFT;
+		}
+
+		if( phase == 3 && ( g_iCmds % 32 ) < 4 )
+			cmd->buttons |= IN_JUMP;
+
+		if( phase == 4 || ( pm->origin[0] > -220 && pm->origin[0] < 20 && pm->origin[1] > -620 && pm->origin[1] < -380 ))
+			cmd->buttons |= IN_DUCK;
+
+		if( phase == 7 && ( g_iCmds % 64 ) < 16 )
+		{
+			cmd->forwardmove = 0.0f;
+			cmd->buttons &= ~IN_FORWARD;
+		}
+
+		// swim up out of the pit
+		if( pm->waterlevel >= 2 )
+		{
+			cmd->upmove = 250.0f;
+			cmd->buttons |= IN_JUMP;
+		}
+
+		PMB_RunCmd( cmd, &g_States[g_iCmds] );
+	}
+}
+
+/*
+====================
+log files
+====================
+*/
+static bool PMB_WriteLog( const char *path )
+{
+	FILE *f = fopen( path, "w" );
+
+	if( !f )
+	{
+		fprintf( stderr, "couldn't write %s\n", path );
+		return false;
+	}
+
+	fprintf( f, "# pm_bench log: msec pitch yaw roll forward side up buttons | origin velocity flags onground waterlevel usehull\n" );
+
+	for( int i = 0; i < g_iCmds; i++ )
+	{
+		const usercmd_t *cmd = &g_Cmds[i];
+		const pmb_state_t *st = &g_States[i];
+
+		fprintf( f, "%d %.9g %.9g %.9g %.9g %.9g %.9g %d | %.3f %.3f %.3f %.3f %.3f %.3f %d %d %d %d\n",
+			cmd->msec, cmd->viewangles[0], cmd->viewangles[1], cmd->viewangles[2],
+			cmd->forwardmove, cmd->sidemove, cmd->upmove, cmd->buttons,
+			st->origin[0], st->origin[1], st->origin[2], st->velocity[0], st->velocity[1], st->velocity[2],
+			st->flags, st->onground, st->waterlevel, st->usehull );
+	}
+
+	fclose( f );
+
+	return true;
+}
+
+static bool PMB_ReadLog( const char *path )
+{
+	FILE *f = fopen( path, "r" );
+	char line[512];
+
+	if( !f )
+	{
+		fprintf( stderr, "couldn't read %s\n", path );
+		return false;
+	}
+
+	g_iCmds = 0;
+
+	while( fgets( line, sizeof( line ), f ) && g_iCmds < PMB_MAX_CMDS )
+	{
+		usercmd_t *cmd = &g_Cmds[g_iCmds];
+		pmb_state_t *st = &g_States[g_iCmds];
+		int msec, buttons;
+
+		if( line[0] == '#' )
+			continue;
+
+		memset( cmd, 0, sizeof( *cmd ));
+
+		if( sscanf( line, "%d %f %f %f %f %f %f %d | %f %f %f %f %f %f %d %d %d %d",
+			&msec, &cmd->viewangles[0], &cmd->viewangles[1], &cmd->viewangles[2],
+			&cmd->forwardmove, &cmd->sidemove, &cmd->upmove, &buttons,
+			&st->origin[0], &st->origin[1], &st->origin[2], &st->velocity[0], &st->velocity[1], &st->velocity[2],
+			&st->flags, &st->onground, &st->waterlevel, &st->usehull ) != 18 )
+		{
+			fprintf( stderr, "%s: bad line %i\n", path, g_iCmds + 1 );
+			fclose( f );
+			return false;
+		}
+
+		cmd->msec = msec;
+		cmd->buttons = buttons;
+		g_iCmds++;
+	}
+
+	fclose( f );
+
+	return g_iCmds > 0;
+}
+
+/*
+====================
+PMB_Verify
+
+Open loop replay of the logged commands. Reports the first mismatching
+moves, later ones usually just follow from those.
+====================
+*/
+static int PMB_Verify( void )
+{
+	int errors = 0;
+
+	PMB_Reset();
+
+	for( int i = 0; i < g_iCmds; i++ )
+	{
+		const pmb_state_t *want = &g_States[i];
+		pmb_state_t got;
+		bool match = true;
+
+		PMB_RunCmd( &g_Cmds[i], &got );
+
+		for( int j = 0; j < 3; j++ )
+		{
+			if( fabs( got.origin[j] - want->origin[j] ) > PMB_ORIGIN_EPSILON || fabs( got.velocity[j] - want->velocity[j] ) > PMB_VELOCITY_EPSILON )
+				match = false;
+		}
+
+		if( got.flags != want->flags || got.onground != want->onground || got.waterlevel != want->waterlevel || got.usehull != want->usehull )
+			match = false;
+
+		if( match )
+			continue;
+
+		if( errors++ < 5 )
+		{
+			printf( "move %i: origin %.3f %.3f %.3f velocity %.3f %.3f %.3f flags %d hull %d, expected %.3f %.3f %.3f velocity %.3f %.3f %.3f flags %d hull %d\n",
+				i, got.origin[0], got.origin[1], got.origin[2], got.velocity[0], got.velocity[1], got.velocity[2], got.flags, got.usehull,
+				want->origin[0], want->origin[1], want->origin[2], want->velocity[0], want->velocity[1], want->velocity[2], want->flags, want->usehull );
+		}
+	}
+
+	printf( "verify: %i moves, %i mismatches\n", g_iCmds, errors );
+
+	return errors;
+}
+
+static void PMB_Throughput( void )
+{
+	long moves = 0;
+	double start = Bench_Time(), elapsed;
+
+	do
+	{
+		PMB_Reset();
+
+		for( int i = 0; i < g_iCmds; i++ )
+			PMB_RunCmd( &g_Cmds[i], NULL );
+
+		moves += g_iCmds;
+		elapsed = Bench_Time() - start;
+	} while( elapsed < 1.0 );
+
+	printf( "PM_Move: %ld moves in %.2f s, %.0f moves/s, %.1f ns/move\n", moves, elapsed, moves / elapsed, elapsed * 1e9 / moves );
+}
+
+int main( int argc, char **argv )
+{
+	const char *record = NULL, *verify = NULL;
+	int count = PMB_DEFAULT_CMDS;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-record" ) && i + 1 < argc )
+			record = argv[++i];
+		else if( !strcmp( argv[i], "-verify" ) && i + 1 < argc )
+			verify = argv[++i];
+		else if( !strcmp( argv[i], "-moves" ) && i + 1 < argc )
+			count = atoi( argv[++i] );
+		else
+		{
+			fprintf( stderr, "usage: %s [-record <log>] [-verify <log>] [-moves <n>]\n", argv[0] );
+			return 1;
+		}
+	}
+
+	count = count < 1 ? 1 : count > PMB_MAX_CMDS ? PMB_MAX_CMDS : count;
+
+	PMB_Init();
+
+	if( verify )
+	{
+		if( !PMB_ReadLog( verify ))
+			return 1;
+
+		if( PMB_Verify( ))
+			return 2;
+	}
+	else
+	{
+		PMB_Script( count );
+
+		if( record && !PMB_WriteLog( record ))
+			return 1;
+	}
+
+	PMB_Throughput();
+
+	return 0;
+}
@@ -0,0 +1,840 @@
+/*
+studio_bench.cpp - headless benchmark for studio bone setup and math
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; either version 2 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+In addition, as a special exception, the author gives permission to
+link the code of this program with the Half-Life Game Engine ("HL
+Engine") and Modified Game Libraries ("MODs") developed by Valve,
+L.L.C ("Valve").  You must obey the GNU General Public License in all
+respects for all of the code used other than the HL Engine and MODs
+from Valve.  If you modify this file, you may extend this exception
+to your version of the file, but you are not obligated to do so.  If
+you do not wish to do so, delete this exception statement from your
+version.
+*/
+
+// Drives CGameStudioModelRenderer bone setup without an engine, so changes to
+// studio_util.cpp and StudioModelRenderer.cpp can be measured on the command line:
+//
+//   studio_bench [-verify] [-game <dir>] [-entities <n>] [-weapon <p_model.mdl>] [model.mdl ...]
+//
+// -verify first checks the SIMD batch kernels against the scalar ones and
+// exits with 2 if any result is further off than VERIFY_EPSILON.
+// Without models a synthetic skeleton is used, and without -weapon a
+// synthetic weapon that shares part of its bone names is merged onto it.
+// Sequence groups are loaded relative to the -game directory, same as the
+// engine does.
+
+#include <assert.h>
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+#include "entity_state.h"
+#include "cl_entity.h"
+#include "studio_util.h"
+#include "r_studioint.h"
+#include "StudioModelRenderer.h"
+#include "GameStudioModelRenderer.h"
+
+#include "bench.h"
+
+#define BENCH_MAX_ENTITIES	64
+#define BENCH_MAX_MODELS	16
+#define BENCH_STATES		8	// distinct animation states per scene, rest are duplicates
+
+#ifndef IDSTUDIOHEADER
+#define IDSTUDIOHEADER		(('T'<<24)+('S'<<16)+('D'<<8)+'I') // little-endian "IDST"
+#define STUDIO_VERSION		10
+#endif
+
+extern engine_studio_api_t IEngineStudio;
+
+static char g_szGameDir[256] = ".";
+
+static float g_BoneTransform[MAXSTUDIOBONES][3][4];
+static float g_LightTransform[MAXSTUDIOBONES][3][4];
+static float g_AliasTransform[3][4];
+static float g_RotationMatrix[3][4];
+static int g_iStudioModelCount, g_iModelsDrawn;
+
+static model_t g_Models[BENCH_MAX_MODELS];
+static int g_iModels;
+
+static cl_entity_t g_Entities[BENCH_MAX_ENTITIES];
+static cl_entity_t g_WeaponEntities[BENCH_MAX_ENTITIES];
+static player_info_t g_Players[BENCH_MAX_ENTITIES];
+static model_t *g_pWeaponModel;
+
+/*
+====================
+engine stubs
+====================
+*/
+static int Bench_GetMaxClients( void )
+{
+	return 32;
+}
+
+static cvar_t *Bench_GetCvar( const char *name )
+{
+	return Bench_RegisterVariable( name, "0", 0 );
+}
+
+static struct model_s *Bench_GetChromeSprite( void )
+{
+	return NULL;
+}
+
+static void Bench_GetModelCounters( int **s, int **a )
+{
+	*s = &g_iStudioModelCount;
+	*a = &g_iModelsDrawn;
+}
+
+static float ****Bench_StudioGetBoneTransform( void )
+{
+	return (float ****)g_BoneTransform;
+}
+
+static float ****Bench_StudioGetLightTransform( void )
+{
+	return (float ****)g_LightTransform;
+}
+
+static float ***Bench_StudioGetAliasTransform( void )
+{
+	return (float ***)g_AliasTransform;
+}
+
+static float ***Bench_StudioGetRotationMatrix( void )
+{
+	return (float ***)g_RotationMatrix;
+}
+
+static int Bench_IsHardware( void )
+{
+	return 1;
+}
+
+static void *Bench_Mem_Calloc( int number, size_t size )
+{
+	return calloc( number, size );
+}
+
+static void *Bench_Mod_Extradata( struct model_s *mod )
+{
+	return mod ? mod->cache.data : NULL;
+}
+
+static void *Bench_Cache_Check( struct cache_user_s *c )
+{
+	return c->data;
+}
+
+static void *Bench_LoadFile( const char *path, int *length )
+{
+	FILE *f = fopen( path, "rb" );
+	void *buffer;
+	long size;
+
+	if( !f )
+		return NULL;
+
+	fseek( f, 0, SEEK_END );
+	size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	buffer = malloc( size );
+
+	if( fread( buffer, 1, size, f ) != (size_t)size )
+	{
+		free( buffer );
+		buffer = NULL;
+	}
+
+	fclose( f );
+
+	if( length )
+		*length = (int)size;
+
+	return buffer;
+}
+
+static void Bench_LoadCacheFile( char *path, struct cache_user_s *cu )
+{
+	char fullpath[512];
+
+	snprintf( fullpath, sizeof( fullpath ), "%s/%s", g_szGameDir, path );
+	cu->data = Bench_LoadFile( fullpath, NULL );
+
+	if( !cu->data )
+	{
+		fprintf( stderr, "couldn't load sequence group %s\n", fullpath );
+		exit( 1 );
+	}
+}
+
+static void Bench_InitEngine( void )
+{
+	memset( &gEngfuncs, 0, sizeof( gEngfuncs ));
+	gEngfuncs.pfnRegisterVariable = Bench_RegisterVariable;
+	gEngfuncs.pfnGetCvarPointer = Bench_GetCvarPointer;
+	gEngfuncs.Con_Printf = Bench_Con_Printf;
+	gEngfuncs.Con_DPrintf = Bench_Con_Printf;
+	gEngfuncs.Con_NPrintf = Bench_Con_NPrintf;
+	gEngfuncs.GetMaxClients = Bench_GetMaxClients;
+
+	memset( &IEngineStudio, 0, sizeof( IEngineStudio ));
+	IEngineStudio.Mem_Calloc = Bench_Mem_Calloc;
+	IEngineStudio.Cache_Check = Bench_Cache_Check;
+	IEngineStudio.LoadCacheFile = Bench_LoadCacheFile;
+	IEngineStudio.Mod_Extradata = Bench_Mod_Extradata;
+	IEngineStudio.GetCvar = Bench_GetCvar;
+	IEngineStudio.GetChromeSprite = Bench_GetChromeSprite;
+	IEngineStudio.GetModelCounters = Bench_GetModelCounters;
+	IEngineStudio.StudioGetBoneTransform = Bench_StudioGetBoneTransform;
+	IEngineStudio.StudioGetLightTransform = Bench_StudioGetLightTransform;
+	IEngineStudio.StudioGetAliasTransform = Bench_StudioGetAliasTransform;
+	IEngineStudio.StudioGetRotationMatrix = Bench_StudioGetRotationMatrix;
+	IEngineStudio.IsHardware = Bench_IsHardware;
+
+	g_StudioRenderer.Init();
+}
+
+/*
+====================
+Bench_LoadModel
+====================
+*/
+static model_t *Bench_LoadModel( const char *path, bool weapon )
+{
+	model_t *mod;
+	studiohdr_t *phdr;
+	int length;
+
+	if( g_iModels >= BENCH_MAX_MODELS && !weapon )
+		return NULL;
+
+	phdr = (studiohdr_t *)Bench_LoadFile( path, &length );
+
+	if( !phdr || length < (int)sizeof( studiohdr_t ) || phdr->id != IDSTUDIOHEADER || phdr->version != STUDIO_VERSION )
+	{
+		fprintf( stderr, "%s is not a studio model\n", path );
+		free( phdr );
+		return NULL;
+	}
+
+	mod = weapon ? (model_t *)calloc( 1, sizeof( model_t )) : &g_Models[g_iModels++];
+	strncpy( mod->name, path, sizeof( mod->name ) - 1 );
+	mod->type = mod_studio;
+	mod->cache.data = phdr;
+
+	return mod;
+}
+
+/*
+====================
+Bench_BuildModel
+
+A player-like skeleton: pelvis, spine chain and legs, one 9-way blended
+sequence for the upper body and a single blend gait sequence. Every
+rotation channel is animated so StudioCalcRotations decodes real data.
+
+With weapon set it is a p_ model instead: one sequence, the first
+SYNTH_WEAPON_SHARED bones named after player bones so they merge, the
+rest its own.
+====================
+*/
+#define SYNTH_BONES		48
+#define SYNTH_FRAMES	30
+#define SYNTH_CURVES	8
+#define SYNTH_SEQ_UPPER	10
+#define SYNTH_SEQ_GAIT	4
+#define SYNTH_WEAPON_BONES	24
+#define SYNTH_WEAPON_SHARED	16
+
+static model_t *Bench_BuildModel( bool weapon )
+{
+	int numbones = weapon ? SYNTH_WEAPON_BONES : SYNTH_BONES;
+	int numseq = weapon ? 1 : SYNTH_SEQ_UPPER + 1;
+	int upper = weapon ? -1 : SYNTH_SEQ_UPPER;
+	int numanims = numseq * numbones + ( weapon ? 0 : 8 * numbones ); // upper sequence has 9 blends
+	int curvesize = ( 1 + SYNTH_FRAMES ) * sizeof( mstudioanimvalue_t );
+	int boneofs, seqofs, groupofs, animofs, curveofs, length;
+	mstudioseqgroup_t *pseqgroup;
+	mstudioseqdesc_t *pseqdesc;
+	mstudioanimvalue_t *pvalue;
+	mstudioanim_t *panim;
+	mstudiobone_t *pbone;
+	studiohdr_t *phdr;
+	model_t *mod;
+	byte *buffer;
+	int i, j, k;
+
+	boneofs = sizeof( studiohdr_t );
+	seqofs = boneofs + numbones * sizeof( mstudiobone_t );
+	groupofs = seqofs + numseq * sizeof( mstudioseqdesc_t );
+	animofs = groupofs + sizeof( mstudioseqgroup_t );
+	curveofs = animofs + numanims * sizeof( mstudioanim_t );
+	length = curveofs + SYNTH_CURVES * curvesize;
+
+	buffer = (byte *)calloc( 1, length );
+	phdr = (studiohdr_t *)buffer;
+	phdr->id = IDSTUDIOHEADER;
+	phdr->version = STUDIO_VERSION;
+	strcpy( phdr->name, weapon ? "synthetic_weapon.mdl" : "synthetic.mdl" );
+	phdr->length = length;
+	phdr->numbones = numbones;
+	phdr->boneindex = boneofs;
+	phdr->numseq = numseq;
+	phdr->seqindex = seqofs;
+	phdr->numseqgroups = 1;
+	phdr->seqgroupindex = groupofs;
+
+	pbone = (mstudiobone_t *)( buffer + boneofs );
+
+	for( i = 0; i < numbones; i++ )
+	{
+		if( i >= SYNTH_WEAPON_SHARED && weapon )
+			sprintf( pbone[i].name, "Weapon%02d", i );
+		else if( i == 0 )
+			strcpy( pbone[i].name, "Bip01" );
+		else if( i == 1 )
+			strcpy( pbone[i].name, "Bip01 Pelvis" );
+		else if( i == 2 )
+			strcpy( pbone[i].name, "Bip01 Spine" );
+		else
+			sprintf( pbone[i].name, "Bone%02d", i );
+
+		// spine chain up to two thirds, legs hang off the pelvis
+		if( i == 0 )
+			pbone[i].parent = -1;
+		else if( i == SYNTH_BONES * 2 / 3 && !weapon )
+			pbone[i].parent = 1;
+		else
+			pbone[i].parent = i - 1;
+
+		for( j = 0; j < 6; j++ )
+		{
+			pbone[i].bonecontroller[j] = -1;
+			pbone[i].value[j] = ( j < 3 ) ? ( j == 0 ? 4.0f : 0.0f ) : 0.1f * j;
+			pbone[i].scale[j] = ( j < 3 ) ? 0.01f : 0.0005f;
+		}
+	}
+
+	pseqgroup = (mstudioseqgroup_t *)( buffer + groupofs );
+	strcpy( pseqgroup->label, "default" );
+	pseqgroup->data = 0;
+
+	pseqdesc = (mstudioseqdesc_t *)( buffer + seqofs );
+	panim = (mstudioanim_t *)( buffer + animofs );
+
+	for( i = 0, k = 0; i < numseq; i++ )
+	{
+		int blends = ( i == upper ) ? 9 : 1;
+
+		sprintf( pseqdesc[i].label, "seq%02d", i );
+		pseqdesc[i].fps = 30.0f;
+		pseqdesc[i].flags = STUDIO_LOOPING;
+		pseqdesc[i].numframes = SYNTH_FRAMES;
+		pseqdesc[i].numblends = blends;
+		pseqdesc[i].animindex = animofs + k * sizeof( mstudioanim_t );
+
+		for( j = 0; j < blends * numbones; j++, k++ )
+		{
+			for( int axis = 0; axis < 6; axis++ )
+			{
+				// only rotations are animated, positions keep the bone default
+				if( axis < 3 )
+					continue;
+
+				int curve = ( i + j + axis ) % SYNTH_CURVES;
+				panim[k].offset[axis] = curveofs + curve * curvesize - ( animofs + k * (int)sizeof( mstudioanim_t ));
+			}
+		}
+	}
+
+	for( i = 0; i < SYNTH_CURVES; i++ )
+	{
+		pvalue = (mstudioanimvalue_t *)( buffer + curveofs + i * curvesize );
+		pvalue[0].num.valid = SYNTH_FRAMES;
+		pvalue[0].num.total = SYNTH_FRAMES;
+
+		for( j = 0; j < SYNTH_FRAMES; j++ )
+			pvalue[1 + j].value = (short)( 2000.0 * sin( ( i + 1 ) * j * M_PI * 2.0 / SYNTH_FRAMES ));
+	}
+
+	// the weapon is not a model of its own to bench
+	mod = weapon ? (model_t *)calloc( 1, sizeof( model_t )) : &g_Models[g_iModels++];
+	strcpy( mod->name, weapon ? "synthetic_weapon" : "synthetic" );
+	mod->type = mod_studio;
+	mod->cache.data = phdr;
+
+	return mod;
+}
+
+/*
+====================
+Bench_SetupScene
+
+Spreads entities over BENCH_STATES animation states, as in a round where
+several players run the same sequence in lockstep.
+====================
+*/
+static int Bench_FindSequence( studiohdr_t *phdr, int numblends )
+{
+	mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex );
+
+	for( int i = 0; i < phdr->numseq; i++ )
+	{
+		if( pseqdesc[i].numblends == numblends )
+			return i;
+	}
+
+	return -1;
+}
+
+static bool Bench_SetupScene( model_t *mod, int entities )
+{
+	studiohdr_t *phdr = (studiohdr_t *)mod->cache.data;
+	int upper = Bench_FindSequence( phdr, 9 );
+	int gait = Bench_FindSequence( phdr, 1 );
+	bool player = upper >= 0 && gait >= 0 && phdr->numseq > SYNTH_SEQ_GAIT;
+
+	if( player )
+		gait = SYNTH_SEQ_GAIT;
+
+	for( int i = 0; i < entities; i++ )
+	{
+		cl_entity_t *ent = &g_Entities[i];
+		int state = i % BENCH_STATES;
+
+		*ent = cl_entity_t();
+		g_Players[i] = player_info_t();
+
+		ent->index = i + 1;
+		ent->player = player;
+		ent->model = mod;
+		ent->curstate.modelindex = 1;
+		ent->curstate.movetype = MOVETYPE_WALK;
+		ent->curstate.framerate = 1.0f;
+		ent->curstate.animtime = -0.05f * state;
+		ent->curstate.sequence = player ? upper : state % phdr->numseq;
+		ent->curstate.blending[0] = ent->latched.prevblending[0] = 32 * state;
+		ent->curstate.blending[1] = ent->latched.prevblending[1] = 127;
+		ent->curstate.controller[0] = ent->latched.prevcontroller[0] = 127;
+		ent->curstate.controller[1] = ent->latched.prevcontroller[1] = 127;
+		ent->curstate.controller[2] = ent->latched.prevcontroller[2] = 127;
+		ent->curstate.controller[3] = ent->latched.prevcontroller[3] = 127;
+		ent->origin[0] = ( i % 8 ) * 64.0f;
+		ent->origin[1] = ( i / 8 ) * 64.0f;
+		ent->angles[1] = i * 11.0f;
+
+		g_Players[i].gaitsequence = gait;
+		g_Players[i].gaitframe = state * 1.5f;
+
+		// merges with the sequence of the player clamped to what it has
+		g_WeaponEntities[i] = *ent;
+		g_WeaponEntities[i].model = g_pWeaponModel;
+		g_WeaponEntities[i].curstate.sequence = 0;
+	}
+
+	return player;
+}
+
+/*
+====================
+Bench_DrawScene
+
+Same sequence of calls as StudioDrawPlayer/StudioDrawModel up to the
+point where the model would be submitted for rendering.
+====================
+*/
+static void Bench_NextFrame( void )
+{
+	CGameStudioModelRenderer *r = &g_StudioRenderer;
+
+	r->m_nFrameCount++;
+	r->m_clOldTime = r->m_clTime;
+	r->m_clTime += 0.01;
+}
+
+static void Bench_SetEntity( model_t *mod, int i, bool player )
+{
+	CGameStudioModelRenderer *r = &g_StudioRenderer;
+
+	r->m_pCurrentEntity = &g_Entities[i];
+	r->m_pRenderModel = mod;
+	r->m_pStudioHeader = (studiohdr_t *)mod->cache.data;
+	r->m_pPlayerInfo = player ? &g_Players[i] : NULL;
+	r->m_nPlayerIndex = player ? i : -1;
+	r->m_fDoInterp = 1;
+
+	if( player )
+		g_Players[i].gaitframe += 0.3f;
+}
+
+static void Bench_DrawScene( model_t *mod, int entities, bool player )
+{
+	CGameStudioModelRenderer *r = &g_StudioRenderer;
+
+	Bench_NextFrame();
+
+	for( int i = 0; i < entities; i++ )
+	{
+		Bench_SetEntity( mod, i, player );
+
+		r->StudioSetUpTransform( 0 );
+		r->StudioSetupBones();
+		r->StudioSaveBones();
+	}
+
+	r->m_pPlayerInfo = NULL;
+}
+
+/*
+====================
+Bench_SetupBones
+
+One StudioSetupBones call per op, walking the scene so the pose cache
+sees the same mix of states as a whole scene draw
+====================
+*/
+static void Bench_SetupBones( model_t *mod, int entities, bool player, int *next )
+{
+	if( *next == 0 )
+		Bench_NextFrame();
+
+	Bench_SetEntity( mod, *next, player );
+	g_StudioRenderer.StudioSetupBones();
+
+	*next = ( *next + 1 ) % entities;
+}
+
+/*
+====================
+Bench_MergeBones
+
+One StudioMergeBones call per op, onto the bones the first entity of
+the scene saved, as the weapon draw right after a player does
+====================
+*/
+static void Bench_MergeBones( int entities, int *next )
+{
+	CGameStudioModelRenderer *r = &g_StudioRenderer;
+
+	r->m_pCurrentEntity = &g_WeaponEntities[*next];
+	r->m_pRenderModel = g_pWeaponModel;
+	r->m_pStudioHeader = (studiohdr_t *)g_pWeaponModel->cache.data;
+
+	r->StudioMergeBones( g_pWeaponModel );
+
+	*next = ( *next + 1 ) % entities;
+}
+
+static void Bench_Model( model_t *mod, int entities )
+{
+	studiohdr_t *phdr = (studiohdr_t *)mod->cache.data;
+	bool player = Bench_SetupScene( mod, entities );
+	char label[128];
+
+	printf( "\n%s: %i bones, %i sequences, %i entities%s\n", mod->name, phdr->numbones, phdr->numseq, entities, player ? ", player blending" : "" );
+
+	for( int simd = 0; simd <= 1; simd++ )
+	{
+		if( StudioUtil_SetSIMD( simd ) != simd )
+			continue;
+
+		for( int cache = 0; cache <= 2; cache++ )
+		{
+			Bench_SetCvar( "cl_posecache", cache );
+			snprintf( label, sizeof( label ), "  scene %s, cl_posecache %i", simd ? "simd" : "scalar", cache );
+			BENCH_RUN( label, 16, Bench_DrawScene( mod, entities, player ));
+		}
+	}
+
+	printf( "  (one op is a whole scene of %i entities)\n", entities );
+	Bench_SetCvar( "cl_posecache", 1 );
+
+	for( int simd = 0; simd <= 1; simd++ )
+	{
+		int next = 0;
+
+		if( StudioUtil_SetSIMD( simd ) != simd )
+			continue;
+
+		snprintf( label, sizeof( label ), "  StudioSetupBones (%s)", simd ? "simd" : "scalar" );
+		BENCH_RUN( label, 64, Bench_SetupBones( mod, entities, player, &next ));
+	}
+
+	// the bones the weapon merges onto
+	Bench_NextFrame();
+	Bench_SetEntity( mod, 0, player );
+	g_StudioRenderer.StudioSetUpTransform( 0 );
+	g_StudioRenderer.StudioSetupBones();
+	g_StudioRenderer.StudioSaveBones();
+	g_StudioRenderer.m_pPlayerInfo = NULL;
+
+	for( int simd = 0; simd <= 1; simd++ )
+	{
+		int next = 0;
+
+		if( StudioUtil_SetSIMD( simd ) != simd )
+			continue;
+
+		snprintf( label, sizeof( label ), "  StudioMergeBones (%s)", simd ? "simd" : "scalar" );
+		BENCH_RUN( label, 64, Bench_MergeBones( entities, &next ));
+	}
+
+	printf( "  (one op is one call, %s merged)\n", g_pWeaponModel->name );
+	StudioUtil_SetSIMD( 1 );
+}
+
+/*
+====================
+Bench_Math
+====================
+*/
+#define MATH_COUNT	MAXSTUDIOBONES
+
+static void Bench_Math( void )
+{
+	static vec4_t q1[MATH_COUNT], q2[MATH_COUNT], q3[MATH_COUNT];
+	static float pos[MATH_COUNT][3];
+	static float matrix[MATH_COUNT][3][4], out[MATH_COUNT][3][4];
+	static int parents[MATH_COUNT];
+	float root[3][4], angles[3];
+	int i, j;
+
+	srand( 1 );
+
+	for( i = 0; i < MATH_COUNT; i++ )
+	{
+		for( j = 0; j < 3; j++ )
+		{
+			angles[j] = ( rand() % 3600 ) * 0.1f;
+			pos[i][j] = ( rand() % 200 ) - 100.0f;
+		}
+
+		AngleQuaternion( angles, q1[i] );
+		angles[1] += 30.0f;
+		AngleQuaternion( angles, q2[i] );
+		parents[i] = i ? ( rand() % i ) : -1;
+	}
+
+	angles[0] = 10.0f; angles[1] = 20.0f; angles[2] = 30.0f;
+	AngleMatrix( angles, root );
+
+	printf( "\nmath, %i bones per op\n", MATH_COUNT );
+
+	BENCH_RUN( "  QuaternionSlerp", 64, for( i = 0; i < MATH_COUNT; i++ ) QuaternionSlerp( q1[i], q2[i], 0.3f, q3[i] ));
+	BENCH_RUN( "  QuaternionMatrix", 64, for( i = 0; i < MATH_COUNT; i++ ) QuaternionMatrix( q1[i], matrix[i] ));
+	BENCH_RUN( "  AngleMatrix", 64, for( i = 0; i < MATH_COUNT; i++ ) AngleMatrix( pos[i], matrix[i] ));
+	BENCH_RUN( "  ConcatTransforms", 64, for( i = 0; i < MATH_COUNT; i++ ) ConcatTransforms( root, matrix[i], out[i] ));
+
+	for( int simd = 0; simd <= 1; simd++ )
+	{
+		char label[64];
+
+		if( StudioUtil_SetSIMD( simd ) != simd )
+		{
+			printf( "  SIMD kernels not available\n" );
+			continue;
+		}
+
+		snprintf( label, sizeof( label ), "  QuaternionSlerpBatch (%s)", simd ? "simd" : "scalar" );
+		BENCH_RUN( label, 64, QuaternionSlerpBatch( q1, q2, 0.3f, q3, MATH_COUNT ));
+		snprintf( label, sizeof( label ), "  QuaternionMatrixBatch (%s)", simd ? "simd" : "scalar" );
+		BENCH_RUN( label, 64, QuaternionMatrixBatch( q1, pos, matrix, MATH_COUNT ));
+		snprintf( label, sizeof( label ), "  ConcatTransformsBatch (%s)", simd ? "simd" : "scalar" );
+		BENCH_RUN( label, 64, ConcatTransformsBatch( root, parents, matrix, out, MATH_COUNT ));
+	}
+
+	StudioUtil_SetSIMD( 1 );
+}
+
+/*
+====================
+Bench_Verify
+
+Feeds the same random bones through the SIMD and the scalar batch
+kernels and compares the results. Slerp inputs include nearly equal,
+backwards and opposite quaternions so every path of the kernel runs.
+====================
+*/
+#define VERIFY_ROUNDS	64
+#define VERIFY_EPSILON	0.0001f	// relative to the magnitude of the scalar result
+
+static int Bench_Compare( const char *name, int round, const float *got, const float *want, int count )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		float scale = fabs( want[i] ) > 1.0f ? fabs( want[i] ) : 1.0f;
+
+		if( fabs( got[i] - want[i] ) <= VERIFY_EPSILON * scale )
+			continue;
+
+		printf( "  %s round %i, float %i: simd %.7f, scalar %.7f\n", name, round, i, got[i], want[i] );
+		return 1;
+	}
+
+	return 0;
+}
+
+static int Bench_Verify( void )
+{
+	static vec4_t p[MATH_COUNT], q[MATH_COUNT], simdq[MATH_COUNT], scalarq[MATH_COUNT];
+	static float pos[MATH_COUNT][3];
+	static float simdm[MATH_COUNT][3][4], scalarm[MATH_COUNT][3][4];
+	static float simdout[MATH_COUNT][3][4], scalarout[MATH_COUNT][3][4];
+	static int parents[MATH_COUNT];
+	float root[3][4], angles[3], t;
+	int errors = 0;
+	int round, i, j;
+
+	if( StudioUtil_SetSIMD( 1 ) != 1 )
+	{
+		printf( "verify: SIMD kernels not available\n" );
+		return 0;
+	}
+
+	srand( 2 );
+
+	for( round = 0; round < VERIFY_ROUNDS; round++ )
+	{
+		for( i = 0; i < MATH_COUNT; i++ )
+		{
+			for( j = 0; j < 3; j++ )
+			{
+				angles[j] = ( rand() % 3600 ) * 0.1f;
+				pos[i][j] = ( rand() % 2000 ) * 0.1f - 100.0f;
+			}
+
+			AngleQuaternion( angles, p[i] );
+
+			switch( i % 4 )
+			{
+			case 0:	// nearly equal
+				angles[1] += 0.0001f * ( rand() % 10 );
+				AngleQuaternion( angles, q[i] );
+				break;
+			case 1:	// backwards
+				angles[2] += rand() % 90;
+				AngleQuaternion( angles, q[i] );
+				for( j = 0; j < 4; j++ )
+					q[i][j] = -q[i][j];
+				break;
+			case 2:	// opposite, in one round of eight
+				if( round % 8 == 1 )
+				{
+					for( j = 0; j < 4; j++ )
+						q[i][j] = -p[i][j];
+					break;
+				}
+				// fall through
+			default:
+				for( j = 0; j < 3; j++ )
+					angles[j] = ( rand() % 3600 ) * 0.1f;
+				AngleQuaternion( angles, q[i] );
+				break;
+			}
+
+			parents[i] = i ? ( rand() % i ) : -1;
+		}
+
+		for( j = 0; j < 3; j++ )
+			angles[j] = ( rand() % 3600 ) * 0.1f;
+
+		AngleMatrix( angles, root );
+		root[0][3] = rand() % 100;
+		root[1][3] = rand() % 100;
+		root[2][3] = rand() % 100;
+
+		t = ( round % 8 == 0 ) ? ( round % 16 ? 1.0f : 0.0f ) : ( rand() % 1000 ) * 0.001f;
+
+		StudioUtil_SetSIMD( 0 );
+		QuaternionSlerpBatch( p, q, t, scalarq, MATH_COUNT );
+		QuaternionMatrixBatch( scalarq, pos, scalarm, MATH_COUNT );
+		ConcatTransformsBatch( root, parents, scalarm, scalarout, MATH_COUNT );
+
+		StudioUtil_SetSIMD( 1 );
+		QuaternionSlerpBatch( p, q, t, simdq, MATH_COUNT );
+		// the scalar slerp result, so each kernel is compared on its own
+		QuaternionMatrixBatch( scalarq, pos, simdm, MATH_COUNT );
+		ConcatTransformsBatch( root, parents, scalarm, simdout, MATH_COUNT );
+
+		errors += Bench_Compare( "QuaternionSlerpBatch", round, simdq[0], scalarq[0], MATH_COUNT * 4 );
+		errors += Bench_Compare( "QuaternionMatrixBatch", round, simdm[0][0], scalarm[0][0], MATH_COUNT * 12 );
+		errors += Bench_Compare( "ConcatTransformsBatch", round, simdout[0][0], scalarout[0][0], MATH_COUNT * 12 );
+	}
+
+	printf( "verify: %i rounds of %i bones, %i mismatches\n", VERIFY_ROUNDS, MATH_COUNT, errors );
+
+	return errors;
+}
+
+int main( int argc, char **argv )
+{
+	int entities = 32;
+	bool verify = false;
+	int i;
+
+	Bench_InitEngine();
+
+	for( i = 1; i < argc; i++ )
+	{
+		if( !strcmp( argv[i], "-game" ) && i + 1 < argc )
+		{
+			strncpy( g_szGameDir, argv[++i], sizeof( g_szGameDir ) - 1 );
+		}
+		else if( !strcmp( argv[i], "-entities" ) && i + 1 < argc )
+		{
+			entities = atoi( argv[++i] );
+			entities = entities < 1 ? 1 : entities > BENCH_MAX_ENTITIES ? BENCH_MAX_ENTITIES : entities;
+		}
+		else if( !strcmp( argv[i], "-verify" ))
+		{
+			verify = true;
+		}
+		else if( !strcmp( argv[i], "-weapon" ) && i + 1 < argc )
+		{
+			if( !( g_pWeaponModel = Bench_LoadModel( argv[++i], true )))
+				return 1;
+		}
+		else if( !Bench_LoadModel( argv[i], false ))
+		{
+			return 1;
+		}
+	}
+
+	if( verify && Bench_Verify( ))
+		return 2;
+
+	Bench_Math();
+
+	if( !g_iModels )
+		Bench_BuildModel( false );
+
+	if( !g_pWeaponModel )
+		g_pWeaponModel = Bench_BuildModel( true );
+
+	for( i = 0; i < g_iModels; i++ )
+		Bench_Model( &g_Models[i], entities );
+
+	return 0;
+}
@@ -30,6 +30,7 @@
 #include "render_api.h"
 #include "mobility_int.h"
 #include "vgui_parser.h"
+#include "pred_stats.h"
 
 
 cl_enginefunc_t gEngfuncs = { };
@@ -48,6 +49,8 @@ void InitInput (void);
 void Game_HookEvents( void );
 void IN_Commands( void );
 void Input_Shutdown (void);
+void R_StudioVidInit (void);
+void R_StudioShutdown (void);
 
 /*
 ========================== 
@@ -82,6 +85,7 @@ void DLLEXPORT HUD_Shutdown( void )
 {
 	gHUD.Shutdown();
 	Input_Shutdown();
+	R_StudioShutdown();
 	Localize_Free();
 }
 
@@ -153,7 +157,13 @@ char DLLEXPORT HUD_PlayerMoveTexture( char *name )
 
 void DLLEXPORT HUD_PlayerMove( struct playermove_s *ppmove, int server )
 {
+	bool stats = !server && PredStats_Enabled();
+	double start = stats ? PredStats_Time() : 0;
+
 	PM_Move( ppmove, server );
+
+	if( stats )
+		PredStats_AddTime( PREDSTATS_TIMER_PMOVE, PredStats_Time() - start );
 }
 
 #ifdef _CS16CLIENT_ENABLE_GSRC_SUPPORT
@@ -192,6 +202,7 @@ bool isLoaded = false;
 int DLLEXPORT HUD_VidInit( void )
 {
 	gHUD.VidInit();
+	R_StudioVidInit();
 
 	isLoaded = true;
 
@@ -214,6 +225,7 @@ void DLLEXPORT HUD_Init( void )
 {
 	InitInput();
 	gHUD.Init();
+	PredStats_Init();
 	//Scheme_Init();
 }
 
@@ -278,6 +290,8 @@ Called by engine every frame that client .dll is loaded
 
 void DLLEXPORT HUD_Frame( double time )
 {
+	PredStats_Frame( time );
+
 #ifdef _CS16CLIENT_ENABLE_GSRC_SUPPORT
 	gEngfuncs.VGui_ViewportPaintBackground(HUD_GetRect());
 #endif
@@ -37,6 +37,7 @@
 #include "hud_iface.h"
 #include "com_weapons.h"
 #include "demo.h"
+#include "pred_stats.h"
 
 #include "cl_entity.h"
 
@@ -101,6 +102,80 @@ static CUMP45 g_UMP45;
 static CUSP g_USP;
 static CXM1014 g_XM1014;
 
+// Everything prediction and the crosshair need to know about a client side weapon
+typedef struct clientweapon_s
+{
+	int id;
+	CBasePlayerWeapon *weapon;
+	int accuracy;		// ACCURACY_* flags
+	int altState;		// WPNSTATE_* bit that selects altAccuracy, 0 if there is one mode only
+	int altAccuracy;
+} clientweapon_t;
+
+#define ACC_RIFLE	(ACCURACY_AIR | ACCURACY_SPEED)
+#define ACC_PISTOL	(ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK)
+
+static const clientweapon_t g_ClientWeapons[] =
+{
+	{ WEAPON_P228,         &g_P228,         ACC_PISTOL, 0, 0 },
+	{ WEAPON_SCOUT,        &g_SCOUT,        0, 0, 0 },
+	{ WEAPON_HEGRENADE,    &g_HEGrenade,    0, 0, 0 },
+	{ WEAPON_XM1014,       &g_XM1014,       0, 0, 0 },
+	{ WEAPON_C4,           &g_C4,           0, 0, 0 },
+	{ WEAPON_MAC10,        &g_MAC10,        ACCURACY_AIR, 0, 0 },
+	{ WEAPON_AUG,          &g_AUG,          ACC_RIFLE, 0, 0 },
+	{ WEAPON_SMOKEGRENADE, &g_SmokeGrenade, 0, 0, 0 },
+	{ WEAPON_ELITE,        &g_ELITE,        0, 0, 0 },
+	{ WEAPON_FIVESEVEN,    &g_FiveSeven,    ACC_PISTOL, 0, 0 },
+	{ WEAPON_UMP45,        &g_UMP45,        ACCURACY_AIR, 0, 0 },
+	{ WEAPON_SG550,        &g_SG550,        0, 0, 0 },
+	{ WEAPON_GALIL,        &g_Galil,        ACC_RIFLE, 0, 0 },
+	{ WEAPON_FAMAS,        &g_Famas,        ACC_RIFLE | ACCURACY_MULTIPLY_BY_14_2, WPNSTATE_FAMAS_BURST_MODE, ACC_RIFLE },
+	{ WEAPON_USP,          &g_USP,          ACC_PISTOL | ACCURACY_MULTIPLY_BY_14, WPNSTATE_USP_SILENCED, ACC_PISTOL },
+	{ WEAPON_GLOCK18,      &g_GLOCK18,      ACC_PISTOL | ACCURACY_MULTIPLY_BY_14_2, WPNSTATE_GLOCK18_BURST_MODE, ACC_PISTOL },
+	{ WEAPON_AWP,          &g_AWP,          0, 0, 0 },
+	{ WEAPON_MP5N,         &g_MP5N,         ACCURACY_AIR, 0, 0 },
+	{ WEAPON_M249,         &g_M249,         ACC_RIFLE, 0, 0 },
+	{ WEAPON_M4A1,         &g_M4A1,         ACC_RIFLE | ACCURACY_MULTIPLY_BY_14, WPNSTATE_USP_SILENCED, ACC_RIFLE },
+	{ WEAPON_M3,           &g_M3,           0, 0, 0 },
+	{ WEAPON_TMP,          &g_TMP,          ACCURACY_AIR, 0, 0 },
+	{ WEAPON_G3SG1,        &g_G3SG1,        0, 0, 0 },
+	{ WEAPON_FLASHBANG,    &g_Flashbang,    0, 0, 0 },
+	{ WEAPON_DEAGLE,       &g_DEAGLE,       ACC_PISTOL, 0, 0 },
+	{ WEAPON_SG552,        &g_SG552,        ACC_RIFLE, 0, 0 },
+	{ WEAPON_AK47,         &g_AK47,         ACC_RIFLE, 0, 0 },
+	{ WEAPON_KNIFE,        &g_Knife,        0, 0, 0 },
+	{ WEAPON_P90,          &g_P90,          ACC_RIFLE, 0, 0 },
+};
+
+#define NUM_CLIENT_WEAPONS ( sizeof( g_ClientWeapons ) / sizeof( g_ClientWeapons[0] ))
+
+/*
+=====================
+GetClientWeapon
+
+Registry entry by weapon id, NULL if the weapon isn't predicted
+=====================
+*/
+static const clientweapon_t *GetClientWeapon( int id )
+{
+	static const clientweapon_t *byId[MAX_WEAPONS];
+	static bool initialized = false;
+
+	if( !initialized )
+	{
+		for( size_t i = 0; i < NUM_CLIENT_WEAPONS; i++ )
+			byId[g_ClientWeapons[i].id] = &g_ClientWeapons[i];
+
+		initialized = true;
+	}
+
+	if( id <= 0 || id >= MAX_WEAPONS )
+		return NULL;
+
+	return byId[id];
+}
+
 int    g_iWeaponFlags;
 bool   g_bInBombZone;
 int    g_iFreezeTimeOver;
@@ -894,109 +969,22 @@ void HUD_InitClientWeapons( void )
 	HUD_PrepEntity( &player		, NULL );
 
 	// Allocate slot(s) for each weapon that we are going to be predicting
-	HUD_PrepEntity( &g_P228, &player);
-	HUD_PrepEntity( &g_SCOUT, &player);
-	HUD_PrepEntity( &g_HEGrenade, &player);
-	HUD_PrepEntity( &g_XM1014, &player);
-	HUD_PrepEntity( &g_C4, &player);
-	HUD_PrepEntity( &g_MAC10, &player);
-	HUD_PrepEntity( &g_AUG, &player);
-	HUD_PrepEntity( &g_SmokeGrenade, &player);
-	HUD_PrepEntity( &g_ELITE, &player);
-	HUD_PrepEntity( &g_FiveSeven, &player);
-	HUD_PrepEntity( &g_UMP45, &player);
-	HUD_PrepEntity( &g_SG550, &player);
-	HUD_PrepEntity( &g_Galil, &player);
-	HUD_PrepEntity( &g_Famas, &player);
-	HUD_PrepEntity( &g_USP, &player);
-	HUD_PrepEntity( &g_GLOCK18, &player);
-	HUD_PrepEntity( &g_AWP, &player);
-	HUD_PrepEntity( &g_MP5N, &player);
-	HUD_PrepEntity( &g_M249, &player);
-	HUD_PrepEntity( &g_M4A1, &player);
-	HUD_PrepEntity( &g_M3, &player );
-	HUD_PrepEntity( &g_TMP, &player);
-	HUD_PrepEntity( &g_G3SG1, &player);
-	HUD_PrepEntity( &g_Flashbang, &player);
-	HUD_PrepEntity( &g_DEAGLE, &player);
-	HUD_PrepEntity( &g_SG552, &player);
-	HUD_PrepEntity( &g_AK47, &player);
-	HUD_PrepEntity( &g_Knife, &player);
-	HUD_PrepEntity( &g_P90, &player );
+	for( size_t i = 0; i < NUM_CLIENT_WEAPONS; i++ )
+		HUD_PrepEntity( g_ClientWeapons[i].weapon, &player );
 }
 
 
 int GetWeaponAccuracyFlags( int weaponid )
 {
-	int result = 0;
+	const clientweapon_t *info = GetClientWeapon( weaponid );
 
-	if( weaponid <= WEAPON_P90 )
-	{
-		switch( weaponid )
-		{
-		case WEAPON_AUG:
-		case WEAPON_GALIL:
-		case WEAPON_M249:
-		case WEAPON_SG552:
-		case WEAPON_AK47:
-		case WEAPON_P90:
-			result = ACCURACY_AIR | ACCURACY_SPEED;
-			break;
-		case WEAPON_P228:
-		case WEAPON_FIVESEVEN:
-		case WEAPON_DEAGLE:
-			result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK;
-			break;
-		case WEAPON_GLOCK18:
-			if( g_iWeaponFlags & WPNSTATE_GLOCK18_BURST_MODE)
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK;
-			}
-			else
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK | ACCURACY_MULTIPLY_BY_14_2;
-			}
-			break;
-		case WEAPON_MAC10:
-		case WEAPON_UMP45:
-		case WEAPON_MP5N:
-		case WEAPON_TMP:
-			result = ACCURACY_AIR;
-			break;
-		case WEAPON_M4A1:
-			if(g_iWeaponFlags & WPNSTATE_USP_SILENCED)
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED;
-			}
-			else
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_MULTIPLY_BY_14;
-			}
-			break;
-		case WEAPON_FAMAS:
-			if(g_iWeaponFlags & WPNSTATE_FAMAS_BURST_MODE)
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED;
-			}
-			else
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | (1<<4);
-			}
-			break;
-		case WEAPON_USP:
-			if(g_iWeaponFlags & WPNSTATE_USP_SILENCED)
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK;
-			}
-			else
-			{
-				result = ACCURACY_AIR | ACCURACY_SPEED | ACCURACY_DUCK | ACCURACY_MULTIPLY_BY_14;
-			}
-			break;
-		}
-	}
+	if( !info )
+		return 0;
+
+	if( info->altState && ( g_iWeaponFlags & info->altState ))
+		return info->altAccuracy;
 
-	return result;
+	return info->accuracy;
 }
 
 
@@ -1032,132 +1020,9 @@ void HUD_WeaponsPostThink( local_state_s *from, local_state_s *to, usercmd_t *cm
 	gpGlobals->time = time;
 
 	// Fill in data based on selected weapon
-	switch ( from->client.m_iId )
-	{
-		case WEAPON_P228:
-			pWeapon = &g_P228;
-			break;
-
-		case WEAPON_SCOUT:
-			pWeapon = &g_SCOUT;
-			break;
-
-		case WEAPON_HEGRENADE:
-			pWeapon = &g_HEGrenade;
-			break;
-
-		case WEAPON_XM1014:
-			pWeapon = &g_XM1014;
-			break;
-
-		case WEAPON_C4:
-			pWeapon = &g_C4;
-			break;
-
-		case WEAPON_MAC10:
-			pWeapon = &g_MAC10;
-			break;
-
-		case WEAPON_AUG:
-			pWeapon = &g_AUG;
-			break;
-
-		case WEAPON_SMOKEGRENADE:
-			pWeapon = &g_SmokeGrenade;
-			break;
-
-		case WEAPON_ELITE:
-			pWeapon = &g_ELITE;
-			break;
-
-		case WEAPON_FIVESEVEN:
-			pWeapon = &g_FiveSeven;
-			break;
-
-		case WEAPON_UMP45:
-			pWeapon = &g_UMP45;
-			break;
-
-		case WEAPON_SG550:
-			pWeapon = &g_SG550;
-			break;
-
-		case WEAPON_GALIL:
-			pWeapon = &g_Galil;
-			break;
-
-		case WEAPON_FAMAS:
-			pWeapon = &g_Famas;
-			break;
-
-		case WEAPON_USP:
-			pWeapon = &g_USP;
-			break;
-
-		case WEAPON_GLOCK18:
-			pWeapon = &g_GLOCK18;
-			break;
-
-		case WEAPON_AWP:
-			pWeapon = &g_AWP;
-			break;
-
-		case WEAPON_MP5N:
-			pWeapon = &g_MP5N;
-			break;
-
-		case WEAPON_M249:
-			pWeapon = &g_M249;
-			break;
-
-		case WEAPON_M3:
-			pWeapon = &g_M3;
-			break;
-
-		case WEAPON_M4A1:
-			pWeapon = &g_M4A1;
-			break;
-
-		case WEAPON_TMP:
-			pWeapon = &g_TMP;
-			break;
-
-		case WEAPON_G3SG1:
-			pWeapon = &g_G3SG1;
-			break;
-
-		case WEAPON_FLASHBANG:
-			pWeapon = &g_Flashbang;
-			break;
-
-		case WEAPON_DEAGLE:
-			pWeapon = &g_DEAGLE;
-			break;
-
-		case WEAPON_SG552:
-			pWeapon = &g_SG552;
-			break;
-
-		case WEAPON_AK47:
-			pWeapon = &g_AK47;
-			break;
-
-		case WEAPON_KNIFE:
-			pWeapon = &g_Knife;
-			break;
-
-		case WEAPON_P90:
-			pWeapon = &g_P90;
-			break;
-
-		/*case WEAPON_NONE:
-			break;
-
-		case WEAPON_GLOCK:
-		default:
-			gEngfuncs.Con_Printf("VALVEWHY: Unknown Weapon %i is active.\n", from->client.m_iId );
-			break;*/
-	}
+	const clientweapon_t *info = GetClientWeapon( from->client.m_iId );
+	if ( info )
+		pWeapon = info->weapon;
 
 	// Store pointer to our destination entity_state_t so we can get our origin, etc. from it
 	//  for setting up events on the client
@@ -1180,13 +1045,10 @@ void HUD_WeaponsPostThink( local_state_s *from, local_state_s *to, usercmd_t *cm
 	if ( !pWeapon )
 		return;
 
-	for ( i = 0; i < MAX_WEAPONS; i++ )
+	for ( i = 0; i < (int)NUM_CLIENT_WEAPONS; i++ )
 	{
-		CBasePlayerWeapon *pCurrent = g_pWpns[ i ];
-		if ( !pCurrent )
-			continue;
-
-		weapon_data_t *pfrom = from->weapondata + i;
+		CBasePlayerWeapon *pCurrent = g_ClientWeapons[ i ].weapon;
+		weapon_data_t *pfrom = from->weapondata + g_ClientWeapons[ i ].id;
 
 		pCurrent->m_fInReload			= pfrom->m_fInReload;
 		pCurrent->m_fInSpecialReload	= pfrom->m_fInSpecialReload;
@@ -1365,15 +1227,14 @@ void HUD_WeaponsPostThink( local_state_s *from, local_state_s *to, usercmd_t *cm
 
 	for ( i = 0; i < MAX_WEAPONS; i++ )
 	{
-		CBasePlayerWeapon *pCurrent = g_pWpns[ i ];
-
-		weapon_data_t *pto = to->weapondata + i;
+		if ( !GetClientWeapon( i ) )
+			memset( to->weapondata + i, 0, sizeof( weapon_data_t ) );
+	}
 
-		if ( !pCurrent )
-		{
-			memset( pto, 0, sizeof( weapon_data_t ) );
-			continue;
-		}
+	for ( i = 0; i < (int)NUM_CLIENT_WEAPONS; i++ )
+	{
+		CBasePlayerWeapon *pCurrent = g_ClientWeapons[ i ].weapon;
+		weapon_data_t *pto = to->weapondata + g_ClientWeapons[ i ].id;
 
 		pto->m_iClip					= pCurrent->m_iClip;
 
@@ -1461,9 +1322,19 @@ be ignored
 */
 void DLLEXPORT HUD_PostRunCmd( local_state_t *from, local_state_t *to, struct usercmd_s *cmd, int runfuncs, double time, unsigned int random_seed )
 {
+	bool stats = PredStats_Enabled();
+	double start = stats ? PredStats_Time() : 0;
+
 	g_runfuncs = runfuncs;
 
 	HUD_WeaponsPostThink( from, to, cmd, time, random_seed );
+
+	if ( stats )
+	{
+		PredStats_AddTime( PREDSTATS_TIMER_WEAPONS, PredStats_Time() - start );
+		PredStats_RunCmd( runfuncs );
+	}
+
 	to->client.fov = g_lastFOV;
 
 	if ( g_runfuncs )
@@ -0,0 +1,451 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "entity_state.h"
+#include "pred_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define PREDSTATS_BUCKETS	14		// timing histogram, bucket n counts samples below 2^n microseconds
+
+typedef struct predframe_s
+{
+	float time;
+	unsigned short cmds;			// HUD_PostRunCmd calls
+	unsigned short repredicted;		// ... of them for commands already predicted once
+	unsigned short acks;			// server frames compared against prediction
+	float timers[PREDSTATS_TIMERS];	// microseconds
+	byte corrections[PREDFIELD_COUNT];
+} predframe_t;
+
+static const char *s_szFieldNames[PREDFIELD_COUNT] =
+{
+	"origin",
+	"velocity",
+	"punchangle",
+	"nextattack",
+	"ammo",
+	"fov",
+	"weaponanim",
+	"weaponid",
+	"clip",
+	"nextprimary",
+	"nextsecondary",
+	"idle",
+	"reload",
+	"weaponstate",
+	"shotsfired",
+};
+
+// differences up to this much are rounding or network quantization, not a misprediction
+static const float s_flTolerance[PREDFIELD_COUNT] =
+{
+	0.125f,		// origin, units
+	1.0f,		// velocity, units per second
+	0.01f,		// punchangle, degrees
+	0.02f,		// nextattack, seconds
+	0.0f,		// ammo
+	0.0f,		// fov
+	0.0f,		// weaponanim
+	0.0f,		// weaponid
+	0.0f,		// clip
+	0.02f,		// nextprimary, seconds
+	0.02f,		// nextsecondary, seconds
+	0.02f,		// idle, seconds
+	0.0f,		// reload
+	0.0f,		// weaponstate
+	0.0f,		// shotsfired
+};
+
+static const char *s_szTimerNames[PREDSTATS_TIMERS] =
+{
+	"weapons",
+	"pmove",
+};
+
+static cvar_t *cl_predstats;
+
+static predframe_t s_Frames[PREDSTATS_WINDOW];
+static predframe_t s_Current;
+static int s_iNumFrames;		// total frames recorded, s_Frames is a ring over the last PREDSTATS_WINDOW
+
+static int s_iTotalAcks;
+static int s_iTotalCorrections[PREDFIELD_COUNT];
+static float s_flMaxError[PREDFIELD_COUNT];
+
+/*
+=====================
+PredStats_Time
+
+High resolution clock in seconds
+=====================
+*/
+double PredStats_Time( void )
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER count;
+
+	if( !freq.QuadPart )
+		QueryPerformanceFrequency( &freq );
+
+	QueryPerformanceCounter( &count );
+
+	return (double)count.QuadPart / freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+bool PredStats_Enabled( void )
+{
+	return cl_predstats && cl_predstats->value;
+}
+
+void PredStats_AddTime( int timer, double seconds )
+{
+	s_Current.timers[timer] += (float)( seconds * 1000000.0 );
+}
+
+void PredStats_RunCmd( int runfuncs )
+{
+	s_Current.cmds++;
+
+	if( !runfuncs )
+		s_Current.repredicted++;
+}
+
+static void PredStats_Check( int field, float error )
+{
+	if( error <= s_flTolerance[field] )
+		return;
+
+	if( s_Current.corrections[field] < 255 )
+		s_Current.corrections[field]++;
+
+	s_iTotalCorrections[field]++;
+
+	if( error > s_flMaxError[field] )
+		s_flMaxError[field] = error;
+}
+
+// weapon timers are clamped below zero on both sides, any negative value means "ready"
+static float PredStats_TimerError( float received, float predicted )
+{
+	return fabs( max( received, 0.0f ) - max( predicted, 0.0f ));
+}
+
+/*
+=====================
+PredStats_Compare
+
+Called from HUD_TxferPredictionData before the predicted state is copied
+over the server update, so both versions of the acknowledged frame are
+still available
+=====================
+*/
+void PredStats_Compare( const struct clientdata_s *received, const struct clientdata_s *predicted,
+	const struct weapon_data_s *wreceived, const struct weapon_data_s *wpredicted )
+{
+	if( !PredStats_Enabled() )
+		return;
+
+	// nothing is predicted while dead or observing
+	if( received->deadflag != DEAD_NO || received->iuser1 )
+		return;
+
+	s_Current.acks++;
+	s_iTotalAcks++;
+
+	PredStats_Check( PREDFIELD_ORIGIN, ( received->origin - predicted->origin ).Length() );
+	PredStats_Check( PREDFIELD_VELOCITY, ( received->velocity - predicted->velocity ).Length() );
+	PredStats_Check( PREDFIELD_PUNCHANGLE, ( received->punchangle - predicted->punchangle ).Length() );
+	PredStats_Check( PREDFIELD_NEXTATTACK, PredStats_TimerError( received->m_flNextAttack, predicted->m_flNextAttack ));
+	PredStats_Check( PREDFIELD_FOV, fabs( received->fov - predicted->fov ));
+	PredStats_Check( PREDFIELD_WEAPONANIM, received->weaponanim != predicted->weaponanim );
+	PredStats_Check( PREDFIELD_WEAPONID, received->m_iId != predicted->m_iId );
+
+	// vuser4 carries the primary ammo type and count of the active weapon
+	if( received->vuser4.x == predicted->vuser4.x )
+		PredStats_Check( PREDFIELD_AMMO, fabs( received->vuser4.y - predicted->vuser4.y ));
+
+	// only the active weapon is predicted in a meaningful way
+	int id = received->m_iId;
+
+	if( id <= 0 || id >= MAX_WEAPONS || id != predicted->m_iId )
+		return;
+
+	const struct weapon_data_s *wr = wreceived + id;
+	const struct weapon_data_s *wp = wpredicted + id;
+
+	if( wr->m_iId != id || wp->m_iId != id )
+		return;
+
+	PredStats_Check( PREDFIELD_CLIP, abs( wr->m_iClip - wp->m_iClip ));
+	PredStats_Check( PREDFIELD_NEXTPRIMARY, PredStats_TimerError( wr->m_flNextPrimaryAttack, wp->m_flNextPrimaryAttack ));
+	PredStats_Check( PREDFIELD_NEXTSECONDARY, PredStats_TimerError( wr->m_flNextSecondaryAttack, wp->m_flNextSecondaryAttack ));
+	PredStats_Check( PREDFIELD_IDLE, PredStats_TimerError( wr->m_flTimeWeaponIdle, wp->m_flTimeWeaponIdle ));
+	PredStats_Check( PREDFIELD_RELOAD, wr->m_fInReload != wp->m_fInReload || wr->m_fInSpecialReload != wp->m_fInSpecialReload );
+	PredStats_Check( PREDFIELD_WEAPONSTATE, wr->m_iWeaponState != wp->m_iWeaponState );
+	PredStats_Check( PREDFIELD_SHOTSFIRED, wr->m_fInZoom != wp->m_fInZoom );
+}
+
+/*
+=====================
+PredStats_Frame
+
+Closes the current frame sample, called once per client frame
+=====================
+*/
+void PredStats_Frame( double time )
+{
+	if( !PredStats_Enabled() )
+		return;
+
+	s_Current.time = (float)time;
+	s_Frames[s_iNumFrames & ( PREDSTATS_WINDOW - 1 )] = s_Current;
+	s_iNumFrames++;
+
+	if( cl_predstats->value >= 2 )
+	{
+		gEngfuncs.Con_NPrintf( 2, (char *)"prediction: %i cmds, %i repredicted, %i acks, weapons %.0f us, pmove %.0f us",
+			s_Current.cmds, s_Current.repredicted, s_Current.acks,
+			s_Current.timers[PREDSTATS_TIMER_WEAPONS], s_Current.timers[PREDSTATS_TIMER_PMOVE] );
+	}
+
+	memset( &s_Current, 0, sizeof( s_Current ));
+}
+
+static int PredStats_WindowFrames( void )
+{
+	return min( s_iNumFrames, PREDSTATS_WINDOW );
+}
+
+// oldest sample first
+static const predframe_t *PredStats_WindowFrame( int i )
+{
+	return &s_Frames[( s_iNumFrames - PredStats_WindowFrames() + i ) & ( PREDSTATS_WINDOW - 1 )];
+}
+
+static int PredStats_Bucket( float value )
+{
+	int bucket = 0;
+
+	while( bucket < PREDSTATS_BUCKETS - 1 && value >= (float)( 1 << bucket ))
+		bucket++;
+
+	return bucket;
+}
+
+static void PredStats_PrintHistogram( const char *label, const int *buckets, int count )
+{
+	char line[512];
+	int len;
+
+	len = _snprintf( line, sizeof( line ), "%-12s", label );
+
+	for( int i = 0; i < count && len < (int)sizeof( line ); i++ )
+		len += _snprintf( line + len, sizeof( line ) - len, " %5i", buckets[i] );
+
+	gEngfuncs.Con_Printf( "%s\n", line );
+}
+
+/*
+=====================
+PredStats_Print
+
+Console command, rolling histogram over the last PREDSTATS_WINDOW frames
+=====================
+*/
+static void PredStats_Print( void )
+{
+	int numframes = PredStats_WindowFrames();
+
+	if( !numframes )
+	{
+		gEngfuncs.Con_Printf( "No prediction samples, set cl_predstats 1 and play for a while\n" );
+		return;
+	}
+
+	int timerBuckets[PREDSTATS_TIMERS][PREDSTATS_BUCKETS];
+	int depthBuckets[PREDSTATS_BUCKETS];
+	int fieldCount[PREDFIELD_COUNT];
+	float timerMax[PREDSTATS_TIMERS], timerSum[PREDSTATS_TIMERS];
+	int cmds = 0, repredicted = 0, acks = 0, maxDepth = 0;
+
+	memset( timerBuckets, 0, sizeof( timerBuckets ));
+	memset( depthBuckets, 0, sizeof( depthBuckets ));
+	memset( fieldCount, 0, sizeof( fieldCount ));
+	memset( timerMax, 0, sizeof( timerMax ));
+	memset( timerSum, 0, sizeof( timerSum ));
+
+	for( int i = 0; i < numframes; i++ )
+	{
+		const predframe_t *frame = PredStats_WindowFrame( i );
+
+		cmds += frame->cmds;
+		repredicted += frame->repredicted;
+		acks += frame->acks;
+		maxDepth = max( maxDepth, (int)frame->repredicted );
+		depthBuckets[PredStats_Bucket( frame->repredicted )]++;
+
+		for( int t = 0; t < PREDSTATS_TIMERS; t++ )
+		{
+			timerBuckets[t][PredStats_Bucket( frame->timers[t] )]++;
+			timerSum[t] += frame->timers[t];
+			timerMax[t] = max( timerMax[t], frame->timers[t] );
+		}
+
+		for( int f = 0; f < PREDFIELD_COUNT; f++ )
+			fieldCount[f] += frame->corrections[f];
+	}
+
+	float seconds = PredStats_WindowFrame( numframes - 1 )->time - PredStats_WindowFrame( 0 )->time;
+
+	gEngfuncs.Con_Printf( "Prediction stats over %i frames (%.1f s)\n", numframes, seconds );
+	gEngfuncs.Con_Printf( "%i commands, %i repredicted (%.1f per frame, max %i), %i server frames compared\n",
+		cmds, repredicted, (float)repredicted / numframes, maxDepth, acks );
+
+	for( int t = 0; t < PREDSTATS_TIMERS; t++ )
+	{
+		gEngfuncs.Con_Printf( "%s: %.1f us per frame, max %.1f us\n",
+			s_szTimerNames[t], timerSum[t] / numframes, timerMax[t] );
+	}
+
+	// bucket 0 is "below 1", bucket n is [2^(n-1), 2^n), the last one is open ended
+	char header[512];
+	int len = _snprintf( header, sizeof( header ), "%-12s", "frames with" );
+
+	for( int i = 0; i < PREDSTATS_BUCKETS && len < (int)sizeof( header ); i++ )
+	{
+		char label[16];
+
+		if( i < PREDSTATS_BUCKETS - 1 )
+			_snprintf( label, sizeof( label ), "<%i", 1 << i );
+		else
+			_snprintf( label, sizeof( label ), "%i+", 1 << ( i - 1 ));
+
+		len += _snprintf( header + len, sizeof( header ) - len, " %5s", label );
+	}
+
+	gEngfuncs.Con_Printf( "%s\n", header );
+
+	for( int t = 0; t < PREDSTATS_TIMERS; t++ )
+	{
+		char label[32];
+
+		_snprintf( label, sizeof( label ), "%s us", s_szTimerNames[t] );
+		PredStats_PrintHistogram( label, timerBuckets[t], PREDSTATS_BUCKETS );
+	}
+
+	PredStats_PrintHistogram( "repredicted", depthBuckets, PREDSTATS_BUCKETS );
+
+	gEngfuncs.Con_Printf( "Corrections, %i server frames compared since reset\n", s_iTotalAcks );
+	gEngfuncs.Con_Printf( "%-14s %8s %8s %10s\n", "field", "window", "total", "max error" );
+
+	for( int f = 0; f < PREDFIELD_COUNT; f++ )
+	{
+		gEngfuncs.Con_Printf( "%-14s %8i %8i %10.3f\n",
+			s_szFieldNames[f], fieldCount[f], s_iTotalCorrections[f], s_flMaxError[f] );
+	}
+}
+
+/*
+=====================
+PredStats_Dump
+
+Console command, writes the rolling window as CSV into the game directory
+=====================
+*/
+static void PredStats_Dump( void )
+{
+	char filename[256];
+	const char *name = gEngfuncs.Cmd_Argc() > 1 ? gEngfuncs.Cmd_Argv( 1 ) : "predstats.csv";
+
+	_snprintf( filename, sizeof( filename ), "%s/%s", gEngfuncs.pfnGetGameDirectory(), name );
+
+	FILE *f = fopen( filename, "w" );
+
+	if( !f )
+	{
+		gEngfuncs.Con_Printf( "Couldn't open %s for writing\n", filename );
+		return;
+	}
+
+	fprintf( f, "time,cmds,repredicted,acks" );
+
+	for( int t = 0; t < PREDSTATS_TIMERS; t++ )
+		fprintf( f, ",%s_us", s_szTimerNames[t] );
+
+	for( int i = 0; i < PREDFIELD_COUNT; i++ )
+		fprintf( f, ",%s", s_szFieldNames[i] );
+
+	fprintf( f, "\n" );
+
+	int numframes = PredStats_WindowFrames();
+
+	for( int i = 0; i < numframes; i++ )
+	{
+		const predframe_t *frame = PredStats_WindowFrame( i );
+
+		fprintf( f, "%.4f,%i,%i,%i", frame->time, frame->cmds, frame->repredicted, frame->acks );
+
+		for( int t = 0; t < PREDSTATS_TIMERS; t++ )
+			fprintf( f, ",%.1f", frame->timers[t] );
+
+		for( int c = 0; c < PREDFIELD_COUNT; c++ )
+			fprintf( f, ",%i", frame->corrections[c] );
+
+		fprintf( f, "\n" );
+	}
+
+	fclose( f );
+
+	gEngfuncs.Con_Printf( "Wrote %i frames to %s\n", numframes, filename );
+}
+
+static void PredStats_Reset( void )
+{
+	memset( &s_Current, 0, sizeof( s_Current ));
+	s_iNumFrames = 0;
+	s_iTotalAcks = 0;
+	memset( s_iTotalCorrections, 0, sizeof( s_iTotalCorrections ));
+	memset( s_flMaxError, 0, sizeof( s_flMaxError ));
+}
+
+void PredStats_Init( void )
+{
+	// 0 - off, 1 - record, 2 - record and show the last frame on screen
+	cl_predstats = CVAR_CREATE( "cl_predstats", "0", 0 );
+
+	gEngfuncs.pfnAddCommand( "predstats", PredStats_Print );
+	gEngfuncs.pfnAddCommand( "predstats_dump", PredStats_Dump );
+	gEngfuncs.pfnAddCommand( "predstats_reset", PredStats_Reset );
+}
@@ -19,6 +19,7 @@
 #include "studio_event.h" // def. of mstudioevent_t
 #include "r_efx.h"
 #include "event_api.h"
+#include "pred_stats.h"
 
 extern vec3_t v_origin;
 
@@ -170,6 +171,8 @@ Because we can predict an arbitrary number of frames before the server responds
 */
 void DLLEXPORT HUD_TxferPredictionData ( struct entity_state_s *ps, const struct entity_state_s *pps, struct clientdata_s *pcd, const struct clientdata_s *ppcd, struct weapon_data_s *wd, const struct weapon_data_s *pwd )
 {
+	PredStats_Compare( pcd, ppcd, wd, pwd );
+
 	ps->oldbuttons = pps->oldbuttons;
 	ps->flFallVelocity = pps->flFallVelocity;
 	ps->iStepLeft = pps->iStepLeft;
@@ -41,6 +41,7 @@
 #include "pm_shared.h"
 
 extern float g_flRoundTime;
+extern vec3_t v_origin;
 
 // play a strike sound based on the texture that was hit by the attack traceline.  VecSrc/VecEnd are the
 // original traceline endpoints used by the attacker, iBulletType is the type of bullet that hit the texture.
@@ -100,14 +101,11 @@ void EV_HLDM_NewExplode( float x, float y, float z, float ScaleExplode1 )
 
 }
 
-char EV_HLDM_PlayTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *vecEnd, int iBulletType, bool& isSky )
+// material of the surface hit by the attack traceline, VecSrc/VecEnd are its endpoints
+char EV_HLDM_GetTextureType( int idx, pmtrace_t *ptr, float *vecSrc, float *vecEnd, bool& isSky )
 {
-	// hit the world, try to play sound based on texture material type
+	// hit the world, try to find texture material type
 	char chTextureType = CHAR_TEX_CONCRETE;
-	float fvol;
-	const char *rgsz[4];
-	int cnt;
-	float fattn = ATTN_NORM;
 	int entity;
 	char *pTextureName;
 	char texname[ 64 ];
@@ -160,6 +158,17 @@ char EV_HLDM_PlayTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *ve
 		}
 	}
 
+	return chTextureType;
+}
+
+// play a strike sound for the material found by EV_HLDM_GetTextureType
+void EV_HLDM_PlayTextureTypeSound( pmtrace_t *ptr, char chTextureType )
+{
+	float fvol;
+	const char *rgsz[4];
+	int cnt;
+	float fattn = ATTN_NORM;
+
 	switch (chTextureType)
 	{
 	default:
@@ -266,8 +275,6 @@ char EV_HLDM_PlayTextureSound( int idx, pmtrace_t *ptr, float *vecSrc, float *ve
 
 	// play material hit sound
 	gEngfuncs.pEventAPI->EV_PlaySound( 0, ptr->endpos, CHAN_STATIC, rgsz[Com_RandomLong(0,cnt-1)], fvol, fattn, 0, 96 + Com_RandomLong(0,0xf) );
-
-	return chTextureType;
 }
 
 char *EV_HLDM_DamageDecal( physent_t *pe )
@@ -499,6 +506,100 @@ void EV_CS16Client_CreateSmoke(int type, Vector origin, Vector dir, int speed, f
 }
 
 
+#define IMPACT_HISTORY		64		// recent impacts that can absorb new ones
+#define IMPACT_MERGE_TIME	0.25f	// seconds an impact keeps absorbing nearby ones
+#define IMPACT_AREA_RADIUS	128.0f	// radius cl_impact_area_budget is counted in
+
+enum
+{
+	IMPACT_SPARKS   = (1<<0),
+	IMPACT_WALLPUFF = (1<<1)
+};
+
+typedef struct impact_history_s
+{
+	Vector origin;
+	float time;
+} impact_history_t;
+
+static impact_history_t g_ImpactHistory[IMPACT_HISTORY];
+static int g_iImpactHistoryCount;
+static int g_iImpactHistoryHead;
+static float g_flImpactFrameTime;
+static int g_iImpactFrameCount;
+
+/*
+============
+EV_HLDM_ImpactEffects
+
+Returns which of the requested tempent effects an impact may spawn.
+Drops the ones that are too far from the view, coalesce with a recent impact
+or exceed the per-frame or per-area budget.
+============
+*/
+int EV_HLDM_ImpactEffects( const Vector &origin, int effects )
+{
+	float time = gEngfuncs.GetClientTime();
+	int budget = gHUD.cl_impact_budget->value;
+	int areaBudget = gHUD.cl_impact_area_budget->value;
+	float lod = gHUD.cl_impact_lod->value;
+	float merge = gHUD.cl_impact_merge->value;
+	int i, area = 0;
+
+	// level change or demo rewind
+	if( time < g_flImpactFrameTime )
+		g_iImpactHistoryCount = g_iImpactHistoryHead = 0;
+
+	if( time != g_flImpactFrameTime )
+	{
+		g_flImpactFrameTime = time;
+		g_iImpactFrameCount = 0;
+	}
+
+	if( lod > 0.0f )
+	{
+		float dist = ( origin - v_origin ).Length();
+
+		if( dist > lod )
+			effects &= ~IMPACT_SPARKS;
+
+		if( dist > lod * 2.0f )
+			effects &= ~IMPACT_WALLPUFF;
+	}
+
+	if( !effects || ( budget > 0 && g_iImpactFrameCount >= budget ) )
+		return 0;
+
+	for( i = 0; i < g_iImpactHistoryCount; i++ )
+	{
+		impact_history_t *h = &g_ImpactHistory[i];
+
+		if( time - h->time > IMPACT_MERGE_TIME )
+			continue;
+
+		float dist = ( h->origin - origin ).Length();
+
+		if( dist < merge )
+			return 0; // the earlier impact's smoke covers this one
+
+		if( dist < IMPACT_AREA_RADIUS )
+			area++;
+	}
+
+	if( areaBudget > 0 && area >= areaBudget )
+		return 0;
+
+	g_ImpactHistory[g_iImpactHistoryHead].origin = origin;
+	g_ImpactHistory[g_iImpactHistoryHead].time = time;
+	g_iImpactHistoryHead = ( g_iImpactHistoryHead + 1 ) % IMPACT_HISTORY;
+	if( g_iImpactHistoryCount < IMPACT_HISTORY )
+		g_iImpactHistoryCount++;
+
+	g_iImpactFrameCount++;
+
+	return effects;
+}
+
 void EV_HLDM_DecalGunshot(pmtrace_t *pTrace, int iBulletType, float scale, int r, int g, int b, bool bCreateWallPuff, bool bCreateSparks, char cTextureType, bool isSky)
 {
 	physent_t *pe;
@@ -510,10 +611,22 @@ void EV_HLDM_DecalGunshot(pmtrace_t *pTrace, int iBulletType, float scale, int r
 
 	if ( pe && pe->solid == SOLID_BSP )
 	{
+		int effects = 0;
+
 		EV_HLDM_GunshotDecalTrace( pTrace, EV_HLDM_DamageDecal( pe ), cTextureType );
 
-		// create sparks
 		if( gHUD.cl_weapon_sparks && gHUD.cl_weapon_sparks->value && bCreateSparks )
+			effects |= IMPACT_SPARKS;
+
+		if( gHUD.cl_weapon_wallpuff && gHUD.cl_weapon_wallpuff->value && bCreateWallPuff )
+			effects |= IMPACT_WALLPUFF;
+
+		// decals are always placed, the engine recycles them on its own
+		if( effects )
+			effects = EV_HLDM_ImpactEffects( pTrace->endpos, effects );
+
+		// create sparks
+		if( effects & IMPACT_SPARKS )
 		{
 			Vector dir = pTrace->plane.normal;
 			dir.x = dir.x * dir.x * gEngfuncs.pfnRandomFloat( 4.0f, 12.0f );
@@ -523,7 +636,7 @@ void EV_HLDM_DecalGunshot(pmtrace_t *pTrace, int iBulletType, float scale, int r
 		}
 
 		// create wallpuff
-		if( gHUD.cl_weapon_wallpuff && gHUD.cl_weapon_wallpuff->value && bCreateWallPuff )
+		if( effects & IMPACT_WALLPUFF )
 		{
 			EV_CS16Client_CreateSmoke( SMOKE_WALLPUFF, pTrace->endpos, pTrace->plane.normal, 25, 0.5, r, g, b, true );
 		}
@@ -609,11 +722,49 @@ void EV_DescribeBulletTypeParameters(int iBulletType, int &iPenetrationPower, fl
 
 
 
+#define EV_MAX_IMPACTS			64		// surfaces hit by all pellets of one event, including penetration exits
+#define EV_IMPACT_MERGE_DIST	2.0f	// impacts this close on the same entity get one set of effects
+
+typedef struct ev_impact_s
+{
+	pmtrace_t tr;
+	char cTextureType;
+	bool isSky;
+	bool bExit;		// far side of a penetrated surface, decal only
+	bool bSparks;
+	int r_smoke, g_smoke, b_smoke;
+} ev_impact_t;
+
+/*
+================
+EV_HLDM_IsDuplicateImpact
+
+Pellets of one blast often land on top of each other, don't stack their effects
+================
+*/
+bool EV_HLDM_IsDuplicateImpact( ev_impact_t *impacts, int index )
+{
+	ev_impact_t *impact = &impacts[index];
+
+	for( int i = 0; i < index; i++ )
+	{
+		if( impacts[i].tr.ent != impact->tr.ent || impacts[i].bExit != impact->bExit )
+			continue;
+
+		if( ( impacts[i].tr.endpos - impact->tr.endpos ).Length() < EV_IMPACT_MERGE_DIST )
+			return true;
+	}
+
+	return false;
+}
+
 /*
 ================
 EV_HLDM_FireBullets
 
 Go to the trouble of combining multiple pellets into a single damage call.
+Players are made solid once for the whole event, every pellet and penetration step
+is traced first, then sounds, decals and smoke are emitted for the collected impacts.
 ================
 */
 void EV_HLDM_FireBullets(int idx,
@@ -627,14 +778,27 @@ void EV_HLDM_FireBullets(int idx,
 	int iShot;
 	int iPenetrationPower;
 	float flPenetrationDistance;
-	bool isSky;
+	ev_impact_t impacts[EV_MAX_IMPACTS];
+	int numImpacts = 0;
 
 	EV_DescribeBulletTypeParameters( iBulletType, iPenetrationPower, flPenetrationDistance );
 
+	gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
+
+	// Store off the old count
+	gEngfuncs.pEventAPI->EV_PushPMStates();
+
+	// Now add in all of the players.
+	gEngfuncs.pEventAPI->EV_SetSolidPlayers ( idx - 1 );
+
+	gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+
 	for ( iShot = 1; iShot <= cShots; iShot++ )
 	{
 		Vector vecShotSrc = vecSrc;
 		int iShotPenetration = iPenetration;
+		int iShotPenetrationPower = iPenetrationPower;
+		float flShotDistance = flDistance;
 		Vector vecDir, vecEnd;
 
 		if ( iBulletType == BULLET_PLAYER_BUCKSHOT )
@@ -650,7 +814,7 @@ void EV_HLDM_FireBullets(int idx,
 			for ( i = 0 ; i < 3; i++ )
 			{
 				vecDir[i] = vecDirShooting[i] + x * vecSpread[0] * right[ i ] + y * vecSpread[1] * up [ i ];
-				vecEnd[i] = vecShotSrc[ i ] + flDistance * vecDir[ i ];
+				vecEnd[i] = vecShotSrc[ i ] + flShotDistance * vecDir[ i ];
 			}
 		}
 		else //But other guns already have their spread randomized in the synched spread.
@@ -658,24 +822,15 @@ void EV_HLDM_FireBullets(int idx,
 			for ( i = 0 ; i < 3; i++ )
 			{
 				vecDir[i] = vecDirShooting[i] + vecSpread[0] * right[ i ] + vecSpread[1] * up [ i ];
-				vecEnd[i] = vecShotSrc[ i ] + flDistance * vecDir[ i ];
+				vecEnd[i] = vecShotSrc[ i ] + flShotDistance * vecDir[ i ];
 			}
 		}
 
-		gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
-
-		// Store off the old count
-		gEngfuncs.pEventAPI->EV_PushPMStates();
-
-		// Now add in all of the players.
-		gEngfuncs.pEventAPI->EV_SetSolidPlayers ( idx - 1 );
-
-		while (iShotPenetration != 0)
+		while (iShotPenetration != 0 && numImpacts < EV_MAX_IMPACTS)
 		{
-			gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
 			gEngfuncs.pEventAPI->EV_PlayerTrace( vecShotSrc, vecEnd, 0, -1, &tr );
 
-			float flCurrentDistance = tr.fraction * flDistance;
+			float flCurrentDistance = tr.fraction * flShotDistance;
 
 			if( flCurrentDistance == 0.0f )
 			{
@@ -686,64 +841,84 @@ void EV_HLDM_FireBullets(int idx,
 				iShotPenetration = 0;
 			else iShotPenetration--;
 
-			char cTextureType = EV_HLDM_PlayTextureSound(idx, &tr, vecShotSrc, vecEnd, iBulletType, isSky );
-			bool bSparks = true;
-			int r_smoke, g_smoke, b_smoke;
-			r_smoke = g_smoke = b_smoke = 40;
+			ev_impact_t *impact = &impacts[numImpacts++];
 
-			switch (cTextureType)
+			impact->tr = tr;
+			impact->bExit = false;
+			impact->bSparks = true;
+			impact->cTextureType = EV_HLDM_GetTextureType( idx, &tr, vecShotSrc, vecEnd, impact->isSky );
+			impact->r_smoke = impact->g_smoke = impact->b_smoke = 40;
+
+			switch (impact->cTextureType)
 			{
 			case CHAR_TEX_METAL:
-				iPenetrationPower *= 0.15;
+				iShotPenetrationPower *= 0.15;
 				break;
 			case CHAR_TEX_CONCRETE:
-				r_smoke = g_smoke = b_smoke = 65;
-				iPenetrationPower *= 0.25;
+				impact->r_smoke = impact->g_smoke = impact->b_smoke = 65;
+				iShotPenetrationPower *= 0.25;
 				break;
 			case CHAR_TEX_VENT:
 			case CHAR_TEX_GRATE:
-				iPenetrationPower *= 0.5;
+				iShotPenetrationPower *= 0.5;
 				break;
 			case CHAR_TEX_TILE:
-				iPenetrationPower *= 0.65;
+				iShotPenetrationPower *= 0.65;
 				break;
 			case CHAR_TEX_COMPUTER:
-				iPenetrationPower *= 0.4;
+				iShotPenetrationPower *= 0.4;
 				break;
 			case CHAR_TEX_WOOD:
-				bSparks = false;
-				r_smoke = 75;
-				g_smoke = 42;
-				b_smoke = 15;
+				impact->bSparks = false;
+				impact->r_smoke = 75;
+				impact->g_smoke = 42;
+				impact->b_smoke = 15;
 				break;
 			}
 
-			// do damage, paint decals
-			EV_HLDM_DecalGunshot( &tr, iBulletType, 0, r_smoke, g_smoke, b_smoke, true, bSparks, cTextureType, isSky );
-
-			if(/* iBulletType == BULLET_PLAYER_BUCKSHOT ||*/ iShotPenetration <= 0 )
+			if(/* iBulletType == BULLET_PLAYER_BUCKSHOT ||*/ iShotPenetration <= 0 || numImpacts == EV_MAX_IMPACTS )
 			{
 				break;
 			}
 
-			flDistance = (flDistance - flCurrentDistance) * 0.5;
-			for( int i = 0; i < 3; i++ )
+			flShotDistance = (flShotDistance - flCurrentDistance) * 0.5;
+			for( i = 0; i < 3; i++ )
 			{
-				vecShotSrc[i] = tr.endpos[i]  + iPenetrationPower * vecDir[i];
-				vecEnd[i]     = vecShotSrc[i] + flDistance        * vecDir[i];
+				vecShotSrc[i] = tr.endpos[i]  + iShotPenetrationPower * vecDir[i];
+				vecEnd[i]     = vecShotSrc[i] + flShotDistance        * vecDir[i];
 			}
 
-
-			// trace back, so we will have a decal on the other side of solid area
+			// trace back to the entry point, so we will have a decal on the other side of solid area
 			pmtrace_t trOriginal;
-			gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-			gEngfuncs.pEventAPI->EV_PlayerTrace(vecShotSrc, vecSrc, 0, -1, &trOriginal);
-			if( !trOriginal.startsolid )
-				EV_HLDM_DecalGunshot( &trOriginal, iBulletType, 0, r_smoke, g_smoke, b_smoke, true, bSparks, cTextureType, isSky );
+			gEngfuncs.pEventAPI->EV_PlayerTrace( vecShotSrc, tr.endpos, 0, -1, &trOriginal );
+			if( !trOriginal.startsolid && trOriginal.fraction < 1.0f )
+			{
+				ev_impact_t *exit = &impacts[numImpacts++];
+
+				*exit = *impact;
+				exit->tr = trOriginal;
+				exit->bExit = true;
+			}
 		}
-		gEngfuncs.pEventAPI->EV_PopPMStates();
 	}
 
+	// physents must stay as they were traced, impacts refer to them by index
+	for( i = 0; i < numImpacts; i++ )
+	{
+		ev_impact_t *impact = &impacts[i];
+
+		if( EV_HLDM_IsDuplicateImpact( impacts, i ) )
+			continue;
+
+		if( !impact->bExit )
+			EV_HLDM_PlayTextureTypeSound( &impact->tr, impact->cTextureType );
+
+		// do damage, paint decals
+		EV_HLDM_DecalGunshot( &impact->tr, iBulletType, 0, impact->r_smoke, impact->g_smoke, impact->b_smoke,
+							  true, impact->bSparks, impact->cTextureType, impact->isSky );
+	}
+
+	gEngfuncs.pEventAPI->EV_PopPMStates();
 }
 
 void EV_CS16Client_KillEveryRound( TEMPENTITY *te, float frametime, float current_time )
@@ -38,6 +38,9 @@ struct DeathNoticeItem {
 	float *KillerColor;
 	float *VictimColor;
 	int iHeadShotId;
+	int iKillerLen;	// console widths of the names, measured with hud_textmode iLenMode
+	int iVictimLen;
+	int iLenMode;
 };
 
 #define MAX_DEATHNOTICES	4
@@ -74,6 +77,13 @@ int CHudDeathNotice :: VidInit( void )
 	return 1;
 }
 
+static void MeasureDeathNotice( DeathNoticeItem *item )
+{
+	item->iLenMode = gHUD.hud_textmode->value;
+	item->iKillerLen = DrawUtils::ConsoleStringLen( item->szKiller );
+	item->iVictimLen = DrawUtils::ConsoleStringLen( item->szVictim );
+}
+
 int CHudDeathNotice :: Draw( float flTime )
 {
 	int x, y, r, g, b, i;
@@ -107,14 +117,17 @@ int CHudDeathNotice :: Draw( float flTime )
 				y = ScreenHeight / 5 + 2 + (20 * i);
 			}
 
+			if( rgDeathNoticeList[i].iLenMode != (int)gHUD.hud_textmode->value )
+				MeasureDeathNotice( &rgDeathNoticeList[i] );
+
 			int id = (rgDeathNoticeList[i].iId == -1) ? m_HUD_d_skull : rgDeathNoticeList[i].iId;
-			x = ScreenWidth - DrawUtils::ConsoleStringLen(rgDeathNoticeList[i].szVictim) - (gHUD.GetSpriteRect(id).right - gHUD.GetSpriteRect(id).left);
+			x = ScreenWidth - rgDeathNoticeList[i].iVictimLen - (gHUD.GetSpriteRect(id).right - gHUD.GetSpriteRect(id).left);
 			if( rgDeathNoticeList[i].iHeadShotId )
 				x -= gHUD.GetSpriteRect(m_HUD_d_headshot).right - gHUD.GetSpriteRect(m_HUD_d_headshot).left;
 
 			if ( !rgDeathNoticeList[i].bSuicide )
 			{
-				x -= (5 + DrawUtils::ConsoleStringLen( rgDeathNoticeList[i].szKiller ) );
+				x -= (5 + rgDeathNoticeList[i].iKillerLen );
 
 				// Draw killers name
 				if ( rgDeathNoticeList[i].KillerColor )
@@ -195,16 +208,19 @@ int CHudDeathNotice :: MsgFunc_DeathMsg( const char *pszName, int iSize, void *p
 
 	// Get the Killer's name
 	const char *killer_name = g_PlayerInfoList[ killer ].name;
+	rgDeathNoticeList[i].iLenMode = gHUD.hud_textmode->value;
 	if ( !killer_name )
 	{
 		killer_name = "";
 		rgDeathNoticeList[i].szKiller[0] = 0;
+		rgDeathNoticeList[i].iKillerLen = 0;
 	}
 	else
 	{
 		rgDeathNoticeList[i].KillerColor = GetClientColor( killer );
 		strncpy( rgDeathNoticeList[i].szKiller, killer_name, MAX_PLAYER_NAME_LENGTH );
 		rgDeathNoticeList[i].szKiller[MAX_PLAYER_NAME_LENGTH-1] = 0;
+		rgDeathNoticeList[i].iKillerLen = gHUD.m_Scoreboard.GetPlayerNameLen( killer );
 	}
 
 	// Get the Victim's name
@@ -216,12 +232,14 @@ int CHudDeathNotice :: MsgFunc_DeathMsg( const char *pszName, int iSize, void *p
 	{
 		victim_name = "";
 		rgDeathNoticeList[i].szVictim[0] = 0;
+		rgDeathNoticeList[i].iVictimLen = 0;
 	}
 	else
 	{
 		rgDeathNoticeList[i].VictimColor = GetClientColor( victim );
 		strncpy( rgDeathNoticeList[i].szVictim, victim_name, MAX_PLAYER_NAME_LENGTH );
 		rgDeathNoticeList[i].szVictim[MAX_PLAYER_NAME_LENGTH-1] = 0;
+		rgDeathNoticeList[i].iVictimLen = gHUD.m_Scoreboard.GetPlayerNameLen( victim );
 	}
 
 	// Is it a non-player object kill?
@@ -231,6 +249,7 @@ int CHudDeathNotice :: MsgFunc_DeathMsg( const char *pszName, int iSize, void *p
 
 		// Store the object's name in the Victim slot (skip the d_ bit)
 		strncpy( rgDeathNoticeList[i].szVictim, killedwith+2, sizeof(killedwith) );
+		rgDeathNoticeList[i].iVictimLen = DrawUtils::ConsoleStringLen( rgDeathNoticeList[i].szVictim );
 	}
 	else
 	{
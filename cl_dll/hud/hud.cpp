@@ -39,7 +39,7 @@ extern client_sprite_t *GetSpriteList(client_sprite_t *pList, const char *psz, i
 
 wrect_t nullrc = { 0, 0, 0, 0 };
 float g_lastFOV = 0.0;
-const char *sPlayerModelFiles[12] =
+const char *sPlayerModelFiles[MAX_PLAYER_MODELS] =
 {
 	"models/player.mdl",
 	"models/player/leet/leet.mdl", // t
@@ -180,11 +180,16 @@ void CHud :: Init( void )
 	cl_android_force_defaults  = CVAR_CREATE( "cl_android_force_defaults", "1", FCVAR_ARCHIVE );
 #endif
 	cl_shadows   = CVAR_CREATE( "cl_shadows", "1", FCVAR_ARCHIVE );
+	cl_shadows_distance = CVAR_CREATE( "cl_shadows_distance", "2048", FCVAR_ARCHIVE );
 	default_fov  = CVAR_CREATE( "default_fov", "90", 0 );
 	m_pCvarDraw  = CVAR_CREATE( "hud_draw", "1", FCVAR_ARCHIVE );
 	cl_gunsmoke  = CVAR_CREATE( "cl_gunsmoke", "0", FCVAR_ARCHIVE );
 	cl_weapon_sparks = CVAR_CREATE( "cl_weapon_sparks", "1", FCVAR_ARCHIVE );
 	cl_weapon_wallpuff = CVAR_CREATE( "cl_weapon_wallpuff", "1", FCVAR_ARCHIVE );
+	cl_impact_budget = CVAR_CREATE( "cl_impact_budget", "16", FCVAR_ARCHIVE );
+	cl_impact_area_budget = CVAR_CREATE( "cl_impact_area_budget", "6", FCVAR_ARCHIVE );
+	cl_impact_merge = CVAR_CREATE( "cl_impact_merge", "8", FCVAR_ARCHIVE );
+	cl_impact_lod = CVAR_CREATE( "cl_impact_lod", "1500", FCVAR_ARCHIVE );
 	zoom_sens_ratio = CVAR_CREATE( "zoom_sensitivity_ratio", "1.2", 0 );
 	sv_skipshield = gEngfuncs.pfnGetCvarPointer( "sv_skipshield" );
 
@@ -32,6 +32,7 @@
 hud_player_info_t   g_PlayerInfoList[MAX_PLAYERS+1]; // player info from the engine
 extra_player_info_t	g_PlayerExtraInfo[MAX_PLAYERS+1]; // additional player info sent directly to the client dll
 team_info_t         g_TeamInfo[MAX_TEAMS+1];
+player_info_cache_t g_PlayerInfoCache[MAX_PLAYERS+1]; // pre-formatted strings for the above
 hostage_info_t      g_HostageInfo[MAX_HOSTAGES+1];
 int g_iUser1;
 int g_iUser2;
@@ -120,6 +121,8 @@ void CHudScoreboard :: InitHUDData( void )
 	m_iPlayerNum = 0;
 	m_iNumTeams = 0;
 	memset( g_TeamInfo, 0, sizeof g_TeamInfo );
+	ResetSortedPlayers();
+	ResetPlayerInfoCache();
 
 	m_iFlags &= ~HUD_DRAW;  // starts out inactive
 
@@ -198,7 +201,6 @@ int CHudScoreboard :: DrawScoreboard( float fTime )
 
 int CHudScoreboard :: DrawTeams( float list_slot )
 {
-	int j;
 	int ypos = ystart + (list_slot * ROW_GAP) + 5;
 
 	// clear out team scores
@@ -208,42 +210,33 @@ int CHudScoreboard :: DrawTeams( float list_slot )
 			g_TeamInfo[i].frags = g_TeamInfo[i].deaths = 0;
 		g_TeamInfo[i].sumping = 0;
 		g_TeamInfo[i].players = 0;
+		g_TeamInfo[i].ownteam = FALSE;
 		g_TeamInfo[i].already_drawn = FALSE;
 	}
 
 	// recalc the team scores, then draw them
-	for ( int i = 1; i < MAX_PLAYERS; i++ )
+	for ( int j = 1; j <= m_iNumTeams; j++ )
 	{
-		if ( !g_PlayerInfoList[i].name || !g_PlayerInfoList[i].name[0] )
-			continue; // empty player slot, skip
-
-		if ( g_PlayerExtraInfo[i].teamname[0] == 0 )
-			continue; // skip over players who are not in a team
-
-		// find what team this player is in
-		for ( j = 1; j <= m_iNumTeams; j++ )
+		for ( int k = 0; k < m_iNumTeamPlayers[j]; k++ )
 		{
-			if ( !stricmp( g_PlayerExtraInfo[i].teamname, g_TeamInfo[j].name ) )
-				break;
-		}
+			int i = m_iTeamPlayers[j][k];
 
-		if ( j > m_iNumTeams )  // player is not in a team, skip to the next guy
-			continue;
+			if ( !g_PlayerInfoList[i].name || !g_PlayerInfoList[i].name[0] )
+				continue; // empty player slot, skip
 
-		if ( !g_TeamInfo[j].scores_overriden )
-		{
-			g_TeamInfo[j].frags += g_PlayerExtraInfo[i].frags;
-			g_TeamInfo[j].deaths += g_PlayerExtraInfo[i].deaths;
-		}
+			if ( !g_TeamInfo[j].scores_overriden )
+			{
+				g_TeamInfo[j].frags += g_PlayerExtraInfo[i].frags;
+				g_TeamInfo[j].deaths += g_PlayerExtraInfo[i].deaths;
+			}
 
-		g_TeamInfo[j].sumping += g_PlayerInfoList[i].ping;
+			g_TeamInfo[j].sumping += g_PlayerInfoList[i].ping;
 
-		if ( g_PlayerInfoList[i].thisplayer )
-			g_TeamInfo[j].ownteam = TRUE;
-		else
-			g_TeamInfo[j].ownteam = FALSE;
+			if ( g_PlayerInfoList[i].thisplayer )
+				g_TeamInfo[j].ownteam = TRUE;
 
-		g_TeamInfo[j].players++;
+			g_TeamInfo[j].players++;
+		}
 	}
 
 	// Draw the teams
@@ -260,7 +253,7 @@ int CHudScoreboard :: DrawTeams( float list_slot )
 			if ( g_TeamInfo[i].players <= 0 )
 				continue;
 
-			if (!strnicmp(g_TeamInfo[i].name, "SPECTATOR", MAX_TEAM_NAME))
+			if ( g_TeamInfo[i].spectator )
 			{
 				iSpectatorPos = i;
 				continue;
@@ -326,45 +319,29 @@ int CHudScoreboard :: DrawTeams( float list_slot )
 
 		list_slot += 0.4f;
 		// draw all the players that belong to this team, indented slightly
-		list_slot = DrawPlayers( list_slot, 10, team_info->name );
+		list_slot = DrawPlayers( list_slot, 10, best_team );
 	}
 
 	// draw all the players who are not in a team
 	list_slot += 4.0f;
-	DrawPlayers( list_slot, 0, "" );
+	DrawPlayers( list_slot, 0, 0 );
 
 	return 1;
 }
 
 // returns the ypos where it finishes drawing
-int CHudScoreboard :: DrawPlayers( float list_slot, int nameoffset, const char *team )
+int CHudScoreboard :: DrawPlayers( float list_slot, int nameoffset, int team )
 {
-	// draw the players, in order,  and restricted to team if set
-	while ( 1 )
-	{
-		// Find the top ranking player
-		int highest_frags = -99999;	int lowest_deaths = 99999;
-		int best_player = 0;
+	const int *players = team < 0 ? m_iSortedPlayers : m_iTeamPlayers[team];
+	const int numPlayers = team < 0 ? MAX_PLAYERS - 1 : m_iNumTeamPlayers[team];
 
-		for ( int i = 1; i < MAX_PLAYERS; i++ )
-		{
-			if ( g_PlayerInfoList[i].name && g_PlayerExtraInfo[i].frags >= highest_frags )
-			{
-				if ( !(team && stricmp(g_PlayerExtraInfo[i].teamname, team)) )  // make sure it is the specified team
-				{
-					extra_player_info_t *pl_info = &g_PlayerExtraInfo[i];
-					if ( pl_info->frags > highest_frags || pl_info->deaths < lowest_deaths )
-					{
-						best_player = i;
-						lowest_deaths = pl_info->deaths;
-						highest_frags = pl_info->frags;
-					}
-				}
-			}
-		}
+	// draw the players, in order, and restricted to team if set
+	for ( int k = 0; k < numPlayers; k++ )
+	{
+		int best_player = players[k];
 
-		if ( !best_player )
-			break;
+		if ( !g_PlayerInfoList[best_player].name || !g_PlayerInfoList[best_player].name[0] )
+			continue; // empty player slot, skip
 
 		// draw out the best player
 		hud_player_info_t *pl_info = &g_PlayerInfoList[best_player];
@@ -405,9 +382,7 @@ int CHudScoreboard :: DrawPlayers( float list_slot, int nameoffset, const char *
 		// draw money
 		if ( g_PlayerExtraInfo[best_player].account != -1 )
 		{
-			char moneyInfo[32];
-			_snprintf( moneyInfo, sizeof( moneyInfo ), "$%i", g_PlayerExtraInfo[best_player].account );
-			DrawUtils::DrawHudStringReverse( MONEY_POS_END( ), ypos, MONEY_POS_START( ), moneyInfo, r, g, b );
+			DrawUtils::DrawHudStringReverse( MONEY_POS_END( ), ypos, MONEY_POS_START( ), g_PlayerInfoCache[best_player].moneystr, r, g, b );
 		}
 
 		// draw kills (right to left)
@@ -417,21 +392,16 @@ int CHudScoreboard :: DrawPlayers( float list_slot, int nameoffset, const char *
 		DrawUtils::DrawHudNumberString( DEATHS_POS_END(), ypos, DEATHS_POS_START(), g_PlayerExtraInfo[best_player].deaths, r, g, b );
 
 		// draw ping & packetloss
-		const char *value;
 		if( pl_info->ping <= 5  // must be 0, until Xash's bug not fixed
-			&& ( value = gEngfuncs.PlayerInfo_ValueForKey( best_player, "*bot" ) )
-			&& atoi( value ) > 0 )
+			&& g_PlayerInfoCache[best_player].bot )
 		{
 			DrawUtils::DrawHudStringReverse( PING_POS_END(), ypos, PING_POS_START(), "BOT", r, g, b );
 		}
 		else
 		{
-			static char buf[64];
-			sprintf( buf, "%d", pl_info->ping );
-			DrawUtils::DrawHudStringReverse( PING_POS_END(), ypos, PING_POS_START(), buf, r, g, b );
+			DrawUtils::DrawHudStringReverse( PING_POS_END(), ypos, PING_POS_START(), g_PlayerInfoCache[best_player].pingstr, r, g, b );
 		}
-	
-		pl_info->name = NULL;  // set the name to be NULL, so this client won't get drawn again
+
 		list_slot++;
 	}
 
@@ -446,12 +416,80 @@ void CHudScoreboard :: GetAllPlayersInfo( void )
 	for ( int i = 1; i < MAX_PLAYERS; i++ )
 	{
 		GetPlayerInfo( i, &g_PlayerInfoList[i] );
+		UpdatePlayerInfoCache( i );
 
 		if ( g_PlayerInfoList[i].thisplayer )
 			m_iPlayerNum = i;  // !!!HACK: this should be initialized elsewhere... maybe gotten from the engine
 	}
 }
 
+void CHudScoreboard :: UpdatePlayerInfo( int cl )
+{
+	if ( cl <= 0 || cl >= MAX_PLAYERS )
+		return;
+
+	GetPlayerInfo( cl, &g_PlayerInfoList[cl] );
+	UpdatePlayerInfoCache( cl );
+}
+
+void CHudScoreboard :: ResetPlayerInfoCache( void )
+{
+	memset( g_PlayerInfoCache, 0, sizeof g_PlayerInfoCache );
+
+	// matches the zeroed g_PlayerExtraInfo, so nothing is formatted until it changes
+	for ( int i = 0; i <= MAX_PLAYERS; i++ )
+	{
+		g_PlayerInfoCache[i].nameLenMode = -1;
+		strcpy( g_PlayerInfoCache[i].pingstr, "0" );
+		strcpy( g_PlayerInfoCache[i].moneystr, "$0" );
+	}
+}
+
+void CHudScoreboard :: UpdatePlayerInfoCache( int cl )
+{
+	player_info_cache_t *cache = &g_PlayerInfoCache[cl];
+	const char *name = g_PlayerInfoList[cl].name ? g_PlayerInfoList[cl].name : "";
+
+	// name changes come with userinfo changes, so the *bot key is only checked then
+	if ( strncmp( cache->name, name, sizeof( cache->name ) - 1 ) )
+	{
+		const char *value = name[0] ? gEngfuncs.PlayerInfo_ValueForKey( cl, "*bot" ) : NULL;
+
+		strncpy( cache->name, name, sizeof( cache->name ) - 1 );
+		cache->name[sizeof( cache->name ) - 1] = 0;
+		cache->serial++;
+		cache->nameLenMode = -1;
+		cache->bot = value && atoi( value ) > 0;
+	}
+
+	if ( cache->ping != g_PlayerInfoList[cl].ping )
+	{
+		cache->ping = g_PlayerInfoList[cl].ping;
+		_snprintf( cache->pingstr, sizeof( cache->pingstr ), "%d", cache->ping );
+	}
+
+	if ( cache->account != g_PlayerExtraInfo[cl].account )
+	{
+		cache->account = g_PlayerExtraInfo[cl].account;
+		_snprintf( cache->moneystr, sizeof( cache->moneystr ), "$%li", cache->account );
+	}
+}
+
+int CHudScoreboard :: GetPlayerNameLen( int cl )
+{
+	player_info_cache_t *cache = &g_PlayerInfoCache[cl];
+	int mode = gHUD.hud_textmode->value;
+
+	// console and hud fonts measure differently
+	if ( cache->nameLenMode != mode )
+	{
+		cache->nameLen = DrawUtils::ConsoleStringLen( cache->name );
+		cache->nameLenMode = mode;
+	}
+
+	return cache->nameLen;
+}
+
 int CHudScoreboard :: MsgFunc_ScoreInfo( const char *pszName, int iSize, void *pbuf )
 {
 	m_iFlags |= HUD_DRAW;
@@ -470,6 +508,9 @@ int CHudScoreboard :: MsgFunc_ScoreInfo( const char *pszName, int iSize, void *p
 		g_PlayerExtraInfo[cl].playerclass = playerclass;
 		g_PlayerExtraInfo[cl].teamnumber = teamnumber;
 
+		if ( cl < MAX_PLAYERS )
+			SortPlayer( cl );
+
 		//gViewPort->UpdateOnPlayerInfo();
 	}
 
@@ -506,62 +547,29 @@ int CHudScoreboard :: MsgFunc_TeamInfo( const char *pszName, int iSize, void *pb
 
 		strncpy( g_PlayerExtraInfo[cl].teamname, teamName, MAX_TEAM_NAME );
 		g_PlayerExtraInfo[cl].teamnumber = teamNumber;
-	}
-
-	// rebuild the list of teams
-
-	// clear out player counts from teams
-	for ( int i = 1; i <= m_iNumTeams; i++ )
-	{
-		g_TeamInfo[i].players = 0;
-	}
 
-	// rebuild the team list
-	GetAllPlayersInfo();
-	m_iNumTeams = 0;
-
-	for ( int i = 1; i < MAX_PLAYERS; i++ )
-	{
-		int j;
-		//if ( g_PlayerInfoList[i].name == NULL )
-		//	continue;
-
-		if ( g_PlayerExtraInfo[i].teamname[0] == 0 )
-			continue; // skip over players who are not in a team
-
-		// is this player in an existing team?
-		for ( j = 1; j <= m_iNumTeams; j++ )
+		if ( cl < MAX_PLAYERS )
 		{
-			if ( g_TeamInfo[j].name[0] == '\0' )
-				break;
-
-			if ( !stricmp( g_PlayerExtraInfo[i].teamname, g_TeamInfo[j].name ) )
-				break;
-		}
+			int team = 0;
 
-		if ( j > m_iNumTeams )
-		{
-			// they aren't in a listed team, so make a new one
-			for ( j = 1; j <= m_iNumTeams; j++ )
+			if ( g_PlayerExtraInfo[cl].teamname[0] )
 			{
-				if ( g_TeamInfo[j].name[0] == '\0' )
-					break;
+				team = FindTeam( g_PlayerExtraInfo[cl].teamname );
+				if ( !team )
+					team = AddTeam( g_PlayerExtraInfo[cl].teamname, teamNumber );
 			}
 
-
-			m_iNumTeams = max( j, m_iNumTeams );
-
-			strncpy( g_TeamInfo[j].name, g_PlayerExtraInfo[i].teamname, MAX_TEAM_NAME );
-			g_TeamInfo[j].teamnumber = g_PlayerExtraInfo[i].teamnumber;
-			g_TeamInfo[j].players = 0;
+			SetPlayerTeam( cl, team );
 		}
-
-		g_TeamInfo[j].players++;
 	}
 
+	GetAllPlayersInfo();
+
 	// clear out any empty teams
 	for ( int i = 1; i <= m_iNumTeams; i++ )
 	{
+		g_TeamInfo[i].players = m_iNumTeamPlayers[i];
+
 		if ( g_TeamInfo[i].players < 1 )
 			memset( &g_TeamInfo[i], 0, sizeof(team_info_t) );
 	}
@@ -579,15 +587,10 @@ int CHudScoreboard :: MsgFunc_TeamScore( const char *pszName, int iSize, void *p
 {
 	BufferReader reader( pszName, pbuf, iSize );
 	char *TeamName = reader.ReadString();
-	int i;
 
 	// find the team matching the name
-	for ( i = 1; i <= m_iNumTeams; i++ )
-	{
-		if ( !stricmp( TeamName, g_TeamInfo[i].name ) )
-			break;
-	}
-	if ( i > m_iNumTeams )
+	int i = FindTeam( TeamName );
+	if ( !i )
 		return 1;
 
 	// use this new score data instead of combined player scores
@@ -598,6 +601,130 @@ int CHudScoreboard :: MsgFunc_TeamScore( const char *pszName, int iSize, void *p
 	return 1;
 }
 
+// true if player a goes above player b: more frags, then less deaths, then lower slot
+static bool PlayerRanksHigher( int a, int b )
+{
+	const extra_player_info_t *pa = &g_PlayerExtraInfo[a];
+	const extra_player_info_t *pb = &g_PlayerExtraInfo[b];
+
+	if ( pa->frags != pb->frags )
+		return pa->frags > pb->frags;
+
+	if ( pa->deaths != pb->deaths )
+		return pa->deaths < pb->deaths;
+
+	return a < b;
+}
+
+// move player to its place in already sorted list
+static void ResortPlayer( int *list, int count, int cl )
+{
+	int pos;
+
+	for ( pos = 0; pos < count; pos++ )
+	{
+		if ( list[pos] == cl )
+			break;
+	}
+
+	if ( pos == count )
+		return;
+
+	while ( pos > 0 && PlayerRanksHigher( cl, list[pos - 1] ) )
+	{
+		list[pos] = list[pos - 1];
+		pos--;
+	}
+
+	while ( pos < count - 1 && PlayerRanksHigher( list[pos + 1], cl ) )
+	{
+		list[pos] = list[pos + 1];
+		pos++;
+	}
+
+	list[pos] = cl;
+}
+
+void CHudScoreboard :: ResetSortedPlayers( void )
+{
+	memset( m_iNumTeamPlayers, 0, sizeof m_iNumTeamPlayers );
+
+	for ( int i = 1; i < MAX_PLAYERS; i++ )
+	{
+		m_iSortedPlayers[i - 1] = i;
+		m_iTeamPlayers[0][i - 1] = i;
+		m_iPlayerTeam[i] = 0;
+	}
+
+	m_iNumTeamPlayers[0] = MAX_PLAYERS - 1;
+}
+
+void CHudScoreboard :: SortPlayer( int cl )
+{
+	int team = m_iPlayerTeam[cl];
+
+	ResortPlayer( m_iSortedPlayers, MAX_PLAYERS - 1, cl );
+	ResortPlayer( m_iTeamPlayers[team], m_iNumTeamPlayers[team], cl );
+}
+
+void CHudScoreboard :: SetPlayerTeam( int cl, int team )
+{
+	int oldTeam = m_iPlayerTeam[cl];
+
+	if ( oldTeam == team )
+		return;
+
+	int *list = m_iTeamPlayers[oldTeam];
+	int count = m_iNumTeamPlayers[oldTeam];
+
+	for ( int i = 0; i < count; i++ )
+	{
+		if ( list[i] == cl )
+		{
+			memmove( &list[i], &list[i + 1], ( count - i - 1 ) * sizeof( list[0] ) );
+			m_iNumTeamPlayers[oldTeam]--;
+			break;
+		}
+	}
+
+	// append and let it bubble up
+	m_iTeamPlayers[team][m_iNumTeamPlayers[team]++] = cl;
+	m_iPlayerTeam[cl] = team;
+
+	ResortPlayer( m_iTeamPlayers[team], m_iNumTeamPlayers[team], cl );
+}
+
+int CHudScoreboard :: FindTeam( const char *teamName )
+{
+	for ( int i = 1; i <= m_iNumTeams; i++ )
+	{
+		if ( g_TeamInfo[i].name[0] && !stricmp( teamName, g_TeamInfo[i].name ) )
+			return i;
+	}
+
+	return 0;
+}
+
+int CHudScoreboard :: AddTeam( const char *teamName, int teamNumber )
+{
+	for ( int i = 1; i <= MAX_TEAMS; i++ )
+	{
+		if ( g_TeamInfo[i].name[0] != '\0' )
+			continue;
+
+		memset( &g_TeamInfo[i], 0, sizeof(team_info_t) );
+		strncpy( g_TeamInfo[i].name, teamName, MAX_TEAM_NAME );
+		g_TeamInfo[i].teamnumber = teamNumber;
+		g_TeamInfo[i].spectator = !strnicmp( teamName, "SPECTATOR", MAX_TEAM_NAME );
+
+		m_iNumTeams = max( i, m_iNumTeams );
+		return i;
+	}
+
+	// no free slots, draw player with those who are not in a team
+	return 0;
+}
+
 void CHudScoreboard :: DeathMsg( int killer, int victim )
 {
 	// if we were the one killed,  or the world killed us, set the scoreboard to indicate suicide
@@ -631,6 +758,7 @@ int CHudScoreboard::MsgFunc_Account( const char *pszName, int iSize, void *pbuf
 	int i = reader.ReadByte( );
 	long account = reader.ReadLong( );
 	g_PlayerExtraInfo[i].account = account;
+	UpdatePlayerInfoCache( i );
 	return 1;
 }
 
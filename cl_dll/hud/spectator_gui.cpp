@@ -119,6 +119,7 @@ int CHudSpectatorGui::VidInit()
 	m_fTextScale = ScreenWidth / 1024.0f;
 	if( m_fTextScale < 1.0f )
 		m_fTextScale = 1.0f;
+	label.m_iNameAndHealthPlayer = 0; // text scale may have changed, measure again
 	m_hTimerTexture = gRenderAPI.GL_LoadTexture("gfx/vgui/timer.tga", NULL, 0, TF_NEAREST |TF_NOPICMIP|TF_NOMIPMAP|TF_CLAMP );
 	return 1;
 }
@@ -241,7 +242,7 @@ int CHudSpectatorGui::Draw( float flTime )
 
 	//if( !label.m_szNameAndHealth[0] )
 	//{
-		int iLen = DrawUtils::HudStringLen( label.m_szNameAndHealth, m_fTextScale );
+		int iLen = label.m_iNameAndHealthLen;
 		GetTeamColor( r, g, b, g_PlayerExtraInfo[ g_iUser2 ].teamnumber );
 		DrawUtils::DrawHudString( ScreenWidth * 0.5 - iLen * 0.5, INT_YPOS(9) - gHUD.GetCharHeight() * 0.5 * m_fTextScale, ScreenWidth,
 								  label.m_szNameAndHealth, r, g, b );
@@ -307,19 +308,36 @@ void CHudSpectatorGui::CalcAllNeededData( )
 	// player name
 	if( g_iUser2 > 0 && g_iUser2 < MAX_PLAYERS )
 	{
-		hud_player_info_t sInfo;
-		GetPlayerInfo( g_iUser2, &sInfo );
+		gHUD.m_Scoreboard.UpdatePlayerInfo( g_iUser2 );
 
-		_snprintf( label.m_szNameAndHealth, sizeof( label.m_szNameAndHealth ),
-				  "%s (%i)",  sInfo.name, g_PlayerExtraInfo[g_iUser2].health );
+		const player_info_cache_t *info = &g_PlayerInfoCache[g_iUser2];
+
+		// rebuild only when the target, its name or its health changes
+		if( label.m_iNameAndHealthPlayer != g_iUser2 || label.m_iNameAndHealthSerial != info->serial ||
+			label.m_iNameAndHealthHealth != g_PlayerExtraInfo[g_iUser2].health )
+		{
+			label.m_iNameAndHealthPlayer = g_iUser2;
+			label.m_iNameAndHealthSerial = info->serial;
+			label.m_iNameAndHealthHealth = g_PlayerExtraInfo[g_iUser2].health;
+
+			_snprintf( label.m_szNameAndHealth, sizeof( label.m_szNameAndHealth ),
+					  "%s (%i)",  info->name, label.m_iNameAndHealthHealth );
+			label.m_iNameAndHealthLen = DrawUtils::HudStringLen( label.m_szNameAndHealth, m_fTextScale );
+		}
+	}
+	else
+	{
+		label.m_szNameAndHealth[0] = '\0';
+		label.m_iNameAndHealthPlayer = 0;
+		label.m_iNameAndHealthLen = 0;
 	}
-	else label.m_szNameAndHealth[0] = '\0';
 }
 
 void CHudSpectatorGui::InitHUDData()
 {
 	m_bBombPlanted = false;
 	label.m_szMap[0] = '\0';
+	label.m_iNameAndHealthPlayer = 0;
 }
 
 void CHudSpectatorGui::Reset()
@@ -53,6 +53,7 @@ enum
 	MAX_TEAMS = 3,
 	MAX_TEAM_NAME = 16,
 	MAX_HOSTAGES = 24,
+	MAX_PLAYER_MODELS = 12,
 };
 
 extern const char *sPlayerModelFiles[];
@@ -301,13 +302,15 @@ public:
 
 	int DrawScoreboard( float flTime );
 	int DrawTeams( float listslot );
-	int DrawPlayers( float listslot, int nameoffset = 0, const char *team = NULL ); // returns the ypos where it finishes drawing
+	int DrawPlayers( float listslot, int nameoffset = 0, int team = -1 ); // returns the ypos where it finishes drawing, team -1 draws everyone
 
 	void DeathMsg( int killer, int victim );
 	int MsgFunc_HealthInfo( const char *pszName, int iSize, void *pbuf );
 	int MsgFunc_Account( const char *pszName, int iSize, void *pbuf );
 	void SetScoreboardDefaults( void );
 	void GetAllPlayersInfo( void );
+	void UpdatePlayerInfo( int cl );
+	int  GetPlayerNameLen( int cl );
 
 	CHudUserCmd(ShowScores);
 	CHudUserCmd(HideScores);
@@ -330,6 +333,22 @@ private:
 	bool m_bDrawStroke;
 	bool m_bForceDraw; // if called by showscoreboard2
 	bool m_bShowscoresHeld;
+
+	// players sorted by frags, then deaths, then slot
+	// only message handlers reorder them, drawing just walks the lists
+	void ResetSortedPlayers( void );
+	void SortPlayer( int cl );
+	void SetPlayerTeam( int cl, int team );
+	int  FindTeam( const char *teamName );
+	int  AddTeam( const char *teamName, int teamNumber );
+
+	void ResetPlayerInfoCache( void );
+	void UpdatePlayerInfoCache( int cl );
+
+	int m_iSortedPlayers[MAX_PLAYERS];
+	int m_iTeamPlayers[MAX_TEAMS+1][MAX_PLAYERS]; // team 0 is for players without team
+	int m_iNumTeamPlayers[MAX_TEAMS+1];
+	int m_iPlayerTeam[MAX_PLAYERS]; // index in g_TeamInfo
 };
 
 //
@@ -400,6 +419,21 @@ struct team_info_t
 	int scores_overriden;
 	int sumping;
 	int teamnumber;
+	int spectator; // name is "SPECTATOR", drawn last
+};
+
+// strings derived from engine player info, rebuilt only when their source changes
+struct player_info_cache_t
+{
+	char name[MAX_PLAYER_NAME_LENGTH]; // name the strings below were built for
+	int serial;			// bumped on every name change
+	int nameLen;		// DrawUtils::ConsoleStringLen( name )
+	int nameLenMode;	// hud_textmode value nameLen was measured with, -1 if not measured
+	bool bot;
+	int ping;
+	char pingstr[16];
+	long account;
+	char moneystr[16];
 };
 
 struct hostage_info_t
@@ -415,6 +449,7 @@ struct hostage_info_t
 extern hud_player_info_t	g_PlayerInfoList[MAX_PLAYERS+1];	   // player info from the engine
 extern extra_player_info_t  g_PlayerExtraInfo[MAX_PLAYERS+1];   // additional player info sent directly to the client dll
 extern team_info_t			g_TeamInfo[MAX_TEAMS+1];
+extern player_info_cache_t	g_PlayerInfoCache[MAX_PLAYERS+1];
 extern hostage_info_t		g_HostageInfo[MAX_HOSTAGES+1];
 extern int					g_IsSpectator[MAX_PLAYERS+1];
 
@@ -826,6 +861,10 @@ private:
 		char m_szTimer[64];
 		char m_szMap[64];
 		char m_szNameAndHealth[80];
+		int m_iNameAndHealthLen;
+		int m_iNameAndHealthPlayer; // what the string was built from, 0 forces a rebuild
+		int m_iNameAndHealthSerial;
+		int m_iNameAndHealthHealth;
 	} label;
 	int m_hTimerTexture;
 
@@ -918,9 +957,14 @@ public:
 	int		m_iRes;
 	cvar_t *m_pCvarDraw;
 	cvar_t *cl_shadows;
+	cvar_t *cl_shadows_distance;	// no player shadows farther from the view than this, 0 is unlimited
 	cvar_t *cl_predict;
 	cvar_t *cl_weapon_wallpuff;
 	cvar_t *cl_weapon_sparks;
+	cvar_t *cl_impact_budget;		// wall puffs and sparks per frame, 0 is unlimited
+	cvar_t *cl_impact_area_budget;	// effects around one spot at a time, 0 is unlimited
+	cvar_t *cl_impact_merge;		// impacts closer than this share effects
+	cvar_t *cl_impact_lod;			// no sparks past this distance, no wall puffs past twice it
 	cvar_t *zoom_sens_ratio;
 	cvar_t *cl_lw;
 	cvar_t *cl_righthand;
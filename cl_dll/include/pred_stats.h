@@ -0,0 +1,66 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef PRED_STATS_H
+#define PRED_STATS_H
+
+// Client side prediction telemetry: how often the predicted state disagrees
+// with what the server sent back, how deep the engine re-predicts and how long
+// weapon and movement prediction take. Enabled with cl_predstats.
+
+#define PREDSTATS_WINDOW	512		// frames kept for the rolling histogram, must be power of two
+
+enum
+{
+	PREDSTATS_TIMER_WEAPONS = 0,	// HUD_WeaponsPostThink
+	PREDSTATS_TIMER_PMOVE,			// PM_Move, client side only
+
+	PREDSTATS_TIMERS
+};
+
+// state compared between the predicted and the acknowledged frame
+enum
+{
+	PREDFIELD_ORIGIN = 0,
+	PREDFIELD_VELOCITY,
+	PREDFIELD_PUNCHANGLE,
+	PREDFIELD_NEXTATTACK,
+	PREDFIELD_AMMO,
+	PREDFIELD_FOV,
+	PREDFIELD_WEAPONANIM,
+	PREDFIELD_WEAPONID,
+	PREDFIELD_CLIP,
+	PREDFIELD_NEXTPRIMARY,
+	PREDFIELD_NEXTSECONDARY,
+	PREDFIELD_IDLE,
+	PREDFIELD_RELOAD,
+	PREDFIELD_WEAPONSTATE,
+	PREDFIELD_SHOTSFIRED,
+
+	PREDFIELD_COUNT
+};
+
+void PredStats_Init( void );
+bool PredStats_Enabled( void );
+double PredStats_Time( void );
+
+void PredStats_AddTime( int timer, double seconds );
+void PredStats_RunCmd( int runfuncs );
+void PredStats_Compare( const struct clientdata_s *received, const struct clientdata_s *predicted,
+	const struct weapon_data_s *wreceived, const struct weapon_data_s *wpredicted );
+void PredStats_Frame( double time );
+
+#endif
@@ -59,7 +59,10 @@ public:
 	CGameStudioModelRenderer(void);
 
 public:
+	virtual void VidInit(void);
 	virtual void StudioSetupBones(void);
+	virtual void StudioSetupPoseInput(studioposeinput_t *input, double f, float gaitframe);
+	virtual void StudioSetupPoseGait(studioposeinput_t *input, float gaitframe);
 	virtual void StudioEstimateGait(entity_state_t *pplayer);
 	virtual void StudioProcessGait(entity_state_t *pplayer);
 	virtual int StudioDrawPlayer(int flags, entity_state_t *pplayer);
@@ -69,15 +72,22 @@ public:
 	virtual void CalculateYawBlend(entity_state_t *pplayer);
 	virtual void CalculatePitchBlend(entity_state_t *pplayer);
 
+	void StudioPosePrepass(void);
+
 private:
 	void SavePlayerState(entity_state_t *pplayer);
 	void SetupClientAnimation(entity_state_t *pplayer);
 	void RestorePlayerState(entity_state_t *pplayer);
-	mstudioanim_t* LookupAnimation(mstudioseqdesc_t *pseqdesc, int index);
+	model_t *GetMinModel(int index);
+	bool StudioSetupPlayer(entity_state_t *pplayer);
+	void StudioAdjustPlayerBlend(void);
+	player_info_t *StudioPlayerInfo(void);
 
 private:
 	int m_nPlayerGaitSequences[MAX_CLIENTS];
 	bool m_bLocal;
+	model_t *m_pMinModels[MAX_PLAYER_MODELS];
+	player_info_t *m_pPrepassPlayerInfo;	// stands in for the engine copy while the prepass replays a setup
 };
 
 extern CGameStudioModelRenderer g_StudioRenderer;
@@ -0,0 +1,59 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOANIMLOD_H
+#define STUDIOANIMLOD_H
+
+#include "StudioPose.h"
+
+// Animation level of detail for players that cover few pixels on screen:
+// their poses lose sequence transitions and blend to the nearest blend,
+// and the smallest ones only get a new sequence pose every few frames.
+// The gait is merged over the kept pose on every frame.
+
+typedef struct animlod_entry_s
+{
+	studiohdr_t *hdr;		// NULL means empty
+	int length;
+	int sequence;
+	int framecount;			// of the last evaluated pose
+	float pos[MAXSTUDIOBONES][3];	// before the gait merge
+	vec4_t q[MAXSTUDIOBONES];
+} animlod_entry_t;
+
+class CStudioAnimLOD
+{
+public:
+	CStudioAnimLOD(void);
+
+	void Init(void);
+	void Flush(void);
+
+	int Level(float radius, float distance);
+
+	bool Lookup(int index, int framecount, const studioposeinput_t *input, float pos[][3], vec4_t *q);
+	void Store(int index, int framecount, const studioposeinput_t *input, float pos[][3], vec4_t *q);
+
+private:
+	animlod_entry_t m_Entries[MAX_CLIENTS + 1];
+
+	cvar_t *m_pCvarAnimLOD;
+	cvar_t *m_pCvarSimple;
+	cvar_t *m_pCvarReuse;
+	cvar_t *m_pCvarInterval;
+};
+
+#endif
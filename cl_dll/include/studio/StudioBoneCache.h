@@ -0,0 +1,93 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOBONECACHE_H
+#define STUDIOBONECACHE_H
+
+// Keeps the final bone and light transforms an entity built in this frame, so
+// the STUDIO_RENDER pass can reuse what the STUDIO_EVENTS pass already computed.
+
+#define BONECACHE_ENTRIES	128		// must be power of two
+#define BONECACHE_PROBE		4		// slots checked per lookup
+
+// everything the bone setup reads, captured before it runs; any change
+// between the passes (curstate updated mid-frame, other transform) is a miss
+typedef struct bonekey_s
+{
+	cl_entity_t *entity;
+	studiohdr_t *hdr;
+	int length;				// studiohdr length, guards against reused model memory
+	int dointerp;
+	int sequence;
+	float frame;
+	float framerate;
+	float animtime;
+	int renderfx;
+	float scale;
+	byte blending[2];
+	byte controller[4];
+	byte mouthopen;
+	byte prevblending[2];
+	byte prevseqblending[2];
+	byte prevcontroller[4];
+	int prevsequence;
+	float sequencetime;
+	float prevframe;		// only while blending out of the previous sequence
+	int gaitsequence;		// -1 for non players
+	float gaitframe;
+	float rotationmatrix[3][4];
+	float aliastransform[3][4];	// software renderer only
+} bonekey_t;
+
+typedef struct bonecache_entry_s
+{
+	bonekey_t key;
+	int index;
+	int framecount;			// -1 means empty
+
+	// state the bone setup leaves behind, restored on a hit
+	int sequence;
+	byte blending[2];
+	byte prevseqblending[2];
+	float prevframe;
+
+	int numbones;
+	float bonetransform[MAXSTUDIOBONES][3][4];
+	float lighttransform[MAXSTUDIOBONES][3][4];
+} bonecache_entry_t;
+
+class CStudioBoneCache
+{
+public:
+	CStudioBoneCache(void);
+
+	void Init(void);
+	void Flush(void);
+
+	bool IsEnabled(void);
+
+	void ClearKey(bonekey_t *key);
+	bonecache_entry_t *Lookup(int index, int framecount, const bonekey_t *key);
+	bonecache_entry_t *Store(int index, int framecount, const bonekey_t *key);
+
+private:
+	bonecache_entry_t m_Entries[BONECACHE_ENTRIES];
+	int m_nFrameCount;
+
+	cvar_t *m_pCvarBoneCache;
+};
+
+#endif
@@ -0,0 +1,70 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOMODELINFO_H
+#define STUDIOMODELINFO_H
+
+// Per studiohdr_t data the renderer would otherwise rebuild every draw
+// (bone name lookups, parent lists, animation offsets), built on first use.
+
+#define MODELINFO_ENTRIES		1024	// must be power of two, more than a map can load
+#define MODELINFO_MAX_ATTACHMENTS	4	// cl_entity_t::attachment
+
+typedef struct studiomodelinfo_s
+{
+	studiohdr_t *hdr;		// NULL means empty
+
+	// guards against model memory reused by another model
+	int length;
+	int numbones;
+	int numseq;
+
+	int spinebone;			// "Bip01 Spine", numbones if the model has none
+	int chestbone;			// "Bip01 Spine3", -1 if the model has none
+	int numattachments;		// clamped to what an entity can hold
+	int parents[MAXSTUDIOBONES];
+	byte gaitbones[MAXSTUDIOBONES];	// legs and pelvis, driven by the gait sequence on player models
+
+	// per sequence, NULL when it lives in a demand loaded sequence group
+	mstudioanim_t **seqanim;
+
+	// bone of the model last merged onto, per bone of this model, -1 if it has no match
+	studiohdr_t *mergehdr;
+	int mergelength;
+	int mergebones[MAXSTUDIOBONES];
+} studiomodelinfo_t;
+
+class CStudioModelInfoCache
+{
+public:
+	CStudioModelInfoCache(void);
+	~CStudioModelInfoCache(void);
+
+	void Flush(void);
+	studiomodelinfo_t *Get(studiohdr_t *hdr);
+	void SetMergeParent(studiomodelinfo_t *info, studiohdr_t *parent);
+
+private:
+	bool IsValid(const studiomodelinfo_t *info, const studiohdr_t *hdr);
+	void Build(studiomodelinfo_t *info, studiohdr_t *hdr);
+	void Free(studiomodelinfo_t *info);
+
+	studiomodelinfo_t m_Entries[MODELINFO_ENTRIES];
+	studiomodelinfo_t *m_pLast;
+	int m_nEntries;
+};
+
+#endif
@@ -19,6 +19,23 @@
 #ifndef STUDIOMODELRENDERER_H
 #define STUDIOMODELRENDERER_H
 
+#include "StudioPoseCache.h"
+#include "StudioBoneCache.h"
+#include "StudioModelInfo.h"
+#include "StudioPosePrepass.h"
+#include "StudioAnimLOD.h"
+
+// ground under a player's blob shadow, reused while the player stays put
+typedef struct shadowcache_s
+{
+	int valid;
+	int hit;			// the trace found ground the shadow may lie on
+	double time;
+	Vector start;
+	Vector normal;
+	float dist;
+} shadowcache_t;
+
 class CStudioModelRenderer
 {
 public:
@@ -27,6 +44,8 @@ public:
 
 public:
 	virtual void Init(void);
+	virtual void VidInit(void);
+	virtual void Shutdown(void);
 	virtual int StudioDrawModel(int flags);
 	virtual int StudioDrawPlayer(int flags, struct entity_state_s *pplayer);
 
@@ -34,6 +53,8 @@ public:
 	virtual mstudioanim_t *StudioGetAnim(model_t *m_pSubModel, mstudioseqdesc_t *pseqdesc);
 	virtual void StudioSetUpTransform(int trivial_accept);
 	virtual void StudioSetupBones(void);
+	virtual void StudioCalcPose(float pos[][3], vec4_t *q, double f, float gaitframe);
+	virtual void StudioCalcBoneTransforms(float pos[][3], vec4_t *q);
 	virtual void StudioCalcAttachments(void);
 	virtual void StudioSaveBones(void);
 	virtual void StudioMergeBones(model_t *m_pSubModel);
@@ -54,7 +75,19 @@ public:
 	virtual void StudioProcessGait(entity_state_t *pplayer);
 	virtual void StudioSetShadowSprite(int idx);
 	virtual void StudioDrawShadow(Vector origin, float scale);
+	virtual void StudioSetupPoseInput(studioposeinput_t *input, double f, float gaitframe);
+	virtual void StudioSetupPoseGait(studioposeinput_t *input, float gaitframe);
 
+protected:
+	bool StudioGetPoseKey(posekey_t *key, double *f, float *gaitframe, bool lerpblending);
+	void StudioSetupPoseState(studioposeinput_t *input);
+	bool StudioBuildPose(studioposeinput_t *input, posekey_t *key, bool lerpblending);
+	void StudioEvaluatePose(float pos[][3], vec4_t *q, bool lerpblending);
+	bool StudioInSequenceTransition(void);
+	int StudioGetAnimLOD(void);
+	bool StudioGetBoneKey(bonekey_t *key);
+	void StudioSetupBonesCached(void);
+	bool StudioShadowTrace(const Vector &origin, Vector &endpos, Vector &normal, float &fraction);
 
 public:
 	double m_clTime;
@@ -78,7 +111,7 @@ public:
 	int m_nBottomColor;
 	model_t *m_pChromeSprite;
 	int m_nCachedBones;
-	char m_nCachedBoneNames[MAXSTUDIOBONES][32];
+	studiohdr_t *m_pCachedBonesHeader;
 	float m_rgCachedBoneTransform[MAXSTUDIOBONES][3][4];
 	float m_rgCachedLightTransform[MAXSTUDIOBONES][3][4];
 	float m_fSoftwareXScale, m_fSoftwareYScale;
@@ -92,6 +125,14 @@ public:
 	float (*m_paliastransform)[3][4];
 	float (*m_pbonetransform)[MAXSTUDIOBONES][3][4];
 	float (*m_plighttransform)[MAXSTUDIOBONES][3][4];
+	CStudioPoseCache m_PoseCache;
+	CStudioBoneCache m_BoneCache;
+	CStudioModelInfoCache m_ModelInfo;
+	CStudioPose m_Pose;
+	CStudioPosePrepass m_PosePrepass;
+	CStudioAnimLOD m_AnimLOD;
+	shadowcache_t m_ShadowCache[MAX_CLIENTS + 1];
+	int m_nShadowFrame;
 };
 
 #endif
@@ -0,0 +1,105 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOPOSE_H
+#define STUDIOPOSE_H
+
+// Local-space pose evaluation (sequence blending, transitions, gait merge).
+// Everything it reads is captured in studioposeinput_t up front, so it touches
+// no renderer or engine state and any number of threads can run it at once.
+
+enum
+{
+	POSE_GAIT_NONE = 0,
+	POSE_GAIT_SPINE,		// bones before "Bip01 Spine" come from the gait sequence
+	POSE_GAIT_MASK,			// bones flagged in gaitbones come from the gait sequence
+};
+
+enum
+{
+	ANIMLOD_NONE = 0,
+	ANIMLOD_SIMPLE,			// nearest blend only, no sequence transition
+	ANIMLOD_REUSE,			// simple, and the pose is kept for a few frames
+};
+
+// compared with memcmp, so it must be cleared before it is filled in
+typedef struct studioposeinput_s
+{
+	studiohdr_t *hdr;
+	int length;				// studiohdr length, guards against reused model memory
+	int blend9;				// counter-strike player, 3x3 blends and no blend interpolation
+	int dointerp;
+	int lod;
+	double time;
+
+	int sequence;
+	double frame;
+	mstudioanim_t *anim;
+	float animtime;
+	float prevanimtime;
+	float framerate;
+	byte blending[2];
+	byte prevblending[2];
+	byte controller[4];
+	byte prevcontroller[4];
+	byte mouthopen;
+
+	// blending out of the previous sequence
+	int transition;
+	int prevsequence;
+	float prevframe;
+	float sequencetime;
+	mstudioanim_t *prevanim;
+	byte prevseqblending[2];
+
+	int gaitmode;
+	int gaitsequence;
+	float gaitframe;
+	mstudioanim_t *gaitanim;
+	int spinebone;
+	byte gaitbones[MAXSTUDIOBONES];
+} studioposeinput_t;
+
+class CStudioPose
+{
+public:
+	void Evaluate(const studioposeinput_t *in, float pos[][3], vec4_t *q);
+	void EvaluateSequence(const studioposeinput_t *in, float pos[][3], vec4_t *q);
+	void MergeGait(const studioposeinput_t *in, float pos[][3], vec4_t *q);
+
+	static float EstimateInterpolant(const studioposeinput_t *in);
+	static void CalcBoneAdj(studiohdr_t *hdr, float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen);
+	static void CalcBoneQuaterion(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *q);
+	static void CalcBonePosition(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *pos);
+	static void CalcRotations(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f);
+	static void SlerpBones(int numbones, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s);
+
+private:
+	void CalcBlends(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f, const byte *blending, bool interpolate);
+	void CalcBlends9(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f, const byte *blending);
+
+	// scratch poses, one set per evaluator
+	float m_Pos1b[MAXSTUDIOBONES][3];
+	vec4_t m_Q1b[MAXSTUDIOBONES];
+	float m_Pos2[MAXSTUDIOBONES][3];
+	vec4_t m_Q2[MAXSTUDIOBONES];
+	float m_Pos3[MAXSTUDIOBONES][3];
+	vec4_t m_Q3[MAXSTUDIOBONES];
+	float m_Pos4[MAXSTUDIOBONES][3];
+	vec4_t m_Q4[MAXSTUDIOBONES];
+};
+
+#endif
@@ -0,0 +1,80 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOPOSECACHE_H
+#define STUDIOPOSECACHE_H
+
+// Memoizes local-space bone poses (after sequence blending and gait merge)
+// so entities sharing the same animation state only pay for the world transform.
+
+#define POSECACHE_ENTRIES		64		// must be power of two
+#define POSECACHE_PROBE			4		// slots checked per lookup
+#define POSECACHE_FRAME_QUANT	64.0f	// frame resolution of a key, steps per anim frame
+#define POSECACHE_MAX_AGE		256		// frames an unused entry survives in cross-frame mode
+
+typedef struct posekey_s
+{
+	studiohdr_t *hdr;
+	int length;			// studiohdr length, guards against reused model memory
+	int sequence;
+	float frame;		// quantized
+	int gaitsequence;	// -1 if there is no gait merge
+	float gaitframe;	// quantized
+	byte blending[2];
+	byte controller[4];
+	byte mouthopen;
+	int lod;
+} posekey_t;
+
+typedef struct posecache_entry_s
+{
+	posekey_t key;
+	unsigned int hash;
+	int lastframe;		// -1 means empty
+	int numbones;
+	float pos[MAXSTUDIOBONES][3];
+	vec4_t q[MAXSTUDIOBONES];
+} posecache_entry_t;
+
+class CStudioPoseCache
+{
+public:
+	CStudioPoseCache(void);
+
+	void Init(void);
+	void Flush(void);
+	void BeginFrame(int framecount);
+
+	bool IsEnabled(void);
+	float Quantize(float frame);
+
+	void ClearKey(posekey_t *key);
+	bool Lookup(const posekey_t *key, float pos[][3], vec4_t *q, int numbones);
+	void Store(const posekey_t *key, float pos[][3], vec4_t *q, int numbones);
+
+private:
+	unsigned int HashKey(const posekey_t *key);
+
+	posecache_entry_t m_Entries[POSECACHE_ENTRIES];
+	int m_nFrameCount;
+	int m_nHits, m_nMisses;
+	int m_nLastHits, m_nLastMisses;
+
+	cvar_t *m_pCvarPoseCache;
+	cvar_t *m_pCvarPoseCacheStats;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#pragma once
+#ifndef STUDIOPOSEPREPASS_H
+#define STUDIOPOSEPREPASS_H
+
+#include "StudioPose.h"
+
+// Evaluates the poses of the players about to be drawn on worker threads
+// while the main thread renders everything else. A draw only takes a
+// result whose input matches its own exactly, otherwise it evaluates inline.
+
+#define POSEPREPASS_MAX_JOBS		MAX_CLIENTS
+#define POSEPREPASS_MAX_THREADS		4
+
+enum
+{
+	POSEJOB_FREE = 0,
+	POSEJOB_QUEUED,
+	POSEJOB_RUNNING,
+	POSEJOB_DONE,
+};
+
+typedef struct posejob_s
+{
+	studioposeinput_t input;
+	int index;				// entity
+	int state;
+	float pos[MAXSTUDIOBONES][3];
+	vec4_t q[MAXSTUDIOBONES];
+} posejob_t;
+
+class CStudioPosePrepass
+{
+public:
+	CStudioPosePrepass(void);
+
+	void Init(void);
+	void Shutdown(void);
+	void Flush(void);
+
+	bool BeginFrame(int framecount);
+	bool AddJob(int index, const studioposeinput_t *input);
+	void Run(void);
+
+	bool Fetch(int index, const studioposeinput_t *input, float pos[][3], vec4_t *q);
+
+	// worker thread body
+	void Work(CStudioPose *pose);
+
+private:
+	bool StartThreads(void);
+	posejob_t *ClaimJob(void);
+
+	posejob_t m_Jobs[POSEPREPASS_MAX_JOBS];
+	posejob_t *m_pEntityJobs[MAX_CLIENTS + 1];
+	int m_nJobs;			// handed to the workers
+	int m_nPending;			// filled in, not handed out yet
+	int m_nNextJob;
+	int m_nFrameCount;
+
+	int m_nThreads;			// -1 until started, 0 if this machine has no spare core
+	volatile int m_bQuit;
+	struct poseprepass_sys_s *m_pSys;
+
+	cvar_t *m_pCvarPosePrepass;
+};
+
+#endif
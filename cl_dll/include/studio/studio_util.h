@@ -35,4 +35,10 @@ void	QuaternionMatrix( vec4_t quaternion, float (*matrix)[4] );
 void	QuaternionSlerp( vec4_t p, vec4_t q, float t, vec4_t qt );
 void	AngleQuaternion( float *angles, vec4_t quaternion );
 
+// batch variants for whole skeletons, SSE2/NEON when available
+int		StudioUtil_SetSIMD( int enable );
+void	QuaternionSlerpBatch( vec4_t *p, vec4_t *q, float t, vec4_t *qt, int count );
+void	QuaternionMatrixBatch( vec4_t *q, float (*pos)[3], float (*matrix)[3][4], int count );
+void	ConcatTransformsBatch( float root[3][4], const int *parents, float (*in)[3][4], float (*out)[3][4], int count );
+
 #endif // STUDIO_UTIL_H
\ No newline at end of file
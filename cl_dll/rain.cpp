@@ -24,7 +24,6 @@
 #include "con_nprint.h"
 #include "triangleapi.h"
 #include "parsemsg.h"
-#include <new>
 
 
 #define DRIPSPEED    900		// speed of raindrips (pixel per secs)
@@ -41,6 +40,14 @@
 // radius water rings
 #define MAXRINGHALFSIZE	25
 
+#define WEATHER_VIEW_SPAWN	0.75f	// part of the drips spawned inside the view cone
+#define WEATHER_VIEW_MARGIN	10.0f	// degrees added around the screen for culling and spawning
+#define RAIN_LOD_DIST		256		// farther drips face the view instead of the player
+
+#define WEATHER_GRID_CELL	32		// drips starting in one cell share a landing trace
+#define WEATHER_GRID_SIZE	4096	// cached cells, must be power of two
+#define WEATHER_GRID_MAXDZ	32		// start height change that invalidates a cell
+
 struct
 {
 	Vector2D wind;
@@ -76,32 +83,58 @@ enum
 	WATER_LANDING
 };
 
-struct cl_drip_t
+// drips and fx live in fixed structure-of-arrays pools, Rain.dripcounter and
+// Rain.fxcounter are the number of used slots, a dead one is replaced by the last
+struct
 {
-	Vector		origin;
-	float		birthTime;
-	float		minHeight;	// minimal height to kill raindrop
-	float		alpha;
+	float		x[MAXDRIPS];
+	float		y[MAXDRIPS];
+	float		z[MAXDRIPS];
+	float		deltaX[MAXDRIPS];	// side speed
+	float		deltaY[MAXDRIPS];
+	float		minHeight[MAXDRIPS];	// minimal height to kill raindrop
+	float		alpha[MAXDRIPS];
+	float		birthTime[MAXDRIPS];
+	byte		land[MAXDRIPS];
+} Drips;
 
-	Vector2D    Delta; // side speed
-	int         land;
+struct
+{
+	float		x[MAXFX];
+	float		y[MAXFX];
+	float		z[MAXFX];
+	float		birthTime[MAXFX];
+	float		life[MAXFX];
+	float		alpha[MAXFX];
+	byte		type[MAXFX];
+} FX;
+
+// landing results of the spawn traces, keyed by the cell of the start point
+struct weathercell_t
+{
+	int		x, y;
+	float	startZ;
+	float	deathHeight;
+	byte	used;
+	byte	valid;	// drips can't be placed here if not set
+	byte	land;
+};
 
-	cl_drip_t*		p_Next;		// next drip in chain
-	cl_drip_t*		p_Prev;		// previous drip in chain
-} FirstChainDrip;
+static weathercell_t WeatherGrid[WEATHER_GRID_SIZE];
 
-struct cl_rainfx_t
+// cone around the view direction covering the whole screen, set up once per frame
+struct
 {
-	Vector		origin;
-	float		birthTime;
-	float		life;
-	float		alpha;
-
-	int type;
+	Vector	origin;
+	Vector	forward;
+	Vector2D right;		// horizontal part of the view right vector
+	float	yaw;
+	float	halfFovX;	// degrees
+	float	cosHalfDiag;
+	bool	spawnInView;
+} WeatherView;
 
-	cl_rainfx_t*		p_Next;		// next fx in chain
-	cl_rainfx_t*		p_Prev;		// previous fx in chain
-} FirstChainFX;
+extern vec3_t v_origin, v_angles;
 
 
 #ifdef _DEBUG
@@ -114,9 +147,9 @@ cvar_t *debug_rain = NULL;
 WaterLandingEffect
 =================================
 */
-void LandingEffect( cl_drip_t *drip )
+void LandingEffect( int drip )
 {
-	if( drip->land == NO_LANDING )
+	if( Drips.land[drip] == NO_LANDING )
 		return;
 
 	if (Rain.fxcounter >= MAXFX)
@@ -125,29 +158,223 @@ void LandingEffect( cl_drip_t *drip )
 		return;
 	}
 
-	cl_rainfx_t *newFX = new(std::nothrow) cl_rainfx_t;
-	if( !newFX )
+	int i = Rain.fxcounter++;
+
+	FX.alpha[i] = gEngfuncs.pfnRandomFloat(0.6, 0.9);
+	FX.x[i] = Drips.x[drip];
+	FX.y[i] = Drips.y[drip];
+	FX.z[i] = Drips.minHeight[drip]; // correct position
+	FX.birthTime[i] = Rain.curtime;
+	FX.life[i] = gEngfuncs.pfnRandomFloat(0.7, 1);
+	FX.type[i] = Drips.land[drip];
+}
+
+/*
+=================================
+RemoveDrip
+
+Move the last drip into the freed slot
+=================================
+*/
+void RemoveDrip( int i )
+{
+	int last = --Rain.dripcounter;
+
+	Drips.x[i]         = Drips.x[last];
+	Drips.y[i]         = Drips.y[last];
+	Drips.z[i]         = Drips.z[last];
+	Drips.deltaX[i]    = Drips.deltaX[last];
+	Drips.deltaY[i]    = Drips.deltaY[last];
+	Drips.minHeight[i] = Drips.minHeight[last];
+	Drips.alpha[i]     = Drips.alpha[last];
+	Drips.birthTime[i] = Drips.birthTime[last];
+	Drips.land[i]      = Drips.land[last];
+}
+
+/*
+=================================
+RemoveFX
+=================================
+*/
+void RemoveFX( int i )
+{
+	int last = --Rain.fxcounter;
+
+	FX.x[i]         = FX.x[last];
+	FX.y[i]         = FX.y[last];
+	FX.z[i]         = FX.z[last];
+	FX.birthTime[i] = FX.birthTime[last];
+	FX.life[i]      = FX.life[last];
+	FX.alpha[i]     = FX.alpha[last];
+	FX.type[i]      = FX.type[last];
+}
+
+/*
+=================================
+SetupWeatherView
+=================================
+*/
+void SetupWeatherView( void )
+{
+	vec3_t forward, right, up;
+	float fov = gHUD.m_iFOV ? gHUD.m_iFOV : 90.0f;
+
+	AngleVectors( v_angles, forward, right, up );
+
+	WeatherView.origin = v_origin;
+	WeatherView.forward = forward;
+	WeatherView.right = Vector2D( right[0], right[1] ).Normalize();
+	WeatherView.yaw = v_angles[YAW];
+
+	// fov is given for 4:3, wider screens see more horizontally
+	float tanY = tan( fov * 0.5f * M_PI / 180.0f ) * 0.75f;
+	float tanX = tanY * ScreenWidth / ScreenHeight;
+
+	WeatherView.halfFovX = atan( tanX ) * 180.0f / M_PI + WEATHER_VIEW_MARGIN;
+	WeatherView.cosHalfDiag = cos( atan( sqrt( tanX * tanX + tanY * tanY )) + WEATHER_VIEW_MARGIN * M_PI / 180.0f );
+
+	// looking at the ground shows the drips all around
+	WeatherView.spawnInView = fabs( v_angles[PITCH] ) < 45.0f;
+}
+
+/*
+=================================
+WeatherPointVisible
+
+conservative sphere against view cone test
+=================================
+*/
+inline bool WeatherPointVisible( float x, float y, float z, float radius )
+{
+	Vector dir( x - WeatherView.origin.x, y - WeatherView.origin.y, z - WeatherView.origin.z );
+	float dot = DotProduct( dir, WeatherView.forward );
+
+	if( dot < -radius )
+		return false;
+
+	return dot + radius >= dir.Length() * WeatherView.cosHalfDiag;
+}
+
+/*
+=================================
+PickDripStart
+
+most drips go where the player looks
+=================================
+*/
+void PickDripStart( Vector &vecStart )
+{
+	if( WeatherView.spawnInView && gEngfuncs.pfnRandomFloat( 0, 1 ) < WEATHER_VIEW_SPAWN )
+	{
+		// uniform over a circular sector
+		float yaw = ( WeatherView.yaw + gEngfuncs.pfnRandomFloat( -WeatherView.halfFovX, WeatherView.halfFovX )) * M_PI / 180.0f;
+		float dist = Rain.distFromPlayer * sqrt( gEngfuncs.pfnRandomFloat( 0, 1 ));
+
+		vecStart.x = gHUD.m_vecOrigin.x + cos( yaw ) * dist;
+		vecStart.y = gHUD.m_vecOrigin.y + sin( yaw ) * dist;
+	}
+	else
+	{
+		vecStart.x = gEngfuncs.pfnRandomFloat( gHUD.m_vecOrigin.x - Rain.distFromPlayer, gHUD.m_vecOrigin.x + Rain.distFromPlayer );
+		vecStart.y = gEngfuncs.pfnRandomFloat( gHUD.m_vecOrigin.y - Rain.distFromPlayer, gHUD.m_vecOrigin.y + Rain.distFromPlayer );
+	}
+
+	vecStart.z = gHUD.m_vecOrigin.z + Rain.heightFromPlayer;
+}
+
+/*
+=================================
+TraceDripLanding
+
+returns false if drip cannot be placed
+=================================
+*/
+bool TraceDripLanding( Vector vecStart, Vector vecEnd, float *deathHeight, byte *land )
+{
+	Vector vecStartStart;
+	pmtrace_t pmtrace;
+
+	gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
+	gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_WORLD_ONLY, -1, &pmtrace );
+
+	if( pmtrace.startsolid )
+		return false; // drip cannot be placed
+
+	vecStartStart = vecStart;
+	vecStartStart.z = 999999;
+
+	// second trace. Check that player have a real sky above him
+	const char *s = gEngfuncs.pEventAPI->EV_TraceTexture( pmtrace.ent, vecStart, vecStartStart );
+	if( !s || strcmp( s, "sky" ) )
+		return false;
+
+	// falling to water?
+	int contents = gEngfuncs.PM_PointContents( pmtrace.endpos, NULL );
+	if( contents == CONTENTS_WATER )
 	{
-		gEngfuncs.Con_Printf( "Rain error: failed to allocate FX object!\n");
-		return;
+		int waterEntity = gEngfuncs.PM_WaterEntity( pmtrace.endpos );
+		if( waterEntity > 0 )
+		{
+			cl_entity_t *pwater = gEngfuncs.GetEntityByIndex( waterEntity );
+			if( pwater && ( pwater->model != NULL ) )
+			{
+				*deathHeight = pwater->curstate.maxs[2];
+			}
+			else
+			{
+				gEngfuncs.Con_Printf("Rain error: can't get water entity\n");
+				return false;
+			}
+		}
+		else
+		{
+			gEngfuncs.Con_Printf("Rain error: water is not func_water entity\n");
+			return false;
+		}
+
+		*land = WATER_LANDING;
 	}
+	else
+	{
+		*deathHeight = pmtrace.endpos[2];
+		*land = NO_LANDING;
+	}
+	return true;
+}
+
+/*
+=================================
+FindDripLanding
 
-	newFX->alpha = gEngfuncs.pfnRandomFloat(0.6, 0.9);
-	newFX->origin = drip->origin;
-	newFX->origin.z = drip->minHeight; // correct position
-	newFX->birthTime = Rain.curtime;
-	newFX->life = gEngfuncs.pfnRandomFloat(0.7, 1);
-	newFX->type = drip->land;
-
-	// add to first place in chain
-	newFX->p_Next = FirstChainFX.p_Next;
-	newFX->p_Prev = &FirstChainFX;
-	if (newFX->p_Next != NULL)
-		newFX->p_Next->p_Prev = newFX;
-	FirstChainFX.p_Next = newFX;
-
-	Rain.fxcounter++;
+TraceDripLanding cached on a coarse grid
+=================================
+*/
+bool FindDripLanding( const Vector &vecStart, const Vector &vecEnd, float *deathHeight, byte *land )
+{
+	int x = (int)floor( vecStart.x / WEATHER_GRID_CELL );
+	int y = (int)floor( vecStart.y / WEATHER_GRID_CELL );
+	weathercell_t *cell = &WeatherGrid[((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ) & ( WEATHER_GRID_SIZE - 1 )];
+
+	if( !cell->used || cell->x != x || cell->y != y || fabs( cell->startZ - vecStart.z ) > WEATHER_GRID_MAXDZ )
+	{
+		// trace from the cell center, so the result doesn't depend on the first drip
+		Vector vecCenter(( x + 0.5f ) * WEATHER_GRID_CELL, ( y + 0.5f ) * WEATHER_GRID_CELL, vecStart.z );
+
+		cell->used = true;
+		cell->x = x;
+		cell->y = y;
+		cell->startZ = vecStart.z;
+		cell->valid = TraceDripLanding( vecCenter, vecEnd, &cell->deathHeight, &cell->land );
+	}
+
+	if( !cell->valid )
+		return false;
+
+	*deathHeight = cell->deathHeight;
+	*land = cell->land;
+	return true;
 }
+
 /*
 =================================
 ProcessRain
@@ -171,8 +398,10 @@ void ProcessRain( void )
 	if( Rain.dripsPerSecond == 0 || !Rain.weatherValue )
 		return; // disabled
 
+	SetupWeatherView();
+
 	// first frame
-	if( Rain.oldtime == 0 || ( Rain.dripsPerSecond == 0 && FirstChainDrip.p_Next == NULL ) )
+	if( Rain.oldtime == 0 || ( Rain.dripsPerSecond == 0 && Rain.dripcounter == 0 ) )
 	{
 		// fix first frame bug with nextspawntime
 		Rain.nextspawntime = Rain.curtime;
@@ -193,35 +422,35 @@ void ProcessRain( void )
 	int debug_dropped = 0;
 #endif
 
-	for( cl_drip_t *curDrip = FirstChainDrip.p_Next, *nextDrip = NULL;
-		 curDrip;
-		 curDrip = nextDrip ) // go through list
-	{
-		nextDrip = curDrip->p_Next; // save pointer to next drip
+	// move all drips in one pass over contiguous arrays
+	float fallDelta = Rain.timedelta * speed;
+	int i;
 
-		curDrip->origin.x += Rain.timedelta * curDrip->Delta.x;
-		curDrip->origin.y += Rain.timedelta * curDrip->Delta.y;
-		curDrip->origin.z -= Rain.timedelta * speed;
+	for( i = 0; i < Rain.dripcounter; i++ )
+	{
+		Drips.x[i] += Rain.timedelta * Drips.deltaX[i];
+		Drips.y[i] += Rain.timedelta * Drips.deltaY[i];
+		Drips.z[i] -= fallDelta;
+	}
 
-		// remove drip if its origin lower than minHeight
-		if (curDrip->origin.z < curDrip->minHeight)
+	// remove drips whose origin is lower than minHeight
+	for( i = 0; i < Rain.dripcounter; )
+	{
+		if( Drips.z[i] >= Drips.minHeight[i] )
 		{
-			LandingEffect( curDrip );
-#ifdef _DEBUG
-			if( debug_rain->value )
-			{
-				debug_lifetime += ( Rain.curtime - curDrip->birthTime );
-				debug_howmany++;
-			}
-#endif
-
-			curDrip->p_Prev->p_Next = curDrip->p_Next; // link chain
-			if( nextDrip != NULL )
-				nextDrip->p_Prev = curDrip->p_Prev;
-			delete curDrip;
+			i++;
+			continue;
+		}
 
-			Rain.dripcounter--;
+		LandingEffect( i );
+#ifdef _DEBUG
+		if( debug_rain->value )
+		{
+			debug_lifetime += ( Rain.curtime - Drips.birthTime[i] );
+			debug_howmany++;
 		}
+#endif
+		RemoveDrip( i ); // the last drip moves here and is checked next
 	}
 
 	int maxDelta = speed * Rain.timedelta; // maximum height randomize distance
@@ -234,27 +463,22 @@ void ProcessRain( void )
 			debug_attempted++;
 #endif
 				
-		if( Rain.dripcounter < spawnDrips ) // check for overflow
+		if( Rain.dripcounter < spawnDrips && Rain.dripcounter < MAXDRIPS ) // check for overflow
 		{
 			float deathHeight;
-			Vector vecStart, vecEnd, vecStartStart;
+			byte land;
+			Vector vecStart, vecEnd;
 			Vector2D Delta( Rain.wind.x + gEngfuncs.pfnRandomFloat( Rain.rand.x * -1, Rain.rand.x ),
 							Rain.wind.y + gEngfuncs.pfnRandomFloat( Rain.rand.y * -1, Rain.rand.y ));
-			pmtrace_t pmtrace, pmtrace2;
 
-			vecStart.x = gEngfuncs.pfnRandomFloat( gHUD.m_vecOrigin.x - Rain.distFromPlayer, gHUD.m_vecOrigin.x + Rain.distFromPlayer );
-			vecStart.y = gEngfuncs.pfnRandomFloat( gHUD.m_vecOrigin.y - Rain.distFromPlayer, gHUD.m_vecOrigin.y + Rain.distFromPlayer );
-			vecStart.z = gHUD.m_vecOrigin.z + Rain.heightFromPlayer;
+			PickDripStart( vecStart );
 
 			// find a point at bottom of map
 			vecEnd.x = falltime * Delta.x;
 			vecEnd.y = falltime * Delta.y;
 			vecEnd.z = -4096;
 
-			gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-			gEngfuncs.pEventAPI->EV_PlayerTrace( vecStart, vecEnd, PM_WORLD_ONLY, -1, &pmtrace );
-
-			if( pmtrace.startsolid )
+			if( !FindDripLanding( vecStart, vecEnd, &deathHeight, &land ))
 			{
 #ifdef _DEBUG
 				if( debug_rain->value )
@@ -263,49 +487,6 @@ void ProcessRain( void )
 				continue; // drip cannot be placed
 			}
 
-			vecStartStart = vecStart;
-			vecStartStart.z = 999999;
-
-			// second trace. Check that player have a real sky above him
-			const char *s = gEngfuncs.pEventAPI->EV_TraceTexture( pmtrace.ent, vecStart, vecStartStart );
-			if( !s || strcmp( s, "sky" ) )
-			{
-#ifdef _DEBUG
-				if( debug_rain->value )
-					debug_dropped++;
-#endif
-				continue;
-			}
-			
-			// falling to water?
-			int contents = gEngfuncs.PM_PointContents( pmtrace.endpos, NULL );
-			if( contents == CONTENTS_WATER )
-			{
-				int waterEntity = gEngfuncs.PM_WaterEntity( pmtrace.endpos );
-				if( waterEntity > 0 )
-				{
-					cl_entity_t *pwater = gEngfuncs.GetEntityByIndex( waterEntity );
-					if( pwater && ( pwater->model != NULL ) )
-					{
-						deathHeight = pwater->curstate.maxs[2];
-					}
-					else
-					{
-						gEngfuncs.Con_Printf("Rain error: can't get water entity\n");
-						continue;
-					}
-				}
-				else
-				{
-					gEngfuncs.Con_Printf("Rain error: water is not func_water entity\n");
-					continue;
-				}
-			}
-			else
-			{
-				deathHeight = pmtrace.endpos[2];
-			}
-
 			// just in case..
 			if (deathHeight > vecStart[2])
 			{
@@ -313,47 +494,19 @@ void ProcessRain( void )
 				continue;
 			}
 
-			cl_drip_t *newClDrip = new(std::nothrow) cl_drip_t;
-			if( !newClDrip )
-			{
-				Rain.dripsPerSecond = 0; // disable rain
-				gEngfuncs.Con_Printf( "Rain error: failed to allocate object!\n");
-				return;
-			}
-			
 			vecStart[2] -= gEngfuncs.pfnRandomFloat( 0, maxDelta ); // randomize a bit
-			
-			newClDrip->alpha     = gEngfuncs.pfnRandomFloat( 0.12, 0.2 );
-			newClDrip->origin    = vecStart;
-			newClDrip->Delta     = Delta;
-			newClDrip->birthTime = Rain.curtime; // store time when it was spawned
-			newClDrip->minHeight = deathHeight;
-
-			if( contents == CONTENTS_WATER )
-			{
-				newClDrip->land = WATER_LANDING;
-			}
-			else
-			{
-				newClDrip->land = NO_LANDING;
-			}
-			/*else if( pmtrace->fraction < 1.0f && pmtrace->plane.normal.z > 0.71 && !pmtrace->inopen)
-			{
-				newClDrip->land = DEFAULT_LANDING;
-			}
-			else
-			{
-				newClDrip->land = NO_LANDING;
-			}*/
 
-			// add to first place in chain
-			newClDrip->p_Next = FirstChainDrip.p_Next;
-			newClDrip->p_Prev = &FirstChainDrip;
-			if (newClDrip->p_Next != NULL)
-				newClDrip->p_Next->p_Prev = newClDrip;
-			FirstChainDrip.p_Next = newClDrip;
-
-			Rain.dripcounter++;
+			int drip = Rain.dripcounter++;
+
+			Drips.alpha[drip]     = gEngfuncs.pfnRandomFloat( 0.12, 0.2 );
+			Drips.x[drip]         = vecStart.x;
+			Drips.y[drip]         = vecStart.y;
+			Drips.z[drip]         = vecStart.z;
+			Drips.deltaX[drip]    = Delta.x;
+			Drips.deltaY[drip]    = Delta.y;
+			Drips.birthTime[drip] = Rain.curtime; // store time when it was spawned
+			Drips.minHeight[drip] = deathHeight;
+			Drips.land[drip]      = land;
 		}
 		else
 		{
@@ -399,22 +552,12 @@ Call every frame before ProcessRain
 */
 void ProcessFXObjects( void )
 {
-	for( cl_rainfx_t *curFX = FirstChainFX.p_Next, *nextFX = NULL;
-		 curFX;
-		 curFX = nextFX )
+	for( int i = 0; i < Rain.fxcounter; )
 	{
-		nextFX = curFX->p_Next; // save pointer to next
-
 		// delete current?
-		if( curFX->birthTime + curFX->life < Rain.curtime )
-		{
-			curFX->p_Prev->p_Next = curFX->p_Next; // link chain
-			if( nextFX )
-				nextFX->p_Prev = curFX->p_Prev;
-
-			delete curFX;
-			Rain.fxcounter--;
-		}
+		if( FX.birthTime[i] + FX.life[i] < Rain.curtime )
+			RemoveFX( i ); // the last fx moves here and is checked next
+		else i++;
 	}
 }
 
@@ -427,22 +570,7 @@ clear memory, delete all objects
 */
 void ResetRain( void )
 {
-	// delete all drips
-	for( cl_drip_t *curDrip = FirstChainDrip.p_Next; curDrip;
-		 curDrip = FirstChainDrip.p_Next, Rain.dripcounter-- )
-	{
-		FirstChainDrip.p_Next = curDrip->p_Next;
-		delete curDrip;
-	}
-
-	// delete all FX objects
-	for( cl_rainfx_t *curFX = FirstChainFX.p_Next; curFX;
-		 curFX = FirstChainFX.p_Next, Rain.fxcounter-- )
-	{
-		FirstChainFX.p_Next = curFX->p_Next;
-		delete curFX;
-	}
-
+	// pools are emptied by resetting the counters
 	InitRain();
 	return;
 }
@@ -480,8 +608,7 @@ initialze system
 void InitRain( void )
 {
 	memset( &Rain, 0, sizeof(Rain) );
-	memset( &FirstChainDrip, 0, sizeof( cl_drip_t ));
-	memset( &FirstChainFX, 0, sizeof( cl_rainfx_t ));
+	memset( WeatherGrid, 0, sizeof( WeatherGrid ));
 
 #ifdef _DEBUG
 	if( !debug_rain )
@@ -501,16 +628,93 @@ void InitRain( void )
 }
 
 
-void SetPoint( float x, float y, float z, float (*matrix)[4])
+// geometry of all particles of one kind is built here and sent in as few Begin/End as possible
+#define WEATHER_BATCH_VERTS	3072	// multiple of 3 and 6, so particles never straddle a flush
+
+struct weathervert_t
 {
-	Vector point( x, y, z ), result;
+	float pos[3];
+	float s, t;
+	float alpha;	// Color4f is only sent when it changes
+};
+
+static weathervert_t WeatherVerts[WEATHER_BATCH_VERTS];
+static int numWeatherVerts;
+
+/*
+=================================
+FlushWeatherVerts
+
+submit collected vertices as one triangle list
+=================================
+*/
+void FlushWeatherVerts( void )
+{
+	float alpha = -1.0f;
+
+	if( !numWeatherVerts )
+		return;
 
-	VectorTransform( point, matrix, result );
+	gEngfuncs.pTriAPI->Begin( TRI_TRIANGLES );
 
-	gEngfuncs.pTriAPI->Vertex3fv( result );
+	for( int i = 0; i < numWeatherVerts; i++ )
+	{
+		weathervert_t *v = &WeatherVerts[i];
+
+		if( v->alpha != alpha )
+		{
+			alpha = v->alpha;
+			gEngfuncs.pTriAPI->Color4f( 1.0, 1.0, 1.0, alpha );
+		}
+
+		gEngfuncs.pTriAPI->TexCoord2f( v->s, v->t );
+		gEngfuncs.pTriAPI->Vertex3fv( v->pos );
+	}
+
+	gEngfuncs.pTriAPI->End();
+
+	numWeatherVerts = 0;
 }
 
+inline weathervert_t *AllocWeatherVerts( int count )
+{
+	if( numWeatherVerts + count > WEATHER_BATCH_VERTS )
+		FlushWeatherVerts();
 
+	weathervert_t *v = &WeatherVerts[numWeatherVerts];
+	numWeatherVerts += count;
+
+	return v;
+}
+
+inline void SetWeatherVert( weathervert_t *v, float x, float y, float z, float s, float t, float alpha )
+{
+	v->pos[0] = x;
+	v->pos[1] = y;
+	v->pos[2] = z;
+	v->s = s;
+	v->t = t;
+	v->alpha = alpha;
+}
+
+/*
+=================================
+AddWeatherQuad
+
+two triangles, corners are given clockwise starting from texcoord (0,0)
+=================================
+*/
+inline void AddWeatherQuad( const float *v0, const float *v1, const float *v2, const float *v3, float alpha )
+{
+	weathervert_t *v = AllocWeatherVerts( 6 );
+
+	SetWeatherVert( v + 0, v0[0], v0[1], v0[2], 0, 0, alpha );
+	SetWeatherVert( v + 1, v1[0], v1[1], v1[2], 0, 1, alpha );
+	SetWeatherVert( v + 2, v2[0], v2[1], v2[2], 1, 1, alpha );
+	SetWeatherVert( v + 3, v0[0], v0[1], v0[2], 0, 0, alpha );
+	SetWeatherVert( v + 4, v2[0], v2[1], v2[2], 1, 1, alpha );
+	SetWeatherVert( v + 5, v3[0], v3[1], v3[2], 1, 0, alpha );
+}
 
 /*
 =================================
@@ -521,7 +725,7 @@ draw raindrips and snowflakes
 */
 void DrawRain( void )
 {
-	if (FirstChainDrip.p_Next == NULL)
+	if (Rain.dripcounter == 0)
 		return; // no drips to draw
 
 	cl_entity_t *player = gEngfuncs.GetLocalPlayer();
@@ -533,82 +737,81 @@ void DrawRain( void )
 		gEngfuncs.pTriAPI->RenderMode( kRenderTransAdd );
 		gEngfuncs.pTriAPI->CullFace( TRI_NONE );
 
-		for( cl_drip_t *Drip = FirstChainDrip.p_Next; Drip; Drip = Drip->p_Next )
+		for( int i = 0; i < Rain.dripcounter; i++ )
 		{
-			Vector2D toPlayer, shift(Drip->Delta * DRIP_SPRITE_HALFHEIGHT / DRIPSPEED);
-			toPlayer.x = (player->origin.x - Drip->origin.x) * DRIP_SPRITE_HALFWIDTH;
-			toPlayer.y = (player->origin.y - Drip->origin.y) * DRIP_SPRITE_HALFWIDTH;
-			toPlayer = toPlayer.Normalize();
-
-			// --- draw triangle --------------------------
-			gEngfuncs.pTriAPI->Color4f( 1.0, 1.0, 1.0, Drip->alpha );
-			gEngfuncs.pTriAPI->Begin( TRI_TRIANGLES );
-
-				gEngfuncs.pTriAPI->TexCoord2f( 0, 0 );
-				gEngfuncs.pTriAPI->Vertex3f( Drip->origin.x-toPlayer.y - shift.x,
-						Drip->origin.y + toPlayer.x - shift.y,
-						Drip->origin.z + DRIP_SPRITE_HALFHEIGHT );
-
-				gEngfuncs.pTriAPI->TexCoord2f( 0.5, 1 );
-				gEngfuncs.pTriAPI->Vertex3f( Drip->origin.x + shift.x,
-						Drip->origin.y + shift.y,
-						Drip->origin.z - DRIP_SPRITE_HALFHEIGHT );
-
-				gEngfuncs.pTriAPI->TexCoord2f( 1, 0 );
-				gEngfuncs.pTriAPI->Vertex3f( Drip->origin.x+toPlayer.y - shift.x,
-						Drip->origin.y - toPlayer.x - shift.y,
-						Drip->origin.z + DRIP_SPRITE_HALFHEIGHT);
-
-			gEngfuncs.pTriAPI->End();
-			// --- draw triangle end ----------------------
+			if( !WeatherPointVisible( Drips.x[i], Drips.y[i], Drips.z[i], DRIP_SPRITE_HALFHEIGHT ))
+				continue;
+
+			Vector2D side, shift(Vector2D( Drips.deltaX[i], Drips.deltaY[i] ) * DRIP_SPRITE_HALFHEIGHT / DRIPSPEED);
+			Vector2D toPlayer( player->origin.x - Drips.x[i], player->origin.y - Drips.y[i] );
+
+			// far drips are too thin to tell, skip the normalize
+			if( toPlayer.x * toPlayer.x + toPlayer.y * toPlayer.y > RAIN_LOD_DIST * RAIN_LOD_DIST )
+			{
+				side = WeatherView.right;
+			}
+			else
+			{
+				toPlayer = ( toPlayer * DRIP_SPRITE_HALFWIDTH ).Normalize();
+				side = Vector2D( -toPlayer.y, toPlayer.x );
+			}
+
+			// --- triangle facing the player --------------------------
+			weathervert_t *v = AllocWeatherVerts( 3 );
+
+			SetWeatherVert( v + 0, Drips.x[i] + side.x - shift.x,
+					Drips.y[i] + side.y - shift.y,
+					Drips.z[i] + DRIP_SPRITE_HALFHEIGHT, 0, 0, Drips.alpha[i] );
+
+			SetWeatherVert( v + 1, Drips.x[i] + shift.x,
+					Drips.y[i] + shift.y,
+					Drips.z[i] - DRIP_SPRITE_HALFHEIGHT, 0.5, 1, Drips.alpha[i] );
+
+			SetWeatherVert( v + 2, Drips.x[i] - side.x - shift.x,
+					Drips.y[i] - side.y - shift.y,
+					Drips.z[i] + DRIP_SPRITE_HALFHEIGHT, 1, 0, Drips.alpha[i] );
 		}
+
+		FlushWeatherVerts();
 	}
 
 	else	// draw snow
 	{
 		const model_s *pTexture = gEngfuncs.GetSpritePointer( Rain.hsprSnow );
 		float visibleHeight = Rain.globalHeight - SNOWFADEDIST;
-		vec3_t normal;
-		float  matrix[3][4];
+		float fadeTop = gHUD.m_vecOrigin.z + Rain.heightFromPlayer;
+		vec3_t normal, forward, right, up;
+		Vector corner[4];
 
 		gEngfuncs.GetViewAngles( normal );
-		AngleMatrix (normal, matrix);	// calc view matrix
+		AngleVectors( normal, forward, right, up );
+
+		// billboard corners are the same for every flake, only the origin moves
+		corner[0] = ( up - right ) * SNOW_SPRITE_HALFSIZE;
+		corner[1] = ( -up - right ) * SNOW_SPRITE_HALFSIZE;
+		corner[2] = ( -up + right ) * SNOW_SPRITE_HALFSIZE;
+		corner[3] = ( up + right ) * SNOW_SPRITE_HALFSIZE;
 
 		gEngfuncs.pTriAPI->SpriteTexture( (struct model_s *)pTexture, 0 );
 		gEngfuncs.pTriAPI->RenderMode( kRenderTransAdd );
 		gEngfuncs.pTriAPI->CullFace( TRI_NONE );
 
-
-		for( cl_drip_t *Drip = FirstChainDrip.p_Next; Drip; Drip = Drip->p_Next )
+		for( int i = 0; i < Rain.dripcounter; i++ )
 		{
-			matrix[0][3] = Drip->origin.x; // write origin to matrix
-			matrix[1][3] = Drip->origin.y;
-			matrix[2][3] = Drip->origin.z;
-
-			// apply start fading effect
-			float alpha = (Drip->origin.z <= visibleHeight) ?
-							  Drip->alpha :
-							  (((gHUD.m_vecOrigin.z + Rain.heightFromPlayer) - Drip->origin.z) / (float)SNOWFADEDIST) * Drip->alpha;
-
-			// --- draw quad --------------------------
-			gEngfuncs.pTriAPI->Color4f( 1.0, 1.0, 1.0, alpha );
-			gEngfuncs.pTriAPI->Begin( TRI_QUADS );
-
-				gEngfuncs.pTriAPI->TexCoord2f( 0, 0 );
-				SetPoint(0, SNOW_SPRITE_HALFSIZE, SNOW_SPRITE_HALFSIZE, matrix);
-
-				gEngfuncs.pTriAPI->TexCoord2f( 0, 1 );
-				SetPoint(0, SNOW_SPRITE_HALFSIZE, -SNOW_SPRITE_HALFSIZE, matrix);
+			if( !WeatherPointVisible( Drips.x[i], Drips.y[i], Drips.z[i], SNOW_SPRITE_HALFSIZE * 2 ))
+				continue;
 
-				gEngfuncs.pTriAPI->TexCoord2f( 1, 1 );
-				SetPoint(0, -SNOW_SPRITE_HALFSIZE, -SNOW_SPRITE_HALFSIZE, matrix);
+			Vector origin( Drips.x[i], Drips.y[i], Drips.z[i] );
 
-				gEngfuncs.pTriAPI->TexCoord2f( 1, 0 );
-				SetPoint(0, -SNOW_SPRITE_HALFSIZE, SNOW_SPRITE_HALFSIZE, matrix);
+			// apply start fading effect
+			float alpha = (Drips.z[i] <= visibleHeight) ?
+							  Drips.alpha[i] :
+							  ((fadeTop - Drips.z[i]) / (float)SNOWFADEDIST) * Drips.alpha[i];
 
-			gEngfuncs.pTriAPI->End();
-			// --- draw quad end ----------------------
+			AddWeatherQuad( origin + corner[0], origin + corner[1], origin + corner[2], origin + corner[3], alpha );
 		}
+
+		FlushWeatherVerts();
 	}
 }
 
@@ -619,41 +822,38 @@ DrawFXObjects
 */
 void DrawFXObjects( void )
 {
+	if( Rain.fxcounter == 0 )
+		return;
+
 	const model_s *pTexture = gEngfuncs.GetSpritePointer( Rain.hsprRipple );
 	gEngfuncs.pTriAPI->SpriteTexture( (struct model_s *)pTexture, 0 );
 	gEngfuncs.pTriAPI->RenderMode( kRenderTransAdd );
 	gEngfuncs.pTriAPI->CullFace( TRI_NONE );
 
 	// go through objects list
-	for( cl_rainfx_t *curFX = FirstChainFX.p_Next; curFX; curFX = curFX->p_Next )
+	for( int i = 0; i < Rain.fxcounter; i++ )
 	{
-		switch( curFX->type )
+		switch( FX.type[i] )
 		{
 		case WATER_LANDING:
 		{
 			// fadeout
-			float alpha = ((curFX->birthTime + curFX->life - Rain.curtime) / curFX->life) * curFX->alpha;
-			float size = (Rain.curtime - curFX->birthTime) * MAXRINGHALFSIZE;
-
-			// --- draw quad --------------------------
-			gEngfuncs.pTriAPI->Color4f( 1.0, 1.0, 1.0, alpha );
-			gEngfuncs.pTriAPI->Begin( TRI_QUADS );
+			float alpha = ((FX.birthTime[i] + FX.life[i] - Rain.curtime) / FX.life[i]) * FX.alpha[i];
+			float size = (Rain.curtime - FX.birthTime[i]) * MAXRINGHALFSIZE;
 
-				gEngfuncs.pTriAPI->TexCoord2f( 0, 0 );
-				gEngfuncs.pTriAPI->Vertex3f(curFX->origin.x - size, curFX->origin.y - size, curFX->origin.z);
+			if( !WeatherPointVisible( FX.x[i], FX.y[i], FX.z[i], size * 1.5f ))
+				break;
 
-				gEngfuncs.pTriAPI->TexCoord2f( 0, 1 );
-				gEngfuncs.pTriAPI->Vertex3f(curFX->origin.x - size, curFX->origin.y + size, curFX->origin.z);
+			// --- flat quad on the water surface --------------------------
+			Vector v0( FX.x[i] - size, FX.y[i] - size, FX.z[i] );
+			Vector v1( FX.x[i] - size, FX.y[i] + size, FX.z[i] );
+			Vector v2( FX.x[i] + size, FX.y[i] + size, FX.z[i] );
+			Vector v3( FX.x[i] + size, FX.y[i] - size, FX.z[i] );
 
-				gEngfuncs.pTriAPI->TexCoord2f( 1, 1 );
-				gEngfuncs.pTriAPI->Vertex3f(curFX->origin.x + size, curFX->origin.y + size, curFX->origin.z);
-
-				gEngfuncs.pTriAPI->TexCoord2f( 1, 0 );
-				gEngfuncs.pTriAPI->Vertex3f(curFX->origin.x + size, curFX->origin.y - size, curFX->origin.z);
-
-			gEngfuncs.pTriAPI->End();
-			// --- draw quad end ----------------------
+			AddWeatherQuad( v0, v1, v2, v3, alpha );
 		}
 		}
 	}
+
+	FlushWeatherVerts();
 }
@@ -78,58 +78,31 @@ static client_anim_state_t g_clientstate;
 CGameStudioModelRenderer::CGameStudioModelRenderer(void)
 {
 	m_bLocal = false;
+	m_pPrepassPlayerInfo = NULL;
+	memset(m_pMinModels, 0, sizeof(m_pMinModels));
 }
 
-mstudioanim_t *CGameStudioModelRenderer::LookupAnimation(mstudioseqdesc_t *pseqdesc, int index)
+void CGameStudioModelRenderer::VidInit(void)
 {
-	mstudioanim_t *panim = NULL;
+	CStudioModelRenderer::VidInit();
 
-	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-
-	if (index < 0)
-		return panim;
-
-	if (index > (pseqdesc->numblends - 1))
-		return panim;
-
-	panim += index * m_pStudioHeader->numbones;
-	return panim;
+	memset(m_pMinModels, 0, sizeof(m_pMinModels));
 }
 
-void CGameStudioModelRenderer::StudioSetupBones(void)
+model_t *CGameStudioModelRenderer::GetMinModel(int index)
 {
-	int i;
-	double f;
-
-	mstudiobone_t *pbones;
-	mstudioseqdesc_t *pseqdesc;
-	mstudioanim_t *panim;
-
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
-
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
+	// resolved by name once per map instead of every draw
+	if (!m_pMinModels[index])
+		m_pMinModels[index] = gEngfuncs.CL_LoadModel(sPlayerModelFiles[index], NULL);
 
-	if (!m_pCurrentEntity->player)
-	{
-		CStudioModelRenderer::StudioSetupBones();
-		return;
-	}
+	return m_pMinModels[index];
+}
 
+void CGameStudioModelRenderer::StudioAdjustPlayerBlend(void)
+{
 	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
 		m_pCurrentEntity->curstate.sequence = 0;
 
-	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
-	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-
-	f = StudioEstimateFrame(pseqdesc);
-
 	if (m_pPlayerInfo->gaitsequence == ANIM_WALK_SEQUENCE)
 	{
 		if (m_pCurrentEntity->curstate.blending[0] <= 26)
@@ -143,238 +116,65 @@ void CGameStudioModelRenderer::StudioSetupBones(void)
 			m_pCurrentEntity->latched.prevseqblending[0] = m_pCurrentEntity->curstate.blending[0];
 		}
 	}
+}
 
-	if (pseqdesc->numblends == 9)
-	{
-		float s = m_pCurrentEntity->curstate.blending[0];
-		float t = m_pCurrentEntity->curstate.blending[1];
-
-		if (s <= 127.0)
-		{
-			s = (s * 2.0);
-
-			if (t <= 127.0)
-			{
-				t = (t * 2.0);
-
-				StudioCalcRotations(pos, q, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 1);
-				StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 3);
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 4);
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
-			}
-			else
-			{
-				t = 2.0 * (t - 127.0);
-
-				panim = LookupAnimation(pseqdesc, 3);
-				StudioCalcRotations(pos, q, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 4);
-				StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 6);
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 7);
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
-			}
-		}
-		else
-		{
-			s = 2.0 * (s - 127.0);
-
-			if (t <= 127.0)
-			{
-				t = (t * 2.0);
-
-				panim = LookupAnimation(pseqdesc, 1);
-				StudioCalcRotations(pos, q, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 2);
-				StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 4);
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 5);
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
-			}
-			else
-			{
-				t = 2.0 * (t - 127.0);
-
-				panim = LookupAnimation(pseqdesc, 4);
-				StudioCalcRotations(pos, q, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 5);
-				StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 7);
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
-				panim = LookupAnimation(pseqdesc, 8);
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
-			}
-		}
-
-		s /= 255.0;
-		t /= 255.0;
+void CGameStudioModelRenderer::StudioSetupBones(void)
+{
+	static float pos[MAXSTUDIOBONES][3];
+	static vec4_t q[MAXSTUDIOBONES];
 
-		StudioSlerpBones(q, pos, q2, pos2, s);
-		StudioSlerpBones(q3, pos3, q4, pos4, s);
-		StudioSlerpBones(q, pos, q3, pos3, t);
-	}
-	else
+	if (!m_pCurrentEntity->player)
 	{
-		StudioCalcRotations(pos, q, pseqdesc, panim, f);
+		CStudioModelRenderer::StudioSetupBones();
+		return;
 	}
 
-	if (m_fDoInterp && m_pCurrentEntity->latched.sequencetime && (m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) && (m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
-	{
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
-		float s = m_pCurrentEntity->latched.prevseqblending[0];
-		float t = m_pCurrentEntity->latched.prevseqblending[1];
+	StudioAdjustPlayerBlend();
 
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->latched.prevsequence;
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+	// player blends are not interpolated, so don't require them to be settled
+	StudioEvaluatePose(pos, q, false);
+	StudioCalcBoneTransforms(pos, q);
+}
 
-		if (pseqdesc->numblends == 9)
-		{
-			if (s <= 127.0)
-			{
-				s = (s * 2.0);
-
-				if (t <= 127.0)
-				{
-					t = (t * 2.0);
-
-					StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 1);
-					StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 3);
-					StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 4);
-					StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-				}
-				else
-				{
-					t = 2.0 * (t - 127.0);
-
-					panim = LookupAnimation(pseqdesc, 3);
-					StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 4);
-					StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 6);
-					StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 7);
-					StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-				}
-			}
-			else
-			{
-				s = 2.0 * (s - 127.0);
-
-				if (t <= 127.0)
-				{
-					t = (t * 2.0);
-
-					panim = LookupAnimation(pseqdesc, 1);
-					StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 2);
-					StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 4);
-					StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 5);
-					StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-				}
-				else
-				{
-					t = 2.0 * (t - 127.0);
-
-					panim = LookupAnimation(pseqdesc, 4);
-					StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 5);
-					StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 7);
-					StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-					panim = LookupAnimation(pseqdesc, 8);
-					StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-				}
-			}
+void CGameStudioModelRenderer::StudioSetupPoseInput(studioposeinput_t *input, double f, float gaitframe)
+{
+	CStudioModelRenderer::StudioSetupPoseInput(input, f, gaitframe);
 
-			s /= 255.0;
-			t /= 255.0;
+	if (m_pCurrentEntity->player)
+		input->blend9 = 1;
+}
 
-			StudioSlerpBones(q1b, pos1b, q2, pos2, s);
-			StudioSlerpBones(q3, pos3, q4, pos4, s);
-			StudioSlerpBones(q1b, pos1b, q3, pos3, t);
-		}
-		else
-		{
-			StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
-		}
+void CGameStudioModelRenderer::StudioSetupPoseGait(studioposeinput_t *input, float gaitframe)
+{
+	int sequence = m_pCurrentEntity->curstate.sequence;
 
-		s = 1.0 - (m_clTime - m_pCurrentEntity->latched.sequencetime) / 0.2;
-		StudioSlerpBones(q, pos, q1b, pos1b, s);
-	}
-	else
+	if (!m_pCurrentEntity->player)
 	{
-		m_pCurrentEntity->latched.prevframe = f;
+		CStudioModelRenderer::StudioSetupPoseGait(input, gaitframe);
+		return;
 	}
 
-	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
-
-	if (m_pPlayerInfo && (m_pCurrentEntity->curstate.sequence < ANIM_FIRST_DEATH_SEQUENCE || m_pCurrentEntity->curstate.sequence > ANIM_LAST_DEATH_SEQUENCE) && (m_pCurrentEntity->curstate.sequence < ANIM_FIRST_EMOTION_SEQUENCE || m_pCurrentEntity->curstate.sequence > ANIM_LAST_EMOTION_SEQUENCE) && m_pCurrentEntity->curstate.sequence != ANIM_SWIM_1 && m_pCurrentEntity->curstate.sequence != ANIM_SWIM_2)
-	{
-		int copy = 1;
-
-		if (m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq)
-			m_pPlayerInfo->gaitsequence = 0;
-
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex ) + m_pPlayerInfo->gaitsequence;
-
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe);
-
-		for (i = 0; i < m_pStudioHeader->numbones; i++)
-		{
-			if (!strcmp(pbones[i].name, "Bip01 Spine"))
-				copy = 0;
-			else if (!strcmp(pbones[pbones[i].parent].name, "Bip01 Pelvis"))
-				copy = 1;
+	if (!m_pPlayerInfo)
+		return;
 
-			if (copy)
-			{
-				memcpy(pos[i], pos2[i], sizeof(pos[i]));
-				memcpy(q[i], q2[i], sizeof(q[i]));
-			}
-		}
-	}
+	// whole body sequences keep their legs
+	if (sequence >= ANIM_FIRST_DEATH_SEQUENCE && sequence <= ANIM_LAST_DEATH_SEQUENCE)
+		return;
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
-	{
-		QuaternionMatrix(q[i], bonematrix);
+	if (sequence >= ANIM_FIRST_EMOTION_SEQUENCE && sequence <= ANIM_LAST_EMOTION_SEQUENCE)
+		return;
 
-		bonematrix[0][3] = pos[i][0];
-		bonematrix[1][3] = pos[i][1];
-		bonematrix[2][3] = pos[i][2];
+	if (sequence == ANIM_SWIM_1 || sequence == ANIM_SWIM_2)
+		return;
 
-		if (pbones[i].parent == -1)
-		{
-			if (IEngineStudio.IsHardware())
-			{
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
-				MatrixCopy((*m_pbonetransform)[i], (*m_plighttransform)[i]);
-			}
-			else
-			{
-				ConcatTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
-			}
+	if (m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq)
+		m_pPlayerInfo->gaitsequence = 0;
 
-			StudioFxTransform(m_pCurrentEntity, (*m_pbonetransform)[i]);
-		}
-		else
-		{
-			ConcatTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
-			ConcatTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
-		}
-	}
+	input->gaitmode = POSE_GAIT_MASK;
+	input->gaitsequence = m_pPlayerInfo->gaitsequence;
+	input->gaitframe = gaitframe;
+	input->gaitanim = StudioGetAnim(m_pRenderModel, (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + input->gaitsequence);
+	memcpy(input->gaitbones, m_ModelInfo.Get(m_pStudioHeader)->gaitbones, m_pStudioHeader->numbones);
 }
 
 void CGameStudioModelRenderer::StudioEstimateGait(entity_state_t *pplayer)
@@ -776,26 +576,129 @@ int CGameStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplaye
 	if (isLocalPlayer)
 		RestorePlayerState(pplayer);
 
-	if( gHUD.cl_shadows->value != 0.0f )
+	if( gHUD.cl_shadows->value != 0.0f && m_pCachedBonesHeader )
 	{
-		Vector chestpos;
+		int chestbone = m_ModelInfo.Get(m_pCachedBonesHeader)->chestbone;
 
-		for( int i = 0; i < m_nCachedBones; i++ )
+		if( chestbone >= 0 && chestbone < m_nCachedBones )
 		{
-			if( !strcmp(m_nCachedBoneNames[i], "Bip01 Spine3") )
-			{
-				chestpos.x = m_rgCachedBoneTransform[i][0][3];
-				chestpos.y = m_rgCachedBoneTransform[i][1][3];
-				chestpos.z = m_rgCachedBoneTransform[i][2][3];
-				StudioDrawShadow(chestpos, 20.0f);
-				break;
-			}
+			Vector chestpos;
+
+			chestpos.x = m_rgCachedBoneTransform[chestbone][0][3];
+			chestpos.y = m_rgCachedBoneTransform[chestbone][1][3];
+			chestpos.z = m_rgCachedBoneTransform[chestbone][2][3];
+			StudioDrawShadow(chestpos, 20.0f);
 		}
 	}
 
 	return iret;
 }
 
+/*
+====================
+StudioPosePrepass
+
+Runs before the first studio draw of a frame. The setup of every other
+player in view is replayed on copies of its state to learn the pose input
+its draw will have, and the evaluations go to the worker threads; the
+draws take the results in StudioEvaluatePose
+====================
+*/
+void CGameStudioModelRenderer::StudioPosePrepass(void)
+{
+	int i;
+	int framecount;
+	double cltime, cloldtime;
+	posekey_t key;
+	studioposeinput_t input;
+	cl_entity_t *ent, *local;
+
+	IEngineStudio.GetTimes(&framecount, &cltime, &cloldtime);
+
+	if (!m_PosePrepass.BeginFrame(framecount))
+		return;
+
+	local = gEngfuncs.GetLocalPlayer();
+
+	if (!local)
+		return;
+
+	cl_entity_t *saveent = m_pCurrentEntity;
+	model_t *savemodel = m_pRenderModel;
+	studiohdr_t *saveheader = m_pStudioHeader;
+	player_info_t *saveinfo = m_pPlayerInfo;
+	int saveindex = m_nPlayerIndex;
+	float savegait = m_flGaitMovement;
+
+	m_nFrameCount = framecount;
+	m_clTime = cltime;
+	m_clOldTime = cloldtime;
+
+	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
+
+	for (i = 1; i <= gEngfuncs.GetMaxClients(); i++)
+	{
+		ent = gEngfuncs.GetEntityByIndex(i);
+
+		// the local player animates from prediction, not from its entity
+		if (!ent || ent == local || !ent->player || !ent->model)
+			continue;
+
+		if (ent->curstate.messagenum != local->curstate.messagenum || (ent->curstate.effects & EF_NODRAW))
+			continue;
+
+		Vector delta = ent->origin - Vector(m_vRenderOrigin);
+
+		if (DotProduct(delta, m_vNormal) < -64.0f)
+			continue;
+
+		entity_state_t state = *IEngineStudio.GetPlayerState(i - 1);
+		cl_entity_t entcopy = *ent;
+		player_info_t infocopy = *IEngineStudio.PlayerInfo(i - 1);
+
+		m_pCurrentEntity = &entcopy;
+		m_pPrepassPlayerInfo = &infocopy;
+
+		if (StudioSetupPlayer(&state) && m_pStudioHeader->numbodyparts)
+		{
+			m_pPlayerInfo = &infocopy;
+			StudioAdjustPlayerBlend();
+
+			StudioBuildPose(&input, &key, false);
+
+			// the draw of a player at the reuse level evaluates its own pose
+			if (input.lod < ANIMLOD_REUSE)
+				m_PosePrepass.AddJob(i, &input);
+		}
+
+		m_pPrepassPlayerInfo = NULL;
+		m_pPlayerInfo = NULL;
+	}
+
+	m_PosePrepass.Run();
+
+	m_pCurrentEntity = saveent;
+	m_pRenderModel = savemodel;
+	m_pStudioHeader = saveheader;
+	m_pPlayerInfo = saveinfo;
+	m_nPlayerIndex = saveindex;
+	m_flGaitMovement = savegait;
+
+	if (m_pStudioHeader)
+	{
+		IEngineStudio.StudioSetHeader(m_pStudioHeader);
+		IEngineStudio.SetRenderModel(m_pRenderModel);
+	}
+}
+
+player_info_t *CGameStudioModelRenderer::StudioPlayerInfo(void)
+{
+	if (m_pPrepassPlayerInfo)
+		return m_pPrepassPlayerInfo;
+
+	return IEngineStudio.PlayerInfo(m_nPlayerIndex);
+}
+
 bool WeaponHasAttachments(entity_state_t *pplayer)
 {
 	studiohdr_t *modelheader = NULL;
@@ -813,23 +716,25 @@ bool WeaponHasAttachments(entity_state_t *pplayer)
 	return (modelheader->numattachments != 0);
 }
 
-int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplayer)
-{
-	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
-
-	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
-	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
-	IEngineStudio.GetAliasScale(&m_fSoftwareXScale, &m_fSoftwareYScale);
+/*
+====================
+StudioSetupPlayer
 
+Picks the model of a player and turns its state into sequence blends, gait
+and the model transform, everything that comes before the bone setup
+====================
+*/
+bool CGameStudioModelRenderer::StudioSetupPlayer(entity_state_t *pplayer)
+{
 	m_nPlayerIndex = pplayer->number - 1;
 
 	if (m_nPlayerIndex < 0 || m_nPlayerIndex >= gEngfuncs.GetMaxClients())
-		return 0;
+		return false;
 
 	/*m_pRenderModel = IEngineStudio.SetupPlayerModel(m_nPlayerIndex);
 
 	if (m_pRenderModel == NULL)
-		return 0;*/
+		return false;*/
 
 	extra_player_info_t *pExtra = g_PlayerExtraInfo + pplayer->number;
 
@@ -841,18 +746,18 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 			// set leet if model isn't valid
 			int modelIdx = gHUD.cl_min_t && BIsValidTModelIndex(gHUD.cl_min_t->value) ? gHUD.cl_min_t->value : 1;
 
-			m_pRenderModel = gEngfuncs.CL_LoadModel( sPlayerModelFiles[ modelIdx ], NULL );
+			m_pRenderModel = GetMinModel( modelIdx );
 		}
 		else if( team == TEAM_CT )
 		{
 			if( pExtra->vip )
-				m_pRenderModel = gEngfuncs.CL_LoadModel( sPlayerModelFiles[3], NULL );
+				m_pRenderModel = GetMinModel( 3 );
 			else
 			{
 				// set gign, if model isn't valud
 				int modelIdx = gHUD.cl_min_ct && BIsValidCTModelIndex(gHUD.cl_min_ct->value) ? gHUD.cl_min_ct->value : 2;
 
-				m_pRenderModel = gEngfuncs.CL_LoadModel( sPlayerModelFiles[ modelIdx ], NULL );
+				m_pRenderModel = GetMinModel( modelIdx );
 			}
 		}
 	}
@@ -863,13 +768,13 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 
 	if( !m_pRenderModel )
 	{
-		return 0;
+		return false;
 	}
 
 	m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata(m_pRenderModel);
 
 	if( !m_pStudioHeader )
-		return 0;
+		return false;
 
 	IEngineStudio.StudioSetHeader(m_pStudioHeader);
 	IEngineStudio.SetRenderModel(m_pRenderModel);
@@ -889,7 +794,7 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 	if (pplayer->gaitsequence)
 	{
 		vec3_t orig_angles(m_pCurrentEntity->angles);
-		m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
+		m_pPlayerInfo = StudioPlayerInfo();
 
 		StudioProcessGait(pplayer);
 
@@ -910,7 +815,7 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 		m_pCurrentEntity->latched.prevcontroller[2] = m_pCurrentEntity->curstate.controller[2];
 		m_pCurrentEntity->latched.prevcontroller[3] = m_pCurrentEntity->curstate.controller[3];
 
-		m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
+		m_pPlayerInfo = StudioPlayerInfo();
 
 		CalculatePitchBlend(pplayer);
 		CalculateYawBlend(pplayer);
@@ -919,6 +824,20 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 		StudioSetUpTransform(0);
 	}
 
+	return true;
+}
+
+int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplayer)
+{
+	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
+
+	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
+	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
+	IEngineStudio.GetAliasScale(&m_fSoftwareXScale, &m_fSoftwareYScale);
+
+	if (!StudioSetupPlayer(pplayer))
+		return 0;
+
 	if (flags & STUDIO_RENDER)
 	{
 		(*m_pModelsDrawn)++;
@@ -930,7 +849,7 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 
 	m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
 
-	StudioSetupBones();
+	StudioSetupBonesCached();
 	StudioSaveBones();
 
 	m_pPlayerInfo->renderframe = m_nFrameCount;
@@ -1003,7 +922,7 @@ int CGameStudioModelRenderer::_StudioDrawPlayer(int flags, entity_state_t *pplay
 			StudioCalcAttachments();
 
 			if (m_pCurrentEntity->index > 0)
-				memcpy(saveent.attachment, m_pCurrentEntity->attachment, sizeof(vec3_t) * m_pStudioHeader->numattachments);
+				memcpy(saveent.attachment, m_pCurrentEntity->attachment, sizeof(vec3_t) * m_ModelInfo.Get(m_pStudioHeader)->numattachments);
 
 			*m_pCurrentEntity = saveent;
 			m_pStudioHeader = saveheader;
@@ -1079,13 +998,27 @@ void R_StudioInit(void)
 	g_StudioRenderer.Init();
 }
 
+void R_StudioVidInit(void)
+{
+	g_StudioRenderer.VidInit();
+}
+
+void R_StudioShutdown(void)
+{
+	g_StudioRenderer.Shutdown();
+}
+
 int R_StudioDrawPlayer(int flags, entity_state_t *pplayer)
 {
+	g_StudioRenderer.StudioPosePrepass();
+
 	return g_StudioRenderer.StudioDrawPlayer(flags, pplayer);
 }
 
 int R_StudioDrawModel(int flags)
 {
+	g_StudioRenderer.StudioPosePrepass();
+
 	return g_StudioRenderer.StudioDrawModel(flags);
 }
 // The simple drawing interface we'll pass back to the engine
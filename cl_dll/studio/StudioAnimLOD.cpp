@@ -0,0 +1,125 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <string.h>
+#include <memory.h>
+#include <math.h>
+
+#include "StudioAnimLOD.h"
+
+CStudioAnimLOD::CStudioAnimLOD(void)
+{
+	m_pCvarAnimLOD = NULL;
+	m_pCvarSimple = NULL;
+	m_pCvarReuse = NULL;
+	m_pCvarInterval = NULL;
+
+	Flush();
+}
+
+void CStudioAnimLOD::Init(void)
+{
+	m_pCvarAnimLOD = CVAR_CREATE("cl_animlod", "1", FCVAR_ARCHIVE);
+	m_pCvarSimple = CVAR_CREATE("cl_animlod_simple", "64", FCVAR_ARCHIVE);	// pixels
+	m_pCvarReuse = CVAR_CREATE("cl_animlod_reuse", "24", FCVAR_ARCHIVE);	// pixels
+	m_pCvarInterval = CVAR_CREATE("cl_animlod_interval", "2", FCVAR_ARCHIVE);	// frames a sequence pose is kept, the gait still runs
+}
+
+void CStudioAnimLOD::Flush(void)
+{
+	for (int i = 0; i <= MAX_CLIENTS; i++)
+		m_Entries[i].hdr = NULL;
+}
+
+/*
+====================
+Level
+
+Picks the level for a model of this radius at this distance from the
+view, by the size it covers on screen
+====================
+*/
+int CStudioAnimLOD::Level(float radius, float distance)
+{
+	float fov, size;
+
+	if (!m_pCvarAnimLOD || !m_pCvarAnimLOD->value)
+		return ANIMLOD_NONE;
+
+	// screen not set up yet
+	if (ScreenWidth <= 0 || distance <= radius)
+		return ANIMLOD_NONE;
+
+	fov = gHUD.m_iFOV > 0 ? gHUD.m_iFOV : 90;
+	size = (2.0f * radius / distance) / tan(fov * (M_PI / 360.0)) * (ScreenWidth * 0.5f);
+
+	if (size < m_pCvarReuse->value)
+		return ANIMLOD_REUSE;
+
+	if (size < m_pCvarSimple->value)
+		return ANIMLOD_SIMPLE;
+
+	return ANIMLOD_NONE;
+}
+
+bool CStudioAnimLOD::Lookup(int index, int framecount, const studioposeinput_t *input, float pos[][3], vec4_t *q)
+{
+	animlod_entry_t *entry;
+
+	if (index < 1 || index > MAX_CLIENTS)
+		return false;
+
+	entry = &m_Entries[index];
+
+	if (!entry->hdr || entry->hdr != input->hdr || entry->length != input->length)
+		return false;
+
+	// a new sequence is shown right away
+	if (entry->sequence != input->sequence)
+		return false;
+
+	// level change or demo restart
+	if (framecount < entry->framecount || framecount - entry->framecount >= m_pCvarInterval->value)
+		return false;
+
+	memcpy(pos, entry->pos, sizeof(pos[0]) * input->hdr->numbones);
+	memcpy(q, entry->q, sizeof(q[0]) * input->hdr->numbones);
+
+	return true;
+}
+
+void CStudioAnimLOD::Store(int index, int framecount, const studioposeinput_t *input, float pos[][3], vec4_t *q)
+{
+	animlod_entry_t *entry;
+
+	if (index < 1 || index > MAX_CLIENTS)
+		return;
+
+	entry = &m_Entries[index];
+
+	entry->hdr = input->hdr;
+	entry->length = input->length;
+	entry->sequence = input->sequence;
+	entry->framecount = framecount;
+
+	memcpy(entry->pos, pos, sizeof(pos[0]) * input->hdr->numbones);
+	memcpy(entry->q, q, sizeof(q[0]) * input->hdr->numbones);
+}
@@ -0,0 +1,112 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+#include "entity_state.h"
+#include "cl_entity.h"
+
+#include <string.h>
+#include <memory.h>
+
+#include "StudioBoneCache.h"
+
+CStudioBoneCache::CStudioBoneCache(void)
+{
+	m_pCvarBoneCache = NULL;
+
+	Flush();
+}
+
+void CStudioBoneCache::Init(void)
+{
+	m_pCvarBoneCache = CVAR_CREATE("cl_bonecache", "1", FCVAR_ARCHIVE);
+}
+
+void CStudioBoneCache::Flush(void)
+{
+	for (int i = 0; i < BONECACHE_ENTRIES; i++)
+	{
+		m_Entries[i].framecount = -1;
+		m_Entries[i].index = 0;
+	}
+
+	m_nFrameCount = 0;
+}
+
+bool CStudioBoneCache::IsEnabled(void)
+{
+	return m_pCvarBoneCache && m_pCvarBoneCache->value;
+}
+
+void CStudioBoneCache::ClearKey(bonekey_t *key)
+{
+	// keys are compared with memcmp, so padding must be zeroed too
+	memset(key, 0, sizeof(*key));
+}
+
+bonecache_entry_t *CStudioBoneCache::Lookup(int index, int framecount, const bonekey_t *key)
+{
+	// level change or demo restart
+	if (framecount < m_nFrameCount)
+		Flush();
+
+	m_nFrameCount = framecount;
+
+	for (int i = 0; i < BONECACHE_PROBE; i++)
+	{
+		bonecache_entry_t *entry = &m_Entries[(index + i) & (BONECACHE_ENTRIES - 1)];
+
+		if (entry->framecount != framecount || entry->index != index)
+			continue;
+
+		if (memcmp(&entry->key, key, sizeof(*key)))
+			return NULL;
+
+		return entry;
+	}
+
+	return NULL;
+}
+
+bonecache_entry_t *CStudioBoneCache::Store(int index, int framecount, const bonekey_t *key)
+{
+	bonecache_entry_t *best = NULL;
+
+	// reuse this entity's slot, otherwise anything left over from an older frame
+	for (int i = 0; i < BONECACHE_PROBE; i++)
+	{
+		bonecache_entry_t *entry = &m_Entries[(index + i) & (BONECACHE_ENTRIES - 1)];
+
+		if (entry->index == index || entry->framecount != framecount)
+		{
+			best = entry;
+			break;
+		}
+	}
+
+	// every slot holds bones still wanted this frame
+	if (!best)
+		return NULL;
+
+	memcpy(&best->key, key, sizeof(*key));
+	best->index = index;
+	best->framecount = framecount;
+
+	return best;
+}
@@ -0,0 +1,188 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <string.h>
+#include <memory.h>
+
+#include "StudioModelInfo.h"
+
+CStudioModelInfoCache::CStudioModelInfoCache(void)
+{
+	memset(m_Entries, 0, sizeof(m_Entries));
+	m_pLast = NULL;
+	m_nEntries = 0;
+}
+
+CStudioModelInfoCache::~CStudioModelInfoCache(void)
+{
+	Flush();
+}
+
+void CStudioModelInfoCache::Free(studiomodelinfo_t *info)
+{
+	delete[] info->seqanim;
+
+	info->seqanim = NULL;
+	info->hdr = NULL;
+	info->mergehdr = NULL;
+}
+
+void CStudioModelInfoCache::Flush(void)
+{
+	for (int i = 0; i < MODELINFO_ENTRIES; i++)
+	{
+		if (m_Entries[i].hdr)
+			Free(&m_Entries[i]);
+	}
+
+	m_pLast = NULL;
+	m_nEntries = 0;
+}
+
+bool CStudioModelInfoCache::IsValid(const studiomodelinfo_t *info, const studiohdr_t *hdr)
+{
+	return info->length == hdr->length && info->numbones == hdr->numbones && info->numseq == hdr->numseq;
+}
+
+void CStudioModelInfoCache::Build(studiomodelinfo_t *info, studiohdr_t *hdr)
+{
+	int i;
+	int copy;
+
+	mstudiobone_t *pbones = (mstudiobone_t *)((byte *)hdr + hdr->boneindex);
+	mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)((byte *)hdr + hdr->seqindex);
+	mstudioseqgroup_t *pseqgroup = (mstudioseqgroup_t *)((byte *)hdr + hdr->seqgroupindex);
+
+	info->hdr = hdr;
+	info->length = hdr->length;
+	info->numbones = hdr->numbones;
+	info->numseq = hdr->numseq;
+
+	info->spinebone = hdr->numbones;
+	info->chestbone = -1;
+
+	for (i = 0, copy = 1; i < hdr->numbones; i++)
+	{
+		info->parents[i] = pbones[i].parent;
+
+		if (!strcmp(pbones[i].name, "Bip01 Spine"))
+		{
+			if (info->spinebone == hdr->numbones)
+				info->spinebone = i;
+
+			copy = 0;
+		}
+		else if (pbones[i].parent >= 0 && !strcmp(pbones[pbones[i].parent].name, "Bip01 Pelvis"))
+		{
+			copy = 1;
+		}
+
+		if (info->chestbone < 0 && !strcmp(pbones[i].name, "Bip01 Spine3"))
+			info->chestbone = i;
+
+		info->gaitbones[i] = copy;
+	}
+
+	info->numattachments = hdr->numattachments;
+
+	if (info->numattachments > MODELINFO_MAX_ATTACHMENTS)
+	{
+		gEngfuncs.Con_DPrintf("Too many attachments on %s\n", hdr->name);
+		info->numattachments = MODELINFO_MAX_ATTACHMENTS;
+	}
+
+	info->seqanim = new mstudioanim_t *[hdr->numseq > 0 ? hdr->numseq : 1];
+
+	for (i = 0; i < hdr->numseq; i++)
+	{
+		if (pseqdesc[i].seqgroup == 0)
+			info->seqanim[i] = (mstudioanim_t *)((byte *)hdr + pseqgroup->data + pseqdesc[i].animindex);
+		else
+			info->seqanim[i] = NULL;
+	}
+
+	info->mergehdr = NULL;
+}
+
+studiomodelinfo_t *CStudioModelInfoCache::Get(studiohdr_t *hdr)
+{
+	// most calls ask for the model being drawn right now
+	if (m_pLast && m_pLast->hdr == hdr && IsValid(m_pLast, hdr))
+		return m_pLast;
+
+	if (m_nEntries >= MODELINFO_ENTRIES * 3 / 4)
+		Flush();
+
+	unsigned int hash = (unsigned int)((size_t)hdr >> 4) * 2654435761u;
+	studiomodelinfo_t *info;
+
+	for (int i = 0; ; i++)
+	{
+		info = &m_Entries[(hash + i) & (MODELINFO_ENTRIES - 1)];
+
+		if (!info->hdr)
+		{
+			m_nEntries++;
+			Build(info, hdr);
+			break;
+		}
+
+		if (info->hdr == hdr)
+		{
+			if (!IsValid(info, hdr))
+			{
+				Free(info);
+				Build(info, hdr);
+			}
+
+			break;
+		}
+	}
+
+	m_pLast = info;
+	return info;
+}
+
+void CStudioModelInfoCache::SetMergeParent(studiomodelinfo_t *info, studiohdr_t *parent)
+{
+	if (info->mergehdr == parent && info->mergelength == parent->length)
+		return;
+
+	mstudiobone_t *pbones = (mstudiobone_t *)((byte *)info->hdr + info->hdr->boneindex);
+	mstudiobone_t *pparentbones = (mstudiobone_t *)((byte *)parent + parent->boneindex);
+
+	for (int i = 0; i < info->numbones; i++)
+	{
+		info->mergebones[i] = -1;
+
+		for (int j = 0; j < parent->numbones; j++)
+		{
+			if (!stricmp(pbones[i].name, pparentbones[j].name))
+			{
+				info->mergebones[i] = j;
+				break;
+			}
+		}
+	}
+
+	info->mergehdr = parent;
+	info->mergelength = parent->length;
+}
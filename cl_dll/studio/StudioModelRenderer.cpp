@@ -58,6 +58,34 @@ void CStudioModelRenderer::Init(void)
 	m_plighttransform = (float (*)[MAXSTUDIOBONES][3][4])IEngineStudio.StudioGetLightTransform();
 	m_paliastransform = (float (*)[3][4])IEngineStudio.StudioGetAliasTransform();
 	m_protationmatrix = (float (*)[3][4])IEngineStudio.StudioGetRotationMatrix();
+
+	m_PoseCache.Init();
+	m_BoneCache.Init();
+	m_PosePrepass.Init();
+	m_AnimLOD.Init();
+}
+
+void CStudioModelRenderer::VidInit(void)
+{
+	// model memory of the previous map is gone
+	m_PosePrepass.Flush();
+	m_AnimLOD.Flush();
+	m_ModelInfo.Flush();
+	m_PoseCache.Flush();
+	m_BoneCache.Flush();
+
+	m_pCachedBonesHeader = NULL;
+	m_nCachedBones = 0;
+
+	for (int i = 0; i <= MAX_CLIENTS; i++)
+		m_ShadowCache[i].valid = 0;
+
+	m_nShadowFrame = -1;
+}
+
+void CStudioModelRenderer::Shutdown(void)
+{
+	m_PosePrepass.Shutdown();
 }
 
 CStudioModelRenderer::CStudioModelRenderer(void)
@@ -81,6 +109,12 @@ CStudioModelRenderer::CStudioModelRenderer(void)
 	m_pPlayerInfo = NULL;
 	m_pRenderModel = NULL;
 	m_iShadowSprite = 0;
+	m_pCachedBonesHeader = NULL;
+	m_nCachedBones = 0;
+	m_nShadowFrame = -1;
+
+	for (int i = 0; i <= MAX_CLIENTS; i++)
+		m_ShadowCache[i] = shadowcache_t();
 }
 
 CStudioModelRenderer::~CStudioModelRenderer(void)
@@ -89,232 +123,33 @@ CStudioModelRenderer::~CStudioModelRenderer(void)
 
 void CStudioModelRenderer::StudioCalcBoneAdj(float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen)
 {
-	int i, j;
-	float value;
-	mstudiobonecontroller_t *pbonecontroller;
-
-	pbonecontroller = (mstudiobonecontroller_t *)((byte *)m_pStudioHeader + m_pStudioHeader->bonecontrollerindex);
-
-	for (j = 0; j < m_pStudioHeader->numbonecontrollers; j++)
-	{
-		i = pbonecontroller[j].index;
-
-		if (i <= 3)
-		{
-			if (pbonecontroller[j].type & STUDIO_RLOOP)
-			{
-				if (abs(pcontroller1[i] - pcontroller2[i]) > 128)
-				{
-					int a, b;
-					a = (pcontroller1[j] + 128) % 256;
-					b = (pcontroller2[j] + 128) % 256;
-					value = ((a * dadt) + (b * (1 - dadt)) - 128) * (360.0 / 256.0) + pbonecontroller[j].start;
-				}
-				else
-				{
-					value = ((pcontroller1[i] * dadt + (pcontroller2[i]) * (1.0 - dadt))) * (360.0 / 256.0) + pbonecontroller[j].start;
-				}
-			}
-			else
-			{
-				value = (pcontroller1[i] * dadt + pcontroller2[i] * (1.0 - dadt)) / 255.0;
-
-				if (value < 0)
-					value = 0;
-
-				if (value > 1.0)
-					value = 1.0;
-
-				value = (1.0 - value) * pbonecontroller[j].start + value * pbonecontroller[j].end;
-			}
-		}
-		else
-		{
-			value = mouthopen / 64.0;
-
-			if (value > 1.0)
-				value = 1.0;
-
-			value = (1.0 - value) * pbonecontroller[j].start + value * pbonecontroller[j].end;
-		}
-
-		switch (pbonecontroller[j].type & STUDIO_TYPES)
-		{
-			case STUDIO_XR:
-			case STUDIO_YR:
-			case STUDIO_ZR:
-			{
-				adj[j] = value * (M_PI / 180.0);
-				break;
-			}
-			case STUDIO_X:
-			case STUDIO_Y:
-			case STUDIO_Z:
-			{
-				adj[j] = value;
-				break;
-			}
-		}
-	}
+	CStudioPose::CalcBoneAdj(m_pStudioHeader, dadt, adj, pcontroller1, pcontroller2, mouthopen);
 }
 
 void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *q)
 {
-	int j, k;
-	vec4_t q1, q2;
-	vec3_t angle1, angle2;
-	mstudioanimvalue_t *panimvalue;
-
-	for (j = 0; j < 3; j++)
-	{
-		if (panim->offset[j + 3] == 0)
-		{
-			angle2[j] = angle1[j] = pbone->value[j + 3];
-		}
-		else
-		{
-			panimvalue = (mstudioanimvalue_t *)((byte *)panim + panim->offset[j + 3]);
-			k = frame;
-
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
-
-			if (panimvalue->num.valid > k)
-			{
-				angle1[j] = panimvalue[k + 1].value;
-
-				if (panimvalue->num.valid > k + 1)
-				{
-					angle2[j] = panimvalue[k + 2].value;
-				}
-				else
-				{
-					if (panimvalue->num.total > k + 1)
-						angle2[j] = angle1[j];
-					else
-						angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
-				}
-			}
-			else
-			{
-				angle1[j] = panimvalue[panimvalue->num.valid].value;
-
-				if (panimvalue->num.total > k + 1)
-					angle2[j] = angle1[j];
-				else
-					angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
-			}
-
-			angle1[j] = pbone->value[j + 3] + angle1[j] * pbone->scale[j + 3];
-			angle2[j] = pbone->value[j + 3] + angle2[j] * pbone->scale[j + 3];
-		}
-
-		if (pbone->bonecontroller[j + 3] != -1)
-		{
-			angle1[j] += adj[pbone->bonecontroller[j + 3]];
-			angle2[j] += adj[pbone->bonecontroller[j + 3]];
-		}
-	}
-
-	if (!VectorCompare(angle1, angle2))
-	{
-		AngleQuaternion(angle1, q1);
-		AngleQuaternion(angle2, q2);
-		QuaternionSlerp(q1, q2, s, q);
-	}
-	else
-	{
-		AngleQuaternion(angle1, q);
-	}
+	CStudioPose::CalcBoneQuaterion(frame, s, pbone, panim, adj, q);
 }
 
 void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *pos)
 {
-	int j, k;
-	mstudioanimvalue_t *panimvalue;
-
-	for (j = 0; j < 3; j++)
-	{
-		pos[j] = pbone->value[j];
-
-		if (panim->offset[j] != 0)
-		{
-			panimvalue = (mstudioanimvalue_t *)((byte *)panim + panim->offset[j]);
-			k = frame;
-
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
-
-			if (panimvalue->num.valid > k)
-			{
-				if (panimvalue->num.valid > k + 1)
-					pos[j] += (panimvalue[k + 1].value * (1.0 - s) + s * panimvalue[k + 2].value) * pbone->scale[j];
-				else
-					pos[j] += panimvalue[k + 1].value * pbone->scale[j];
-			}
-			else
-			{
-				if (panimvalue->num.total <= k + 1)
-					pos[j] += (panimvalue[panimvalue->num.valid].value * (1.0 - s) + s * panimvalue[panimvalue->num.valid + 2].value) * pbone->scale[j];
-				else
-					pos[j] += panimvalue[panimvalue->num.valid].value * pbone->scale[j];
-			}
-		}
-
-		if (pbone->bonecontroller[j] != -1 && adj)
-			pos[j] += adj[pbone->bonecontroller[j]];
-	}
+	CStudioPose::CalcBonePosition(frame, s, pbone, panim, adj, pos);
 }
 
 void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
 {
-	int i;
-	vec4_t q3;
-	float s1;
-
-	if (s < 0)
-		s = 0;
-	else if (s > 1.0)
-		s = 1.0;
-
-	s1 = 1.0 - s;
-
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
-	{
-		QuaternionSlerp(q1[i], q2[i], s, q3);
-
-		q1[i][0] = q3[0];
-		q1[i][1] = q3[1];
-		q1[i][2] = q3[2];
-		q1[i][3] = q3[3];
-		pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s;
-		pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s;
-		pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s;
-	}
+	CStudioPose::SlerpBones(m_pStudioHeader->numbones, q1, pos1, q2, pos2, s);
 }
 
 mstudioanim_t *CStudioModelRenderer::StudioGetAnim(model_t *m_pSubModel, mstudioseqdesc_t *pseqdesc)
 {
 	mstudioseqgroup_t *pseqgroup;
 	cache_user_t *paSequences;
+	studiomodelinfo_t *info = m_ModelInfo.Get(m_pStudioHeader);
+	int seq = pseqdesc - (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex);
+
+	if (seq >= 0 && seq < info->numseq && info->seqanim[seq])
+		return info->seqanim[seq];
 
 	pseqgroup = (mstudioseqgroup_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqgroupindex) + pseqdesc->seqgroup;
 
@@ -464,52 +299,10 @@ float CStudioModelRenderer::StudioEstimateInterpolant(void)
 
 void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f)
 {
-	int i;
-	int frame;
-	mstudiobone_t *pbone;
-
-	float s;
-	float adj[MAXSTUDIOCONTROLLERS];
-	float dadt;
-
-	if (f > pseqdesc->numframes - 1)
-		f = 0;
-	else if (f < -0.01)
-		f = -0.01;
+	studioposeinput_t input;
 
-	frame = (int)f;
-	dadt = StudioEstimateInterpolant();
-	s = (f - frame);
-
-	pbone = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
-
-	StudioCalcBoneAdj(dadt, adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
-
-	for (i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++)
-	{
-		StudioCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
-		StudioCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
-	}
-
-	if (pseqdesc->motiontype & STUDIO_X)
-		pos[pseqdesc->motionbone][0] = 0.0;
-
-	if (pseqdesc->motiontype & STUDIO_Y)
-		pos[pseqdesc->motionbone][1] = 0.0;
-
-	if (pseqdesc->motiontype & STUDIO_Z)
-		pos[pseqdesc->motionbone][2] = 0.0;
-
-	s = 0 * ((1.0 - (f - (int)(f))) / (pseqdesc->numframes)) * m_pCurrentEntity->curstate.framerate;
-
-	if (pseqdesc->motiontype & STUDIO_LX)
-		pos[pseqdesc->motionbone][0] += s * pseqdesc->linearmovement[0];
-
-	if (pseqdesc->motiontype & STUDIO_LY)
-		pos[pseqdesc->motionbone][1] += s * pseqdesc->linearmovement[1];
-
-	if (pseqdesc->motiontype & STUDIO_LZ)
-		pos[pseqdesc->motionbone][2] += s * pseqdesc->linearmovement[2];
+	StudioSetupPoseState(&input);
+	CStudioPose::CalcRotations(&input, pos, q, pseqdesc, panim, f);
 }
 
 void CStudioModelRenderer::StudioFxTransform(cl_entity_t *ent, float transform[3][4])
@@ -601,174 +394,391 @@ float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t *pseqdesc)
 	return f;
 }
 
-void CStudioModelRenderer::StudioSetupBones(void)
+bool CStudioModelRenderer::StudioInSequenceTransition(void)
 {
-	int i;
-	double f;
+	return m_fDoInterp && m_pCurrentEntity->latched.sequencetime && (m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) && (m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq);
+}
 
-	mstudiobone_t *pbones;
+/*
+====================
+StudioGetAnimLOD
+
+Only other players are scaled down; their sequence box at the distance
+from the view gives the size on screen
+====================
+*/
+int CStudioModelRenderer::StudioGetAnimLOD(void)
+{
 	mstudioseqdesc_t *pseqdesc;
-	mstudioanim_t *panim;
+	float radius, distance;
 
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
+	if (!m_pCurrentEntity->player || m_pCurrentEntity->index < 1 || m_pCurrentEntity->index > MAX_CLIENTS)
+		return ANIMLOD_NONE;
 
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
+	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
 
-	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
-		m_pCurrentEntity->curstate.sequence = 0;
+	radius = (Vector(pseqdesc->bbmax) - Vector(pseqdesc->bbmin)).Length() * 0.5f;
 
-	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
+	if (radius <= 0.0f)
+		radius = 36.0f;
 
-	f = StudioEstimateFrame(pseqdesc);
-	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+	distance = (m_pCurrentEntity->origin - Vector(m_vRenderOrigin)).Length();
 
-	StudioCalcRotations(pos, q, pseqdesc, panim, f);
+	return m_AnimLOD.Level(radius, distance);
+}
 
-	if (pseqdesc->numblends > 1)
-	{
-		float s;
-		float dadt;
+bool CStudioModelRenderer::StudioGetPoseKey(posekey_t *key, double *f, float *gaitframe, bool lerpblending)
+{
+	m_PoseCache.BeginFrame(m_nFrameCount);
 
-		panim += m_pStudioHeader->numbones;
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
+	if (!m_PoseCache.IsEnabled())
+		return false;
 
-		dadt = StudioEstimateInterpolant();
-		s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
+	// sequence transitions blend against the latched pose of this entity only
+	if (StudioInSequenceTransition())
+		return false;
 
-		StudioSlerpBones(q, pos, q2, pos2, s);
+	// interpolated controllers and blends depend on the animtime of this entity
+	if (m_fDoInterp && memcmp(m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, 4))
+		return false;
 
-		if (pseqdesc->numblends == 4)
-		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
+	if (m_fDoInterp && lerpblending && memcmp(m_pCurrentEntity->curstate.blending, m_pCurrentEntity->latched.prevblending, 2))
+		return false;
 
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
+	m_PoseCache.ClearKey(key);
 
-			s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q3, pos3, q4, pos4, s);
+	*f = m_PoseCache.Quantize(*f);
+	*gaitframe = m_PoseCache.Quantize(*gaitframe);
 
-			s = (m_pCurrentEntity->curstate.blending[1] * dadt + m_pCurrentEntity->latched.prevblending[1] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q, pos, q3, pos3, s);
-		}
-	}
+	key->hdr = m_pStudioHeader;
+	key->length = m_pStudioHeader->length;
+	key->sequence = m_pCurrentEntity->curstate.sequence;
+	key->frame = *f;
+	key->gaitsequence = m_pPlayerInfo ? m_pPlayerInfo->gaitsequence : -1;
+	key->gaitframe = m_pPlayerInfo ? *gaitframe : 0;
+	memcpy(key->blending, m_pCurrentEntity->curstate.blending, 2);
+	memcpy(key->controller, m_pCurrentEntity->curstate.controller, 4);
+	key->mouthopen = m_pCurrentEntity->mouth.mouthopen;
+
+	return true;
+}
+
+/*
+====================
+StudioSetupPoseState
 
-	if (m_fDoInterp && m_pCurrentEntity->latched.sequencetime && (m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) && (m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
+Captures the entity state every rotation evaluation reads
+====================
+*/
+void CStudioModelRenderer::StudioSetupPoseState(studioposeinput_t *input)
+{
+	memset(input, 0, sizeof(*input));
+
+	input->hdr = m_pStudioHeader;
+	input->length = m_pStudioHeader->length;
+	input->dointerp = m_fDoInterp;
+	input->time = m_clTime;
+	input->sequence = m_pCurrentEntity->curstate.sequence;
+	input->animtime = m_pCurrentEntity->curstate.animtime;
+	input->prevanimtime = m_pCurrentEntity->latched.prevanimtime;
+	input->framerate = m_pCurrentEntity->curstate.framerate;
+	memcpy(input->blending, m_pCurrentEntity->curstate.blending, 2);
+	memcpy(input->prevblending, m_pCurrentEntity->latched.prevblending, 2);
+	memcpy(input->controller, m_pCurrentEntity->curstate.controller, 4);
+	memcpy(input->prevcontroller, m_pCurrentEntity->latched.prevcontroller, 4);
+	input->mouthopen = m_pCurrentEntity->mouth.mouthopen;
+}
+
+/*
+====================
+StudioSetupPoseInput
+
+Everything the pose evaluation reads, with the animations already resolved:
+loading a demand loaded sequence group has to happen on this thread
+====================
+*/
+void CStudioModelRenderer::StudioSetupPoseInput(studioposeinput_t *input, double f, float gaitframe)
+{
+	mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex);
+
+	StudioSetupPoseState(input);
+
+	input->frame = f;
+	input->anim = StudioGetAnim(m_pRenderModel, pseqdesc + input->sequence);
+	input->lod = StudioGetAnimLOD();
+
+	// a 0.2 second blend is not worth two evaluations on a few pixels
+	if (input->lod == ANIMLOD_NONE && StudioInSequenceTransition())
 	{
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
-		float s;
+		input->transition = 1;
+		input->prevsequence = m_pCurrentEntity->latched.prevsequence;
+		input->prevframe = m_pCurrentEntity->latched.prevframe;
+		input->sequencetime = m_pCurrentEntity->latched.sequencetime;
+		input->prevanim = StudioGetAnim(m_pRenderModel, pseqdesc + input->prevsequence);
+		memcpy(input->prevseqblending, m_pCurrentEntity->latched.prevseqblending, 2);
+	}
 
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->latched.prevsequence;
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+	StudioSetupPoseGait(input, gaitframe);
+}
 
-		StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+void CStudioModelRenderer::StudioSetupPoseGait(studioposeinput_t *input, float gaitframe)
+{
+	if (!m_pPlayerInfo || m_pPlayerInfo->gaitsequence == 0)
+		return;
 
-		if (pseqdesc->numblends > 1)
-		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+	// everything before the spine belongs to the legs
+	input->gaitmode = POSE_GAIT_SPINE;
+	input->gaitsequence = m_pPlayerInfo->gaitsequence;
+	input->gaitframe = gaitframe;
+	input->gaitanim = StudioGetAnim(m_pRenderModel, (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + input->gaitsequence);
+	input->spinebone = m_ModelInfo.Get(m_pStudioHeader)->spinebone;
+}
 
-			s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-			StudioSlerpBones(q1b, pos1b, q2, pos2, s);
+bool CStudioModelRenderer::StudioBuildPose(studioposeinput_t *input, posekey_t *key, bool lerpblending)
+{
+	double f;
+	float gaitframe;
+	bool keyed;
+	mstudioseqdesc_t *pseqdesc;
 
-			if (pseqdesc->numblends == 4)
-			{
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
 
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+	f = StudioEstimateFrame(pseqdesc);
+	gaitframe = m_pPlayerInfo ? m_pPlayerInfo->gaitframe : 0;
 
-				s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-				StudioSlerpBones(q3, pos3, q4, pos4, s);
+	keyed = StudioGetPoseKey(key, &f, &gaitframe, lerpblending);
+	StudioSetupPoseInput(input, f, gaitframe);
 
-				s = (m_pCurrentEntity->latched.prevseqblending[1]) / 255.0;
-				StudioSlerpBones(q1b, pos1b, q3, pos3, s);
-			}
+	if (keyed)
+		key->lod = input->lod;
+
+	return keyed;
+}
+
+void CStudioModelRenderer::StudioEvaluatePose(float pos[][3], vec4_t *q, bool lerpblending)
+{
+	bool keyed;
+	posekey_t key;
+	studioposeinput_t input;
+
+	keyed = StudioBuildPose(&input, &key, lerpblending);
+
+	// a player a few pixels tall keeps its last sequence pose for a couple
+	// of frames; the legs still follow the gait every frame
+	if (input.lod >= ANIMLOD_REUSE)
+	{
+		if (!m_AnimLOD.Lookup(m_pCurrentEntity->index, m_nFrameCount, &input, pos, q))
+		{
+			m_Pose.EvaluateSequence(&input, pos, q);
+			m_AnimLOD.Store(m_pCurrentEntity->index, m_nFrameCount, &input, pos, q);
 		}
 
-		s = 1.0 - (m_clTime - m_pCurrentEntity->latched.sequencetime) / 0.2;
-		StudioSlerpBones(q, pos, q1b, pos1b, s);
+		m_Pose.MergeGait(&input, pos, q);
 	}
-	else
+	else if (!keyed || !m_PoseCache.Lookup(&key, pos, q, m_pStudioHeader->numbones))
 	{
-		m_pCurrentEntity->latched.prevframe = f;
+		// players were usually handed to the worker threads at the start of the frame
+		if (!m_PosePrepass.Fetch(m_pCurrentEntity->index, &input, pos, q))
+			m_Pose.Evaluate(&input, pos, q);
+
+		if (keyed)
+			m_PoseCache.Store(&key, pos, q, m_pStudioHeader->numbones);
 	}
 
-	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+	if (!input.transition)
+		m_pCurrentEntity->latched.prevframe = input.frame;
+}
 
-	if (m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0)
-	{
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pPlayerInfo->gaitsequence;
+void CStudioModelRenderer::StudioCalcPose(float pos[][3], vec4_t *q, double f, float gaitframe)
+{
+	studioposeinput_t input;
 
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe);
+	StudioSetupPoseInput(&input, f, gaitframe);
+	m_Pose.Evaluate(&input, pos, q);
 
-		for (i = 0; i < m_pStudioHeader->numbones; i++)
-		{
-			if (strcmp(pbones[i].name, "Bip01 Spine") == 0)
-				break;
+	if (!input.transition)
+		m_pCurrentEntity->latched.prevframe = f;
+}
 
-			memcpy(pos[i], pos2[i], sizeof( pos[i]));
-			memcpy(q[i], q2[i], sizeof( q[i]));
-		}
-	}
+void CStudioModelRenderer::StudioCalcBoneTransforms(float pos[][3], vec4_t *q)
+{
+	int i;
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
-	{
-		QuaternionMatrix(q[i], bonematrix);
+	mstudiobone_t *pbones;
+	studiomodelinfo_t *info;
+	static float bonematrix[MAXSTUDIOBONES][3][4];
+
+	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
 
-		bonematrix[0][3] = pos[i][0];
-		bonematrix[1][3] = pos[i][1];
-		bonematrix[2][3] = pos[i][2];
+	QuaternionMatrixBatch(q, pos, bonematrix, m_pStudioHeader->numbones);
 
-		if (pbones[i].parent == -1)
+	switch (m_pCurrentEntity->curstate.renderfx)
+	{
+		case kRenderFxDistort:
+		case kRenderFxHologram:
+		case kRenderFxExplode:
 		{
-			if (IEngineStudio.IsHardware())
+			// root bones get distorted before their children are built
+			for (i = 0; i < m_pStudioHeader->numbones; i++)
 			{
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_pbonetransform)[i]);
-				MatrixCopy((*m_pbonetransform)[i], (*m_plighttransform)[i]);
-			}
-			else
-			{
-				ConcatTransforms((*m_paliastransform), bonematrix, (*m_pbonetransform)[i]);
-				ConcatTransforms((*m_protationmatrix), bonematrix, (*m_plighttransform)[i]);
-			}
+				if (pbones[i].parent == -1)
+				{
+					if (IEngineStudio.IsHardware())
+					{
+						ConcatTransforms((*m_protationmatrix), bonematrix[i], (*m_pbonetransform)[i]);
+						MatrixCopy((*m_pbonetransform)[i], (*m_plighttransform)[i]);
+					}
+					else
+					{
+						ConcatTransforms((*m_paliastransform), bonematrix[i], (*m_pbonetransform)[i]);
+						ConcatTransforms((*m_protationmatrix), bonematrix[i], (*m_plighttransform)[i]);
+					}
 
-			StudioFxTransform(m_pCurrentEntity, (*m_pbonetransform)[i]);
-		}
-		else
-		{
-			ConcatTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix, (*m_pbonetransform)[i]);
-			ConcatTransforms((*m_plighttransform)[pbones[i].parent], bonematrix, (*m_plighttransform)[i]);
+					StudioFxTransform(m_pCurrentEntity, (*m_pbonetransform)[i]);
+				}
+				else
+				{
+					ConcatTransforms((*m_pbonetransform)[pbones[i].parent], bonematrix[i], (*m_pbonetransform)[i]);
+					ConcatTransforms((*m_plighttransform)[pbones[i].parent], bonematrix[i], (*m_plighttransform)[i]);
+				}
+			}
+			return;
 		}
 	}
+
+	info = m_ModelInfo.Get(m_pStudioHeader);
+
+	if (IEngineStudio.IsHardware())
+	{
+		// both chains start from the rotation matrix, so they are identical
+		ConcatTransformsBatch((*m_protationmatrix), info->parents, bonematrix, (*m_pbonetransform), m_pStudioHeader->numbones);
+		memcpy((*m_plighttransform), (*m_pbonetransform), sizeof(float) * 3 * 4 * m_pStudioHeader->numbones);
+	}
+	else
+	{
+		ConcatTransformsBatch((*m_paliastransform), info->parents, bonematrix, (*m_pbonetransform), m_pStudioHeader->numbones);
+		ConcatTransformsBatch((*m_protationmatrix), info->parents, bonematrix, (*m_plighttransform), m_pStudioHeader->numbones);
+	}
 }
 
-void CStudioModelRenderer::StudioSaveBones(void)
+void CStudioModelRenderer::StudioSetupBones(void)
 {
-	int i;
+	static float pos[MAXSTUDIOBONES][3];
+	static vec4_t q[MAXSTUDIOBONES];
 
-	mstudiobone_t *pbones;
-	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
+		m_pCurrentEntity->curstate.sequence = 0;
 
-	m_nCachedBones = m_pStudioHeader->numbones;
+	StudioEvaluatePose(pos, q, true);
+	StudioCalcBoneTransforms(pos, q);
+}
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
+bool CStudioModelRenderer::StudioGetBoneKey(bonekey_t *key)
+{
+	if (!m_BoneCache.IsEnabled())
+		return false;
+
+	// temporary entities share index 0
+	if (m_pCurrentEntity->index <= 0)
+		return false;
+
+	m_BoneCache.ClearKey(key);
+
+	key->entity = m_pCurrentEntity;
+	key->hdr = m_pStudioHeader;
+	key->length = m_pStudioHeader->length;
+	key->dointerp = m_fDoInterp;
+	key->sequence = m_pCurrentEntity->curstate.sequence;
+	key->frame = m_pCurrentEntity->curstate.frame;
+	key->framerate = m_pCurrentEntity->curstate.framerate;
+	key->animtime = m_pCurrentEntity->curstate.animtime;
+	key->renderfx = m_pCurrentEntity->curstate.renderfx;
+	key->scale = m_pCurrentEntity->curstate.scale;
+	memcpy(key->blending, m_pCurrentEntity->curstate.blending, 2);
+	memcpy(key->controller, m_pCurrentEntity->curstate.controller, 4);
+	key->mouthopen = m_pCurrentEntity->mouth.mouthopen;
+	memcpy(key->prevblending, m_pCurrentEntity->latched.prevblending, 2);
+	memcpy(key->prevseqblending, m_pCurrentEntity->latched.prevseqblending, 2);
+	memcpy(key->prevcontroller, m_pCurrentEntity->latched.prevcontroller, 4);
+	key->prevsequence = m_pCurrentEntity->latched.prevsequence;
+	key->sequencetime = m_pCurrentEntity->latched.sequencetime;
+
+	// outside a transition the bone setup only writes prevframe, it doesn't read it
+	if (StudioInSequenceTransition())
+		key->prevframe = m_pCurrentEntity->latched.prevframe;
+
+	key->gaitsequence = m_pPlayerInfo ? m_pPlayerInfo->gaitsequence : -1;
+	key->gaitframe = m_pPlayerInfo ? m_pPlayerInfo->gaitframe : 0;
+
+	memcpy(key->rotationmatrix, (*m_protationmatrix), sizeof(key->rotationmatrix));
+
+	if (!IEngineStudio.IsHardware())
+		memcpy(key->aliastransform, (*m_paliastransform), sizeof(key->aliastransform));
+
+	return true;
+}
+
+/*
+====================
+StudioSetupBonesCached
+
+StudioSetupBones, unless this entity already built the same bones earlier
+in the frame: the engine draws animated entities once with STUDIO_EVENTS
+and again with STUDIO_RENDER
+====================
+*/
+void CStudioModelRenderer::StudioSetupBonesCached(void)
+{
+	bonekey_t key;
+	bonecache_entry_t *entry;
+	int numbones = m_pStudioHeader->numbones;
+
+	if (!StudioGetBoneKey(&key))
 	{
-		strncpy(m_nCachedBoneNames[i], pbones[i].name, 32);
-		MatrixCopy((*m_pbonetransform)[i], m_rgCachedBoneTransform[i]);
-		MatrixCopy((*m_plighttransform)[i], m_rgCachedLightTransform[i]);
+		StudioSetupBones();
+		return;
+	}
+
+	entry = m_BoneCache.Lookup(m_pCurrentEntity->index, m_nFrameCount, &key);
+
+	if (entry)
+	{
+		memcpy((*m_pbonetransform), entry->bonetransform, sizeof(entry->bonetransform[0]) * numbones);
+		memcpy((*m_plighttransform), entry->lighttransform, sizeof(entry->lighttransform[0]) * numbones);
+
+		m_pCurrentEntity->curstate.sequence = entry->sequence;
+		memcpy(m_pCurrentEntity->curstate.blending, entry->blending, 2);
+		memcpy(m_pCurrentEntity->latched.prevseqblending, entry->prevseqblending, 2);
+		m_pCurrentEntity->latched.prevframe = entry->prevframe;
+		return;
 	}
 
+	StudioSetupBones();
+
+	entry = m_BoneCache.Store(m_pCurrentEntity->index, m_nFrameCount, &key);
+
+	if (!entry)
+		return;
+
+	entry->numbones = numbones;
+	memcpy(entry->bonetransform, (*m_pbonetransform), sizeof(entry->bonetransform[0]) * numbones);
+	memcpy(entry->lighttransform, (*m_plighttransform), sizeof(entry->lighttransform[0]) * numbones);
+
+	entry->sequence = m_pCurrentEntity->curstate.sequence;
+	memcpy(entry->blending, m_pCurrentEntity->curstate.blending, 2);
+	memcpy(entry->prevseqblending, m_pCurrentEntity->latched.prevseqblending, 2);
+	entry->prevframe = m_pCurrentEntity->latched.prevframe;
+}
+
+void CStudioModelRenderer::StudioSaveBones(void)
+{
+	// bone names are looked up through the header when something merges onto them
+	m_pCachedBonesHeader = m_pStudioHeader;
+	m_nCachedBones = m_pStudioHeader->numbones;
+
+	memcpy(m_rgCachedBoneTransform, (*m_pbonetransform), sizeof(m_rgCachedBoneTransform[0]) * m_nCachedBones);
+	memcpy(m_rgCachedLightTransform, (*m_plighttransform), sizeof(m_rgCachedLightTransform[0]) * m_nCachedBones);
+
 }
 
 void CStudioModelRenderer::StudioMergeBones(model_t *m_pSubModel)
@@ -779,6 +789,7 @@ void CStudioModelRenderer::StudioMergeBones(model_t *m_pSubModel)
 	mstudiobone_t *pbones;
 	mstudioseqdesc_t *pseqdesc;
 	mstudioanim_t *panim;
+	studiomodelinfo_t *info;
 
 	static float pos[MAXSTUDIOBONES][3];
 	float bonematrix[3][4];
@@ -803,19 +814,21 @@ void CStudioModelRenderer::StudioMergeBones(model_t *m_pSubModel)
 
 	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
 
+	info = m_ModelInfo.Get(m_pStudioHeader);
+
+	if (m_pCachedBonesHeader)
+		m_ModelInfo.SetMergeParent(info, m_pCachedBonesHeader);
+
 	for (i = 0; i < m_pStudioHeader->numbones; i++)
 	{
-		for (j = 0; j < m_nCachedBones; j++)
+		j = m_pCachedBonesHeader ? info->mergebones[i] : -1;
+
+		if (j >= 0 && j < m_nCachedBones)
 		{
-			if (stricmp(pbones[i].name, m_nCachedBoneNames[j]) == 0)
-			{
-				MatrixCopy(m_rgCachedBoneTransform[j], (*m_pbonetransform)[i]);
-				MatrixCopy(m_rgCachedLightTransform[j], (*m_plighttransform)[i]);
-				break;
-			}
+			MatrixCopy(m_rgCachedBoneTransform[j], (*m_pbonetransform)[i]);
+			MatrixCopy(m_rgCachedLightTransform[j], (*m_plighttransform)[i]);
 		}
-
-		if (j >= m_nCachedBones)
+		else
 		{
 			QuaternionMatrix(q[i], bonematrix);
 
@@ -913,10 +926,11 @@ int CStudioModelRenderer::StudioDrawModel(int flags)
 			return 1;
 	}
 
+	// followers merge with whatever was drawn last, so they are never cached
 	if (m_pCurrentEntity->curstate.movetype == MOVETYPE_FOLLOW)
 		StudioMergeBones(m_pRenderModel);
 	else
-		StudioSetupBones();
+		StudioSetupBonesCached();
 
 	StudioSaveBones();
 
@@ -1167,7 +1181,7 @@ int CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplayer)
 
 	m_pPlayerInfo = IEngineStudio.PlayerInfo(m_nPlayerIndex);
 
-	StudioSetupBones();
+	StudioSetupBonesCached();
 	StudioSaveBones();
 
 	m_pPlayerInfo->renderframe = m_nFrameCount;
@@ -1250,14 +1264,15 @@ int CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplayer)
 void CStudioModelRenderer::StudioCalcAttachments(void)
 {
 	int i;
+	int numattachments;
 	mstudioattachment_t *pattachment;
 
-	if (m_pStudioHeader->numattachments > 4)
-		gEngfuncs.Con_DPrintf("Too many attachments on %s\n", m_pCurrentEntity->model->name);
+	// warns once about models with more attachments than an entity holds
+	numattachments = m_ModelInfo.Get(m_pStudioHeader)->numattachments;
 
 	pattachment = (mstudioattachment_t *)((byte *)m_pStudioHeader + m_pStudioHeader->attachmentindex);
 
-	for (i = 0; i < m_pStudioHeader->numattachments; i++)
+	for (i = 0; i < numattachments; i++)
 		VectorTransform(pattachment[i].org, (*m_plighttransform)[pattachment[i].bone], m_pCurrentEntity->attachment[i]);
 }
 
@@ -1379,54 +1394,113 @@ void CStudioModelRenderer::StudioSetShadowSprite(int idx)
 	m_iShadowSprite = idx;
 }
 
-void CStudioModelRenderer::StudioDrawShadow( Vector origin, float scale )
+#define SHADOW_TRACE_DEPTH	150.0f
+#define SHADOW_CACHE_MOVE	4.0f	// units a player may move before the ground is traced again
+#define SHADOW_CACHE_TIME	0.2f	// seconds, so doors and platforms are picked up
+
+/*
+====================
+StudioShadowTrace
+
+Finds the ground under a shadow. A player that moved less than
+SHADOW_CACHE_MOVE since its last trace is dropped onto the plane that
+trace hit instead of tracing the world again
+====================
+*/
+bool CStudioModelRenderer::StudioShadowTrace( const Vector &origin, Vector &endpos, Vector &normal, float &fraction )
 {
+	Vector start = origin;
 	Vector endPoint = origin;
-	Vector p1, p2, p3, p4;
 	pmtrace_t pmtrace;
+	shadowcache_t *cache = NULL;
 
-	endPoint.z -= 150.0f;
+	if( m_pCurrentEntity && m_pCurrentEntity->index >= 1 && m_pCurrentEntity->index <= MAX_CLIENTS )
+		cache = &m_ShadowCache[m_pCurrentEntity->index];
+
+	if( cache && cache->valid && m_clTime >= cache->time && m_clTime - cache->time < SHADOW_CACHE_TIME
+		&& ( origin - cache->start ).Length( ) < SHADOW_CACHE_MOVE )
+	{
+		if( !cache->hit )
+			return false;
+
+		fraction = ( DotProduct( origin, cache->normal ) - cache->dist ) / ( cache->normal.z * SHADOW_TRACE_DEPTH );
+
+		if( fraction >= 0.0f && fraction < 1.0f )
+		{
+			endpos = origin;
+			endpos.z -= fraction * SHADOW_TRACE_DEPTH;
+			normal = cache->normal;
+			return true;
+		}
+	}
+
+	endPoint.z -= SHADOW_TRACE_DEPTH;
+
+	// players are studio models and ignored by this trace anyway,
+	// so their prediction state is only set up once a frame
+	if( m_nShadowFrame != m_nFrameCount )
+	{
+		gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
+		m_nShadowFrame = m_nFrameCount;
+	}
 
-	gEngfuncs.pEventAPI->EV_SetUpPlayerPrediction( false, true );
 	gEngfuncs.pEventAPI->EV_PushPMStates( );
 		gEngfuncs.pEventAPI->EV_SetSolidPlayers( -1 );
 		gEngfuncs.pEventAPI->EV_SetTraceHull( 2 );
-		gEngfuncs.pEventAPI->EV_PlayerTrace( origin, endPoint, PM_STUDIO_IGNORE | PM_GLASS_IGNORE, -1, &pmtrace );
+		gEngfuncs.pEventAPI->EV_PlayerTrace( start, endPoint, PM_STUDIO_IGNORE | PM_GLASS_IGNORE, -1, &pmtrace );
 	gEngfuncs.pEventAPI->EV_PopPMStates( );
 
-	// don't allow shadow if player in solid area
-	if( pmtrace.startsolid )
-		return;
+	fraction = pmtrace.fraction;
+	endpos = pmtrace.endpos;
+	normal = pmtrace.plane.normal.Normalize( );
 
-	// don't allow shadow if doesn't hit anything
-	if( pmtrace.fraction >= 1.0f )
-		return;
+	// don't allow shadow if player in solid area, if it doesn't hit
+	// anything or on too lean planes
+	bool hit = !pmtrace.startsolid && pmtrace.fraction < 1.0f && normal.z > 0.7;
 
-	pmtrace.plane.normal = pmtrace.plane.normal.Normalize( );
+	if( cache )
+	{
+		cache->valid = 1;
+		cache->hit = hit;
+		cache->time = m_clTime;
+		cache->start = origin;
+		cache->normal = normal;
+		cache->dist = DotProduct( endpos, normal );
+	}
 
-	// don't allow shadow on too lean planes
-	if( pmtrace.plane.normal.z <= 0.7 )
+	return hit;
+}
+
+void CStudioModelRenderer::StudioDrawShadow( Vector origin, float scale )
+{
+	Vector p1, p2, p3, p4;
+	Vector endpos, normal;
+	float fraction;
+
+	if( gHUD.cl_shadows_distance->value > 0.0f && ( origin - Vector( m_vRenderOrigin )).Length( ) > gHUD.cl_shadows_distance->value )
 		return;
 
-	pmtrace.plane.normal = pmtrace.plane.normal * scale * ( 1.0 - pmtrace.fraction );
+	if( !StudioShadowTrace( origin, endpos, normal, fraction ))
+		return;
 
+	normal = normal * scale * ( 1.0 - fraction );
 
 	// add 2.0f to Z, for avoid Z-fighting
-	p1.x = pmtrace.endpos.x - pmtrace.plane.normal.z;
-	p1.y = pmtrace.endpos.y + pmtrace.plane.normal.z;
-	p1.z = pmtrace.endpos.z + 2.0f + pmtrace.plane.normal.x - pmtrace.plane.normal.y;
+	p1.x = endpos.x - normal.z;
+	p1.y = endpos.y + normal.z;
+	p1.z = endpos.z + 2.0f + normal.x - normal.y;
 
-	p2.x = pmtrace.endpos.x + pmtrace.plane.normal.z;
-	p2.y = pmtrace.endpos.y + pmtrace.plane.normal.z;
-	p2.z = pmtrace.endpos.z + 2.0f - pmtrace.plane.normal.x - pmtrace.plane.normal.y;
+	p2.x = endpos.x + normal.z;
+	p2.y = endpos.y + normal.z;
+	p2.z = endpos.z + 2.0f - normal.x - normal.y;
 
-	p3.x = pmtrace.endpos.x + pmtrace.plane.normal.z;
-	p3.y = pmtrace.endpos.y - pmtrace.plane.normal.z;
-	p3.z = pmtrace.endpos.z + 2.0f - pmtrace.plane.normal.x + pmtrace.plane.normal.y;
+	p3.x = endpos.x + normal.z;
+	p3.y = endpos.y - normal.z;
+	p3.z = endpos.z + 2.0f - normal.x + normal.y;
 
-	p4.x = pmtrace.endpos.x - pmtrace.plane.normal.z;
-	p4.y = pmtrace.endpos.y - pmtrace.plane.normal.z;
-	p4.z = pmtrace.endpos.z + 2.0f + pmtrace.plane.normal.x + pmtrace.plane.normal.y;
+	p4.x = endpos.x - normal.z;
+	p4.y = endpos.y - normal.z;
+	p4.z = endpos.z + 2.0f + normal.x + normal.y;
 
 	IEngineStudio.StudioRenderShadow( m_iShadowSprite, p1, p2, p3, p4 );
 }
@@ -0,0 +1,490 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <memory.h>
+#include <math.h>
+
+#include "studio_util.h"
+#include "StudioPose.h"
+
+void CStudioPose::CalcBoneAdj(studiohdr_t *hdr, float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen)
+{
+	int i, j;
+	float value;
+	mstudiobonecontroller_t *pbonecontroller;
+
+	pbonecontroller = (mstudiobonecontroller_t *)((byte *)hdr + hdr->bonecontrollerindex);
+
+	for (j = 0; j < hdr->numbonecontrollers; j++)
+	{
+		i = pbonecontroller[j].index;
+
+		if (i <= 3)
+		{
+			if (pbonecontroller[j].type & STUDIO_RLOOP)
+			{
+				if (abs(pcontroller1[i] - pcontroller2[i]) > 128)
+				{
+					int a, b;
+					a = (pcontroller1[j] + 128) % 256;
+					b = (pcontroller2[j] + 128) % 256;
+					value = ((a * dadt) + (b * (1 - dadt)) - 128) * (360.0 / 256.0) + pbonecontroller[j].start;
+				}
+				else
+				{
+					value = ((pcontroller1[i] * dadt + (pcontroller2[i]) * (1.0 - dadt))) * (360.0 / 256.0) + pbonecontroller[j].start;
+				}
+			}
+			else
+			{
+				value = (pcontroller1[i] * dadt + pcontroller2[i] * (1.0 - dadt)) / 255.0;
+
+				if (value < 0)
+					value = 0;
+
+				if (value > 1.0)
+					value = 1.0;
+
+				value = (1.0 - value) * pbonecontroller[j].start + value * pbonecontroller[j].end;
+			}
+		}
+		else
+		{
+			value = mouthopen / 64.0;
+
+			if (value > 1.0)
+				value = 1.0;
+
+			value = (1.0 - value) * pbonecontroller[j].start + value * pbonecontroller[j].end;
+		}
+
+		switch (pbonecontroller[j].type & STUDIO_TYPES)
+		{
+			case STUDIO_XR:
+			case STUDIO_YR:
+			case STUDIO_ZR:
+			{
+				adj[j] = value * (M_PI / 180.0);
+				break;
+			}
+			case STUDIO_X:
+			case STUDIO_Y:
+			case STUDIO_Z:
+			{
+				adj[j] = value;
+				break;
+			}
+		}
+	}
+}
+
+void CStudioPose::CalcBoneQuaterion(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *q)
+{
+	int j, k;
+	vec4_t q1, q2;
+	vec3_t angle1, angle2;
+	mstudioanimvalue_t *panimvalue;
+
+	for (j = 0; j < 3; j++)
+	{
+		if (panim->offset[j + 3] == 0)
+		{
+			angle2[j] = angle1[j] = pbone->value[j + 3];
+		}
+		else
+		{
+			panimvalue = (mstudioanimvalue_t *)((byte *)panim + panim->offset[j + 3]);
+			k = frame;
+
+			if (panimvalue->num.total < panimvalue->num.valid)
+				k = 0;
+
+			while (panimvalue->num.total <= k)
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+
+				if (panimvalue->num.total < panimvalue->num.valid)
+					k = 0;
+			}
+
+			if (panimvalue->num.valid > k)
+			{
+				angle1[j] = panimvalue[k + 1].value;
+
+				if (panimvalue->num.valid > k + 1)
+				{
+					angle2[j] = panimvalue[k + 2].value;
+				}
+				else
+				{
+					if (panimvalue->num.total > k + 1)
+						angle2[j] = angle1[j];
+					else
+						angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
+				}
+			}
+			else
+			{
+				angle1[j] = panimvalue[panimvalue->num.valid].value;
+
+				if (panimvalue->num.total > k + 1)
+					angle2[j] = angle1[j];
+				else
+					angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
+			}
+
+			angle1[j] = pbone->value[j + 3] + angle1[j] * pbone->scale[j + 3];
+			angle2[j] = pbone->value[j + 3] + angle2[j] * pbone->scale[j + 3];
+		}
+
+		if (pbone->bonecontroller[j + 3] != -1)
+		{
+			angle1[j] += adj[pbone->bonecontroller[j + 3]];
+			angle2[j] += adj[pbone->bonecontroller[j + 3]];
+		}
+	}
+
+	if (!VectorCompare(angle1, angle2))
+	{
+		AngleQuaternion(angle1, q1);
+		AngleQuaternion(angle2, q2);
+		QuaternionSlerp(q1, q2, s, q);
+	}
+	else
+	{
+		AngleQuaternion(angle1, q);
+	}
+}
+
+
+void CStudioPose::CalcBonePosition(int frame, float s, mstudiobone_t *pbone, mstudioanim_t *panim, float *adj, float *pos)
+{
+	int j, k;
+	mstudioanimvalue_t *panimvalue;
+
+	for (j = 0; j < 3; j++)
+	{
+		pos[j] = pbone->value[j];
+
+		if (panim->offset[j] != 0)
+		{
+			panimvalue = (mstudioanimvalue_t *)((byte *)panim + panim->offset[j]);
+			k = frame;
+
+			if (panimvalue->num.total < panimvalue->num.valid)
+				k = 0;
+
+			while (panimvalue->num.total <= k)
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+
+				if (panimvalue->num.total < panimvalue->num.valid)
+					k = 0;
+			}
+
+			if (panimvalue->num.valid > k)
+			{
+				if (panimvalue->num.valid > k + 1)
+					pos[j] += (panimvalue[k + 1].value * (1.0 - s) + s * panimvalue[k + 2].value) * pbone->scale[j];
+				else
+					pos[j] += panimvalue[k + 1].value * pbone->scale[j];
+			}
+			else
+			{
+				if (panimvalue->num.total <= k + 1)
+					pos[j] += (panimvalue[panimvalue->num.valid].value * (1.0 - s) + s * panimvalue[panimvalue->num.valid + 2].value) * pbone->scale[j];
+				else
+					pos[j] += panimvalue[panimvalue->num.valid].value * pbone->scale[j];
+			}
+		}
+
+		if (pbone->bonecontroller[j] != -1 && adj)
+			pos[j] += adj[pbone->bonecontroller[j]];
+	}
+}
+
+void CStudioPose::SlerpBones(int numbones, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
+{
+	int i;
+	float s1;
+
+	if (s < 0)
+		s = 0;
+	else if (s > 1.0)
+		s = 1.0;
+
+	s1 = 1.0 - s;
+
+	QuaternionSlerpBatch(q1, q2, s, q1, numbones);
+
+	for (i = 0; i < numbones; i++)
+	{
+		pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s;
+		pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s;
+		pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s;
+	}
+}
+
+float CStudioPose::EstimateInterpolant(const studioposeinput_t *in)
+{
+	float dadt = 1.0;
+
+	if (in->dointerp && (in->animtime >= in->prevanimtime + 0.01))
+	{
+		dadt = (in->time - in->animtime) / 0.1;
+
+		if (dadt > 2.0)
+			dadt = 2.0;
+	}
+
+	return dadt;
+}
+
+void CStudioPose::CalcRotations(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f)
+{
+	int i;
+	int frame;
+	mstudiobone_t *pbone;
+
+	float s;
+	float adj[MAXSTUDIOCONTROLLERS];
+	float dadt;
+
+	if (f > pseqdesc->numframes - 1)
+		f = 0;
+	else if (f < -0.01)
+		f = -0.01;
+
+	frame = (int)f;
+	dadt = EstimateInterpolant(in);
+	s = (f - frame);
+
+	pbone = (mstudiobone_t *)((byte *)in->hdr + in->hdr->boneindex);
+
+	CalcBoneAdj(in->hdr, dadt, adj, in->controller, in->prevcontroller, in->mouthopen);
+
+	for (i = 0; i < in->hdr->numbones; i++, pbone++, panim++)
+	{
+		CalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
+		CalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
+	}
+
+	if (pseqdesc->motiontype & STUDIO_X)
+		pos[pseqdesc->motionbone][0] = 0.0;
+
+	if (pseqdesc->motiontype & STUDIO_Y)
+		pos[pseqdesc->motionbone][1] = 0.0;
+
+	if (pseqdesc->motiontype & STUDIO_Z)
+		pos[pseqdesc->motionbone][2] = 0.0;
+
+	s = 0 * ((1.0 - (f - (int)(f))) / (pseqdesc->numframes)) * in->framerate;
+
+	if (pseqdesc->motiontype & STUDIO_LX)
+		pos[pseqdesc->motionbone][0] += s * pseqdesc->linearmovement[0];
+
+	if (pseqdesc->motiontype & STUDIO_LY)
+		pos[pseqdesc->motionbone][1] += s * pseqdesc->linearmovement[1];
+
+	if (pseqdesc->motiontype & STUDIO_LZ)
+		pos[pseqdesc->motionbone][2] += s * pseqdesc->linearmovement[2];
+}
+
+void CStudioPose::CalcBlends(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f, const byte *blending, bool interpolate)
+{
+	int numbones = in->hdr->numbones;
+	float s0, s1;
+
+	if (pseqdesc->numblends <= 1)
+	{
+		CalcRotations(in, pos, q, pseqdesc, panim, f);
+		return;
+	}
+
+	if (interpolate)
+	{
+		float dadt = EstimateInterpolant(in);
+
+		s0 = (blending[0] * dadt + in->prevblending[0] * (1.0 - dadt)) / 255.0;
+		s1 = (blending[1] * dadt + in->prevblending[1] * (1.0 - dadt)) / 255.0;
+	}
+	else
+	{
+		s0 = blending[0] / 255.0;
+		s1 = blending[1] / 255.0;
+	}
+
+	if (in->lod >= ANIMLOD_SIMPLE)
+	{
+		int nearest = (s0 >= 0.5f) + ((pseqdesc->numblends == 4 && s1 >= 0.5f) ? 2 : 0);
+
+		CalcRotations(in, pos, q, pseqdesc, panim + numbones * nearest, f);
+		return;
+	}
+
+	CalcRotations(in, pos, q, pseqdesc, panim, f);
+	CalcRotations(in, m_Pos2, m_Q2, pseqdesc, panim + numbones, f);
+	SlerpBones(numbones, q, pos, m_Q2, m_Pos2, s0);
+
+	if (pseqdesc->numblends == 4)
+	{
+		CalcRotations(in, m_Pos3, m_Q3, pseqdesc, panim + numbones * 2, f);
+		CalcRotations(in, m_Pos4, m_Q4, pseqdesc, panim + numbones * 3, f);
+
+		SlerpBones(numbones, m_Q3, m_Pos3, m_Q4, m_Pos4, s0);
+		SlerpBones(numbones, q, pos, m_Q3, m_Pos3, s1);
+	}
+}
+
+/*
+====================
+CalcBlends9
+
+Counter-Strike player sequences hold a 3x3 grid of blends, yaw across and
+pitch down; only the four around the blend point are evaluated
+====================
+*/
+void CStudioPose::CalcBlends9(const studioposeinput_t *in, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f, const byte *blending)
+{
+	int numbones = in->hdr->numbones;
+	int corner = 0;
+
+	if (pseqdesc->numblends != 9)
+	{
+		CalcRotations(in, pos, q, pseqdesc, panim, f);
+		return;
+	}
+
+	float s = blending[0];
+	float t = blending[1];
+
+	if (in->lod >= ANIMLOD_SIMPLE)
+	{
+		// the grid point closest to the blend point
+		corner = (int)(s / 255.0 * 2.0 + 0.5) + 3 * (int)(t / 255.0 * 2.0 + 0.5);
+
+		CalcRotations(in, pos, q, pseqdesc, panim + numbones * corner, f);
+		return;
+	}
+
+	if (s <= 127.0)
+	{
+		s = (s * 2.0);
+	}
+	else
+	{
+		s = 2.0 * (s - 127.0);
+		corner += 1;
+	}
+
+	if (t <= 127.0)
+	{
+		t = (t * 2.0);
+	}
+	else
+	{
+		t = 2.0 * (t - 127.0);
+		corner += 3;
+	}
+
+	CalcRotations(in, pos, q, pseqdesc, panim + numbones * corner, f);
+	CalcRotations(in, m_Pos2, m_Q2, pseqdesc, panim + numbones * (corner + 1), f);
+	CalcRotations(in, m_Pos3, m_Q3, pseqdesc, panim + numbones * (corner + 3), f);
+	CalcRotations(in, m_Pos4, m_Q4, pseqdesc, panim + numbones * (corner + 4), f);
+
+	s /= 255.0;
+	t /= 255.0;
+
+	SlerpBones(numbones, q, pos, m_Q2, m_Pos2, s);
+	SlerpBones(numbones, m_Q3, m_Pos3, m_Q4, m_Pos4, s);
+	SlerpBones(numbones, q, pos, m_Q3, m_Pos3, t);
+}
+
+void CStudioPose::Evaluate(const studioposeinput_t *in, float pos[][3], vec4_t *q)
+{
+	EvaluateSequence(in, pos, q);
+	MergeGait(in, pos, q);
+}
+
+/*
+====================
+EvaluateSequence
+
+The pose of the sequence itself, blended out of the previous one while
+in a transition; no gait
+====================
+*/
+void CStudioPose::EvaluateSequence(const studioposeinput_t *in, float pos[][3], vec4_t *q)
+{
+	int numbones = in->hdr->numbones;
+	mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)((byte *)in->hdr + in->hdr->seqindex);
+
+	if (in->blend9)
+		CalcBlends9(in, pos, q, pseqdesc + in->sequence, in->anim, in->frame, in->blending);
+	else
+		CalcBlends(in, pos, q, pseqdesc + in->sequence, in->anim, in->frame, in->blending, true);
+
+	if (in->transition)
+	{
+		float s;
+
+		// the previous sequence keeps the blends it was left with
+		if (in->blend9)
+			CalcBlends9(in, m_Pos1b, m_Q1b, pseqdesc + in->prevsequence, in->prevanim, in->prevframe, in->prevseqblending);
+		else
+			CalcBlends(in, m_Pos1b, m_Q1b, pseqdesc + in->prevsequence, in->prevanim, in->prevframe, in->prevseqblending, false);
+
+		s = 1.0 - (in->time - in->sequencetime) / 0.2;
+		SlerpBones(numbones, q, pos, m_Q1b, m_Pos1b, s);
+	}
+}
+
+void CStudioPose::MergeGait(const studioposeinput_t *in, float pos[][3], vec4_t *q)
+{
+	int i;
+	int numbones = in->hdr->numbones;
+	mstudioseqdesc_t *pseqdesc = (mstudioseqdesc_t *)((byte *)in->hdr + in->hdr->seqindex);
+
+	if (in->gaitmode == POSE_GAIT_NONE)
+		return;
+
+	CalcRotations(in, m_Pos2, m_Q2, pseqdesc + in->gaitsequence, in->gaitanim, in->gaitframe);
+
+	if (in->gaitmode == POSE_GAIT_SPINE)
+	{
+		memcpy(pos, m_Pos2, sizeof(pos[0]) * in->spinebone);
+		memcpy(q, m_Q2, sizeof(q[0]) * in->spinebone);
+		return;
+	}
+
+	for (i = 0; i < numbones; i++)
+	{
+		if (in->gaitbones[i])
+		{
+			memcpy(pos[i], m_Pos2[i], sizeof(pos[i]));
+			memcpy(q[i], m_Q2[i], sizeof(q[i]));
+		}
+	}
+}
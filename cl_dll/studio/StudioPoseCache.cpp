@@ -0,0 +1,166 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <string.h>
+#include <memory.h>
+#include <math.h>
+
+#include "StudioPoseCache.h"
+
+CStudioPoseCache::CStudioPoseCache(void)
+{
+	m_pCvarPoseCache = NULL;
+	m_pCvarPoseCacheStats = NULL;
+
+	Flush();
+}
+
+void CStudioPoseCache::Init(void)
+{
+	// 0 - disabled, 1 - share poses inside one frame, 2 - keep poses across frames
+	m_pCvarPoseCache = CVAR_CREATE("cl_posecache", "1", FCVAR_ARCHIVE);
+	m_pCvarPoseCacheStats = CVAR_CREATE("cl_posecache_stats", "0", 0);
+}
+
+void CStudioPoseCache::Flush(void)
+{
+	for (int i = 0; i < POSECACHE_ENTRIES; i++)
+	{
+		m_Entries[i].lastframe = -1;
+		m_Entries[i].hash = 0;
+	}
+
+	m_nFrameCount = 0;
+	m_nHits = m_nMisses = 0;
+	m_nLastHits = m_nLastMisses = 0;
+}
+
+void CStudioPoseCache::BeginFrame(int framecount)
+{
+	if (framecount == m_nFrameCount)
+		return;
+
+	// level change or demo restart, model memory can be reused
+	if (framecount < m_nFrameCount)
+		Flush();
+
+	m_nFrameCount = framecount;
+	m_nLastHits = m_nHits;
+	m_nLastMisses = m_nMisses;
+	m_nHits = m_nMisses = 0;
+
+	if (m_pCvarPoseCacheStats && m_pCvarPoseCacheStats->value)
+	{
+		int total = m_nLastHits + m_nLastMisses;
+
+		gEngfuncs.Con_NPrintf(1, (char *)"pose cache: %i hits, %i misses (%i%%)", m_nLastHits, m_nLastMisses, total ? m_nLastHits * 100 / total : 0);
+	}
+}
+
+bool CStudioPoseCache::IsEnabled(void)
+{
+	return m_pCvarPoseCache && m_pCvarPoseCache->value;
+}
+
+float CStudioPoseCache::Quantize(float frame)
+{
+	// round down so a clamped frame never steps past the last one
+	return floor(frame * POSECACHE_FRAME_QUANT) / POSECACHE_FRAME_QUANT;
+}
+
+void CStudioPoseCache::ClearKey(posekey_t *key)
+{
+	// keys are compared with memcmp, so padding must be zeroed too
+	memset(key, 0, sizeof(*key));
+}
+
+unsigned int CStudioPoseCache::HashKey(const posekey_t *key)
+{
+	const byte *p = (const byte *)key;
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(*key); i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash ? hash : 1;
+}
+
+bool CStudioPoseCache::Lookup(const posekey_t *key, float pos[][3], vec4_t *q, int numbones)
+{
+	unsigned int hash = HashKey(key);
+	int crossframe = m_pCvarPoseCache->value >= 2;
+
+	for (int i = 0; i < POSECACHE_PROBE; i++)
+	{
+		posecache_entry_t *entry = &m_Entries[(hash + i) & (POSECACHE_ENTRIES - 1)];
+
+		if (entry->lastframe < 0 || entry->hash != hash || entry->numbones != numbones)
+			continue;
+
+		if (!crossframe && entry->lastframe != m_nFrameCount)
+			continue;
+
+		if (memcmp(&entry->key, key, sizeof(*key)))
+			continue;
+
+		memcpy(pos, entry->pos, sizeof(entry->pos[0]) * numbones);
+		memcpy(q, entry->q, sizeof(entry->q[0]) * numbones);
+		entry->lastframe = m_nFrameCount;
+
+		m_nHits++;
+		return true;
+	}
+
+	m_nMisses++;
+	return false;
+}
+
+void CStudioPoseCache::Store(const posekey_t *key, float pos[][3], vec4_t *q, int numbones)
+{
+	unsigned int hash = HashKey(key);
+	posecache_entry_t *best = NULL;
+
+	// take an empty or stale slot first, otherwise evict the least recently used one
+	for (int i = 0; i < POSECACHE_PROBE; i++)
+	{
+		posecache_entry_t *entry = &m_Entries[(hash + i) & (POSECACHE_ENTRIES - 1)];
+
+		if (entry->lastframe < 0 || m_nFrameCount - entry->lastframe > POSECACHE_MAX_AGE)
+		{
+			best = entry;
+			break;
+		}
+
+		if (!best || entry->lastframe < best->lastframe)
+			best = entry;
+	}
+
+	memcpy(&best->key, key, sizeof(*key));
+	best->hash = hash;
+	best->lastframe = m_nFrameCount;
+	best->numbones = numbones;
+
+	memcpy(best->pos, pos, sizeof(best->pos[0]) * numbones);
+	memcpy(best->q, q, sizeof(best->q[0]) * numbones);
+}
@@ -0,0 +1,430 @@
+/***
+*
+*	Copyright (c) 1996-2002, Valve LLC. All rights reserved.
+*
+*	This product contains software technology licensed from Id
+*	Software, Inc. ("Id Technology").  Id Technology (c) 1996 Id Software, Inc.
+*	All Rights Reserved.
+*
+*   Use, distribution, and modification of this source code and/or resulting
+*   object code is restricted to non-commercial enhancements to products from
+*   Valve LLC.  All other use, distribution, or modification is prohibited
+*   without written permission from Valve LLC.
+*
+****/
+
+#include "hud.h"
+#include "cl_util.h"
+#include "const.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <string.h>
+#include <memory.h>
+
+#include "StudioPosePrepass.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+typedef struct poseworker_s
+{
+	CStudioPosePrepass *prepass;
+	CStudioPose pose;
+} poseworker_t;
+
+typedef struct poseprepass_sys_s
+{
+#ifdef _WIN32
+	CRITICAL_SECTION lock;
+	HANDLE wake;			// semaphore, one count per job round a worker should look for
+	HANDLE threads[POSEPREPASS_MAX_THREADS];
+#else
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int wakeups;
+	pthread_t threads[POSEPREPASS_MAX_THREADS];
+#endif
+	poseworker_t *workers[POSEPREPASS_MAX_THREADS];
+} poseprepass_sys_t;
+
+static void Sys_Lock(poseprepass_sys_t *sys)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&sys->lock);
+#else
+	pthread_mutex_lock(&sys->lock);
+#endif
+}
+
+static void Sys_Unlock(poseprepass_sys_t *sys)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&sys->lock);
+#else
+	pthread_mutex_unlock(&sys->lock);
+#endif
+}
+
+static void Sys_Wake(poseprepass_sys_t *sys, int count)
+{
+#ifdef _WIN32
+	ReleaseSemaphore(sys->wake, count, NULL);
+#else
+	pthread_mutex_lock(&sys->lock);
+	sys->wakeups += count;
+	pthread_cond_broadcast(&sys->wake);
+	pthread_mutex_unlock(&sys->lock);
+#endif
+}
+
+static void Sys_WaitWake(poseprepass_sys_t *sys)
+{
+#ifdef _WIN32
+	WaitForSingleObject(sys->wake, INFINITE);
+#else
+	pthread_mutex_lock(&sys->lock);
+
+	while (!sys->wakeups)
+		pthread_cond_wait(&sys->wake, &sys->lock);
+
+	sys->wakeups--;
+	pthread_mutex_unlock(&sys->lock);
+#endif
+}
+
+static void Sys_Yield(void)
+{
+#ifdef _WIN32
+	Sleep(0);
+#else
+	sched_yield();
+#endif
+}
+
+static int Sys_NumCPUs(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI PosePrepass_Thread(LPVOID arg)
+#else
+static void *PosePrepass_Thread(void *arg)
+#endif
+{
+	poseworker_t *worker = (poseworker_t *)arg;
+
+	worker->prepass->Work(&worker->pose);
+	return 0;
+}
+
+CStudioPosePrepass::CStudioPosePrepass(void)
+{
+	m_pCvarPosePrepass = NULL;
+	m_pSys = NULL;
+	m_nThreads = -1;
+	m_bQuit = 0;
+	m_nFrameCount = -1;
+	m_nJobs = 0;
+	m_nPending = 0;
+	m_nNextJob = 0;
+
+	memset(m_Jobs, 0, sizeof(m_Jobs));
+	memset(m_pEntityJobs, 0, sizeof(m_pEntityJobs));
+}
+
+void CStudioPosePrepass::Init(void)
+{
+	m_pCvarPosePrepass = CVAR_CREATE("cl_poseprepass", "1", FCVAR_ARCHIVE);
+}
+
+bool CStudioPosePrepass::StartThreads(void)
+{
+	int i;
+
+	m_nThreads = Sys_NumCPUs() - 1;
+
+	if (m_nThreads > POSEPREPASS_MAX_THREADS)
+		m_nThreads = POSEPREPASS_MAX_THREADS;
+
+	// the main thread alone gains nothing from evaluating ahead of time
+	if (m_nThreads <= 0)
+	{
+		m_nThreads = 0;
+		return false;
+	}
+
+	m_pSys = new poseprepass_sys_t;
+	memset(m_pSys, 0, sizeof(*m_pSys));
+
+#ifdef _WIN32
+	InitializeCriticalSection(&m_pSys->lock);
+	m_pSys->wake = CreateSemaphore(NULL, 0, POSEPREPASS_MAX_JOBS * POSEPREPASS_MAX_THREADS, NULL);
+#else
+	pthread_mutex_init(&m_pSys->lock, NULL);
+	pthread_cond_init(&m_pSys->wake, NULL);
+#endif
+
+	for (i = 0; i < m_nThreads; i++)
+	{
+		m_pSys->workers[i] = new poseworker_t;
+		m_pSys->workers[i]->prepass = this;
+
+#ifdef _WIN32
+		m_pSys->threads[i] = CreateThread(NULL, 0, PosePrepass_Thread, m_pSys->workers[i], 0, NULL);
+
+		if (!m_pSys->threads[i])
+			break;
+#else
+		if (pthread_create(&m_pSys->threads[i], NULL, PosePrepass_Thread, m_pSys->workers[i]))
+			break;
+#endif
+	}
+
+	if (i < m_nThreads)
+	{
+		delete m_pSys->workers[i];
+		m_pSys->workers[i] = NULL;
+
+		gEngfuncs.Con_DPrintf("cl_poseprepass: started %i of %i worker threads\n", i, m_nThreads);
+		m_nThreads = i;
+	}
+
+	return m_nThreads > 0;
+}
+
+void CStudioPosePrepass::Shutdown(void)
+{
+	if (!m_pSys)
+		return;
+
+	Flush();
+
+	m_bQuit = 1;
+	Sys_Wake(m_pSys, m_nThreads);
+
+	for (int i = 0; i < m_nThreads; i++)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(m_pSys->threads[i], INFINITE);
+		CloseHandle(m_pSys->threads[i]);
+#else
+		pthread_join(m_pSys->threads[i], NULL);
+#endif
+		delete m_pSys->workers[i];
+	}
+
+#ifdef _WIN32
+	CloseHandle(m_pSys->wake);
+	DeleteCriticalSection(&m_pSys->lock);
+#else
+	pthread_cond_destroy(&m_pSys->wake);
+	pthread_mutex_destroy(&m_pSys->lock);
+#endif
+
+	delete m_pSys;
+	m_pSys = NULL;
+	m_nThreads = -1;
+	m_bQuit = 0;
+}
+
+/*
+====================
+Flush
+
+Takes back every job: the ones nobody started are dropped, the ones a
+worker is on are waited for. Model memory may be released after this
+====================
+*/
+void CStudioPosePrepass::Flush(void)
+{
+	int i;
+	bool running;
+
+	if (m_pSys)
+	{
+		do
+		{
+			running = false;
+			Sys_Lock(m_pSys);
+
+			for (i = 0; i < m_nJobs; i++)
+			{
+				if (m_Jobs[i].state == POSEJOB_QUEUED)
+					m_Jobs[i].state = POSEJOB_FREE;
+				else if (m_Jobs[i].state == POSEJOB_RUNNING)
+					running = true;
+			}
+
+			if (!running)
+			{
+				m_nJobs = 0;
+				m_nNextJob = 0;
+			}
+
+			Sys_Unlock(m_pSys);
+
+			// a pose takes microseconds, not worth a wait object
+			if (running)
+				Sys_Yield();
+		} while (running);
+	}
+
+	m_nJobs = 0;
+	m_nPending = 0;
+	memset(m_pEntityJobs, 0, sizeof(m_pEntityJobs));
+}
+
+bool CStudioPosePrepass::BeginFrame(int framecount)
+{
+	if (framecount == m_nFrameCount)
+		return false;
+
+	m_nFrameCount = framecount;
+	Flush();
+
+	if (!m_pCvarPosePrepass || !m_pCvarPosePrepass->value)
+		return false;
+
+	if (m_nThreads < 0)
+		StartThreads();
+
+	return m_nThreads > 0;
+}
+
+bool CStudioPosePrepass::AddJob(int index, const studioposeinput_t *input)
+{
+	if (m_nPending >= POSEPREPASS_MAX_JOBS || index < 1 || index > MAX_CLIENTS)
+		return false;
+
+	posejob_t *job = &m_Jobs[m_nPending++];
+
+	job->input = *input;
+	job->index = index;
+	job->state = POSEJOB_FREE;
+	m_pEntityJobs[index] = job;
+
+	return true;
+}
+
+void CStudioPosePrepass::Run(void)
+{
+	if (!m_pSys || !m_nPending)
+		return;
+
+	Sys_Lock(m_pSys);
+
+	for (int i = 0; i < m_nPending; i++)
+		m_Jobs[i].state = POSEJOB_QUEUED;
+
+	m_nJobs = m_nPending;
+	m_nNextJob = 0;
+
+	Sys_Unlock(m_pSys);
+
+	Sys_Wake(m_pSys, min(m_nThreads, m_nJobs));
+}
+
+posejob_t *CStudioPosePrepass::ClaimJob(void)
+{
+	posejob_t *job = NULL;
+
+	Sys_Lock(m_pSys);
+
+	for (; m_nNextJob < m_nJobs; m_nNextJob++)
+	{
+		if (m_Jobs[m_nNextJob].state == POSEJOB_QUEUED)
+		{
+			job = &m_Jobs[m_nNextJob++];
+			job->state = POSEJOB_RUNNING;
+			break;
+		}
+	}
+
+	Sys_Unlock(m_pSys);
+
+	return job;
+}
+
+void CStudioPosePrepass::Work(CStudioPose *pose)
+{
+	posejob_t *job;
+
+	while (1)
+	{
+		Sys_WaitWake(m_pSys);
+
+		if (m_bQuit)
+			break;
+
+		while ((job = ClaimJob()) != NULL)
+		{
+			pose->Evaluate(&job->input, job->pos, job->q);
+
+			Sys_Lock(m_pSys);
+			job->state = POSEJOB_DONE;
+			Sys_Unlock(m_pSys);
+		}
+	}
+}
+
+/*
+====================
+Fetch
+
+Hands out the pose a worker evaluated for this entity, provided it was
+evaluated from exactly this input. A job no worker has picked up yet is
+cheaper to evaluate inline than to wait for, so it is taken back
+====================
+*/
+bool CStudioPosePrepass::Fetch(int index, const studioposeinput_t *input, float pos[][3], vec4_t *q)
+{
+	posejob_t *job;
+	int state;
+
+	if (index < 1 || index > MAX_CLIENTS || !m_pEntityJobs[index] || !m_pSys)
+		return false;
+
+	job = m_pEntityJobs[index];
+
+	if (memcmp(&job->input, input, sizeof(*input)))
+		return false;
+
+	while (1)
+	{
+		Sys_Lock(m_pSys);
+
+		state = job->state;
+
+		if (state == POSEJOB_QUEUED)
+			job->state = POSEJOB_FREE;
+
+		Sys_Unlock(m_pSys);
+
+		if (state != POSEJOB_RUNNING)
+			break;
+
+		Sys_Yield();
+	}
+
+	if (state != POSEJOB_DONE)
+		return false;
+
+	memcpy(pos, job->pos, sizeof(pos[0]) * input->hdr->numbones);
+	memcpy(q, job->q, sizeof(q[0]) * input->hdr->numbones);
+
+	return true;
+}
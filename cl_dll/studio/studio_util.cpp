@@ -12,22 +12,31 @@
 #include "com_model.h"
 #include "studio_util.h"
 
-#ifdef VECTORIZE_SINCOS
+// batch bone kernels, picked at runtime in StudioUtil_SetSIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STUDIO_SIMD_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__NEON__)
+#define STUDIO_SIMD_NEON
+#endif
+
+#if defined(VECTORIZE_SINCOS) || defined(STUDIO_SIMD_SSE2) || defined(STUDIO_SIMD_NEON)
 
 // Test shown that this is not so effictively
-#if defined(__SSE__) || defined(_M_IX86_FP)
-#if defined(__SSE2__) || defined(_M_IX86_FP)
+#if defined(__SSE__) || defined(_M_IX86_FP) || defined(STUDIO_SIMD_SSE2)
+#if defined(__SSE2__) || defined(_M_IX86_FP) || defined(STUDIO_SIMD_SSE2)
   #define USE_SSE2
  #endif
 #include "sse_mathfun.h"
 #endif
 
 
-#if defined(__ARM_NEON__) || defined(__NEON__)
+#if defined(__ARM_NEON__) || defined(__NEON__) || defined(STUDIO_SIMD_NEON)
 	#include "neon_mathfun.h"
 #endif
 
+#endif
 
+#ifdef VECTORIZE_SINCOS
 void SinCosFastVector(float r1, float r2, float r3, float r4,
 					  float *s0, float *s1, float *s2, float *s3,
 					  float *c0, float *c1, float *c2, float *c3)
@@ -252,3 +261,332 @@ void MatrixCopy( float in[3][4], float out[3][4] )
 {
 	memcpy( out, in, sizeof( float ) * 3 * 4 );
 }
+
+/*
+====================
+StudioUtil_SetSIMD
+
+Selects between vectorized and scalar batch kernels. SIMD is used only
+when it was compiled in and the CPU reports support for it.
+====================
+*/
+static int g_iStudioSIMD = -1;
+
+static int StudioUtil_CPUHasSIMD( void )
+{
+#if defined(STUDIO_SIMD_SSE2)
+#if defined(__x86_64__) || defined(_M_X64)
+	return 1; // baseline of the architecture
+#elif defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "sse2" );
+#else
+	return 1;
+#endif
+#elif defined(STUDIO_SIMD_NEON)
+	return 1; // compiler only emits NEON when -mfpu=neon is given
+#else
+	return 0;
+#endif
+}
+
+int StudioUtil_SetSIMD( int enable )
+{
+	g_iStudioSIMD = enable && StudioUtil_CPUHasSIMD();
+
+	return g_iStudioSIMD;
+}
+
+static inline int StudioUtil_UseSIMD( void )
+{
+	if( g_iStudioSIMD < 0 )
+		StudioUtil_SetSIMD( 1 );
+
+	return g_iStudioSIMD;
+}
+
+#if defined(STUDIO_SIMD_SSE2)
+#define V4Set1( x )			_mm_set1_ps( x )
+#define V4Set( x, y, z, w )	_mm_set_ps( w, z, y, x )
+#define V4Load( p )			_mm_loadu_ps( p )
+#define V4Store( p, a )		_mm_storeu_ps( p, a )
+#define V4Add( a, b )		_mm_add_ps( a, b )
+#define V4Sub( a, b )		_mm_sub_ps( a, b )
+#define V4Mul( a, b )		_mm_mul_ps( a, b )
+#define V4Div( a, b )		_mm_div_ps( a, b )
+#define V4CmpGt( a, b )		_mm_cmpgt_ps( a, b )
+#define V4CmpLe( a, b )		_mm_cmple_ps( a, b )
+#define V4AnyMask( a )		_mm_movemask_ps( a )
+#define V4Transpose( r0, r1, r2, r3 ) _MM_TRANSPOSE4_PS( r0, r1, r2, r3 )
+
+static inline v4sf V4Select( v4sf mask, v4sf a, v4sf b )
+{
+	// a where mask is set, b otherwise
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ));
+}
+#elif defined(STUDIO_SIMD_NEON)
+#define V4Set1( x )			vdupq_n_f32( x )
+#define V4Load( p )			vld1q_f32( p )
+#define V4Store( p, a )		vst1q_f32( p, a )
+#define V4Add( a, b )		vaddq_f32( a, b )
+#define V4Sub( a, b )		vsubq_f32( a, b )
+#define V4Mul( a, b )		vmulq_f32( a, b )
+#define V4CmpGt( a, b )		vreinterpretq_f32_u32( vcgtq_f32( a, b ))
+#define V4CmpLe( a, b )		vreinterpretq_f32_u32( vcleq_f32( a, b ))
+
+static inline v4sf V4Set( float x, float y, float z, float w )
+{
+	float v[4] = { x, y, z, w };
+	return vld1q_f32( v );
+}
+
+static inline int V4AnyMask( v4sf a )
+{
+	uint32x4_t m = vreinterpretq_u32_f32( a );
+	uint32x2_t r = vorr_u32( vget_low_u32( m ), vget_high_u32( m ));
+
+	return ( vget_lane_u32( r, 0 ) | vget_lane_u32( r, 1 )) != 0;
+}
+
+static inline v4sf V4Div( v4sf a, v4sf b )
+{
+	// no divide on armv7, two newton steps are enough for float precision
+	v4sf r = vrecpeq_f32( b );
+	r = vmulq_f32( vrecpsq_f32( b, r ), r );
+	r = vmulq_f32( vrecpsq_f32( b, r ), r );
+	return vmulq_f32( a, r );
+}
+
+static inline void V4Transpose4( v4sf &r0, v4sf &r1, v4sf &r2, v4sf &r3 )
+{
+	float32x4x2_t t01 = vtrnq_f32( r0, r1 );
+	float32x4x2_t t23 = vtrnq_f32( r2, r3 );
+
+	r0 = vcombine_f32( vget_low_f32( t01.val[0] ), vget_low_f32( t23.val[0] ));
+	r1 = vcombine_f32( vget_low_f32( t01.val[1] ), vget_low_f32( t23.val[1] ));
+	r2 = vcombine_f32( vget_high_f32( t01.val[0] ), vget_high_f32( t23.val[0] ));
+	r3 = vcombine_f32( vget_high_f32( t01.val[1] ), vget_high_f32( t23.val[1] ));
+}
+#define V4Transpose( r0, r1, r2, r3 ) V4Transpose4( r0, r1, r2, r3 )
+
+static inline v4sf V4Select( v4sf mask, v4sf a, v4sf b )
+{
+	return vbslq_f32( vreinterpretq_u32_f32( mask ), a, b );
+}
+#endif
+
+/*
+====================
+QuaternionSlerpBatch
+
+qt may point to p. q is not modified, unlike QuaternionSlerp
+====================
+*/
+static void QuaternionSlerpBatch_Scalar( vec4_t *p, vec4_t *q, float t, vec4_t *qt, int start, int count )
+{
+	vec4_t q1, q2;
+
+	for( int i = start; i < count; i++ )
+	{
+		memcpy( q1, q[i], sizeof( q1 ));
+		QuaternionSlerp( p[i], q1, t, q2 );
+		memcpy( qt[i], q2, sizeof( q2 ));
+	}
+}
+
+void QuaternionSlerpBatch( vec4_t *p, vec4_t *q, float t, vec4_t *qt, int count )
+{
+	int i = 0;
+
+#if defined(STUDIO_SIMD_SSE2) || defined(STUDIO_SIMD_NEON)
+	if( StudioUtil_UseSIMD( ))
+	{
+		const v4sf one = V4Set1( 1.0f );
+		const v4sf zero = V4Set1( 0.0f );
+		const v4sf epsilon = V4Set1( 0.000001f );
+		const v4sf vt = V4Set1( t );
+		const v4sf vt1 = V4Set1( 1.0f - t );
+
+		// four bones at a time, transposed to x, y, z, w lanes
+		for( ; i + 4 <= count; i += 4 )
+		{
+			v4sf px = V4Load( p[i+0] ), py = V4Load( p[i+1] ), pz = V4Load( p[i+2] ), pw = V4Load( p[i+3] );
+			v4sf qx = V4Load( q[i+0] ), qy = V4Load( q[i+1] ), qz = V4Load( q[i+2] ), qw = V4Load( q[i+3] );
+			v4sf a, b, d, flip, cosom, linear;
+			float omega[4];
+
+			V4Transpose( px, py, pz, pw );
+			V4Transpose( qx, qy, qz, qw );
+
+			// decide if one of the quaternions is backwards
+			d = V4Sub( px, qx ); a = V4Mul( d, d );
+			d = V4Sub( py, qy ); a = V4Add( a, V4Mul( d, d ));
+			d = V4Sub( pz, qz ); a = V4Add( a, V4Mul( d, d ));
+			d = V4Sub( pw, qw ); a = V4Add( a, V4Mul( d, d ));
+			d = V4Add( px, qx ); b = V4Mul( d, d );
+			d = V4Add( py, qy ); b = V4Add( b, V4Mul( d, d ));
+			d = V4Add( pz, qz ); b = V4Add( b, V4Mul( d, d ));
+			d = V4Add( pw, qw ); b = V4Add( b, V4Mul( d, d ));
+
+			flip = V4CmpGt( a, b );
+			qx = V4Select( flip, V4Sub( zero, qx ), qx );
+			qy = V4Select( flip, V4Sub( zero, qy ), qy );
+			qz = V4Select( flip, V4Sub( zero, qz ), qz );
+			qw = V4Select( flip, V4Sub( zero, qw ), qw );
+
+			cosom = V4Add( V4Add( V4Mul( px, qx ), V4Mul( py, qy )),
+				V4Add( V4Mul( pz, qz ), V4Mul( pw, qw )));
+
+			// opposite quaternions are rare, let the scalar code handle them
+			if( V4AnyMask( V4CmpLe( V4Add( one, cosom ), epsilon )))
+			{
+				QuaternionSlerpBatch_Scalar( p, q, t, qt, i, i + 4 );
+				continue;
+			}
+
+			linear = V4CmpLe( V4Sub( one, cosom ), epsilon );
+
+			V4Store( omega, cosom );
+			omega[0] = acos( omega[0] );
+			omega[1] = acos( omega[1] );
+			omega[2] = acos( omega[2] );
+			omega[3] = acos( omega[3] );
+
+			v4sf vomega = V4Load( omega );
+			v4sf sinom = sin_ps( vomega );
+			v4sf sclp = V4Div( sin_ps( V4Mul( vt1, vomega )), sinom );
+			v4sf sclq = V4Div( sin_ps( V4Mul( vt, vomega )), sinom );
+
+			sclp = V4Select( linear, vt1, sclp );
+			sclq = V4Select( linear, vt, sclq );
+
+			px = V4Add( V4Mul( sclp, px ), V4Mul( sclq, qx ));
+			py = V4Add( V4Mul( sclp, py ), V4Mul( sclq, qy ));
+			pz = V4Add( V4Mul( sclp, pz ), V4Mul( sclq, qz ));
+			pw = V4Add( V4Mul( sclp, pw ), V4Mul( sclq, qw ));
+
+			V4Transpose( px, py, pz, pw );
+
+			V4Store( qt[i+0], px );
+			V4Store( qt[i+1], py );
+			V4Store( qt[i+2], pz );
+			V4Store( qt[i+3], pw );
+		}
+	}
+#endif
+
+	QuaternionSlerpBatch_Scalar( p, q, t, qt, i, count );
+}
+
+/*
+====================
+QuaternionMatrixBatch
+
+builds local bone matrices from rotation and position
+====================
+*/
+void QuaternionMatrixBatch( vec4_t *q, float (*pos)[3], float (*matrix)[3][4], int count )
+{
+	int i = 0;
+
+#if defined(STUDIO_SIMD_SSE2) || defined(STUDIO_SIMD_NEON)
+	if( StudioUtil_UseSIMD( ))
+	{
+		const v4sf one = V4Set1( 1.0f );
+		const v4sf two = V4Set1( 2.0f );
+
+		for( ; i + 4 <= count; i += 4 )
+		{
+			v4sf x = V4Load( q[i+0] ), y = V4Load( q[i+1] ), z = V4Load( q[i+2] ), w = V4Load( q[i+3] );
+
+			V4Transpose( x, y, z, w );
+
+			v4sf x2 = V4Mul( two, x ), y2 = V4Mul( two, y ), z2 = V4Mul( two, z );
+			v4sf xx = V4Mul( x2, x ), yy = V4Mul( y2, y ), zz = V4Mul( z2, z );
+			v4sf xy = V4Mul( x2, y ), xz = V4Mul( x2, z ), yz = V4Mul( y2, z );
+			v4sf wx = V4Mul( x2, w ), wy = V4Mul( y2, w ), wz = V4Mul( z2, w );
+
+			v4sf r0 = V4Sub( V4Sub( one, yy ), zz );
+			v4sf r1 = V4Sub( xy, wz );
+			v4sf r2 = V4Add( xz, wy );
+			v4sf r3 = V4Set( pos[i+0][0], pos[i+1][0], pos[i+2][0], pos[i+3][0] );
+
+			V4Transpose( r0, r1, r2, r3 );
+			V4Store( matrix[i+0][0], r0 );
+			V4Store( matrix[i+1][0], r1 );
+			V4Store( matrix[i+2][0], r2 );
+			V4Store( matrix[i+3][0], r3 );
+
+			r0 = V4Add( xy, wz );
+			r1 = V4Sub( V4Sub( one, xx ), zz );
+			r2 = V4Sub( yz, wx );
+			r3 = V4Set( pos[i+0][1], pos[i+1][1], pos[i+2][1], pos[i+3][1] );
+
+			V4Transpose( r0, r1, r2, r3 );
+			V4Store( matrix[i+0][1], r0 );
+			V4Store( matrix[i+1][1], r1 );
+			V4Store( matrix[i+2][1], r2 );
+			V4Store( matrix[i+3][1], r3 );
+
+			r0 = V4Sub( xz, wy );
+			r1 = V4Add( yz, wx );
+			r2 = V4Sub( V4Sub( one, xx ), yy );
+			r3 = V4Set( pos[i+0][2], pos[i+1][2], pos[i+2][2], pos[i+3][2] );
+
+			V4Transpose( r0, r1, r2, r3 );
+			V4Store( matrix[i+0][2], r0 );
+			V4Store( matrix[i+1][2], r1 );
+			V4Store( matrix[i+2][2], r2 );
+			V4Store( matrix[i+3][2], r3 );
+		}
+	}
+#endif
+
+	for( ; i < count; i++ )
+	{
+		QuaternionMatrix( q[i], matrix[i] );
+
+		matrix[i][0][3] = pos[i][0];
+		matrix[i][1][3] = pos[i][1];
+		matrix[i][2][3] = pos[i][2];
+	}
+}
+
+/*
+====================
+ConcatTransformsBatch
+
+out[i] = out[parents[i]] * in[i], or root * in[i] for root bones.
+parents must come before their children, as in studio models
+====================
+*/
+void ConcatTransformsBatch( float root[3][4], const int *parents, float (*in)[3][4], float (*out)[3][4], int count )
+{
+	int i;
+
+#if defined(STUDIO_SIMD_SSE2) || defined(STUDIO_SIMD_NEON)
+	if( StudioUtil_UseSIMD( ))
+	{
+		for( i = 0; i < count; i++ )
+		{
+			float (*in1)[4] = parents[i] == -1 ? root : out[parents[i]];
+			v4sf r0 = V4Load( in[i][0] );
+			v4sf r1 = V4Load( in[i][1] );
+			v4sf r2 = V4Load( in[i][2] );
+
+			for( int j = 0; j < 3; j++ )
+			{
+				v4sf row = V4Add( V4Add( V4Mul( V4Set1( in1[j][0] ), r0 ),
+					V4Mul( V4Set1( in1[j][1] ), r1 )),
+					V4Mul( V4Set1( in1[j][2] ), r2 ));
+
+				V4Store( out[i][j], V4Add( row, V4Set( 0.0f, 0.0f, 0.0f, in1[j][3] )));
+			}
+		}
+		return;
+	}
+#endif
+
+	for( i = 0; i < count; i++ )
+		ConcatTransforms( parents[i] == -1 ? root : out[parents[i]], in[i], out[i] );
+}
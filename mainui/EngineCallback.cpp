@@ -16,6 +16,15 @@ GNU General Public License for more details.
 #include "extdll_menu.h"
 #include "BaseMenu.h"
 #include "Utils.h"
+#include <stdio.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define COM_MKDIR( x ) _mkdir( x )
+#else
+#define COM_MKDIR( x ) mkdir( x, 0755 )
+#endif
 
 void EngFuncs::PIC_Set(HIMAGE hPic, int r, int g, int b, int a)
 {
@@ -93,3 +102,43 @@ int EngFuncs::UtfMoveRight(const char *str, int pos, int length)
 {
 	return Con_UtfMoveRight( str, pos, length );
 }
+
+/*
+=========================
+EngFuncs::COM_SaveFile
+
+Menu API has no file writing, so this writes to the game directory the
+way the engine would: filename is relative to it and missing directories
+are created. Returns false if the file couldn't be written completely
+=========================
+*/
+int EngFuncs::COM_SaveFile( const char *filename, const void *buffer, int len )
+{
+	char path[1024];
+	char gamedir[256];
+
+	GetGameDir( gamedir );
+	snprintf( path, sizeof( path ), "%s/%s", gamedir, filename );
+	path[sizeof( path ) - 1] = 0;
+
+	// may fail if they're already there
+	for( char *slash = strchr( path + strlen( gamedir ) + 1, '/' ); slash; slash = strchr( slash + 1, '/' ))
+	{
+		*slash = 0;
+		COM_MKDIR( path );
+		*slash = '/';
+	}
+
+	FILE *fd = fopen( path, "wb" );
+	if( !fd )
+		return false;
+
+	bool ok = fwrite( buffer, len, 1, fd ) == 1;
+	fclose( fd );
+
+	// don't leave truncated file behind
+	if( !ok )
+		remove( path );
+
+	return ok;
+}
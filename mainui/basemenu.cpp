@@ -39,6 +39,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 cvar_t		*ui_showmodels;
 cvar_t		*ui_show_window_stack;
 cvar_t		*ui_borderclip;
+cvar_t		*ui_fontcache;
+cvar_t		*ui_fontlazy;
 cvar_t		*ui_language;
 
 uiStatic_t	uiStatic;
@@ -313,119 +315,12 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 		yy = y + (h - charH)/2;
 	}
 
-	int i = 0;
-	int ellipsisWide = g_FontMgr.GetEllipsisWide( font );
-	bool giveup = false;
+	const textLayout_t *layout = g_FontMgr.GetTextLayout( font, string, w, h, charH, flags );
 
-	while( string[i] && !giveup )
+	for( int i = 0; i < layout->lines.Count(); i++ )
 	{
-		char line[1024], *l;
-		int j = i, len = 0;
-		int pixelWide = 0;
-		int save_pixelWide = 0;
-		int save_j = 0;
-
-		EngFuncs::UtfProcessChar( 0 );
-		while( string[j] )
-		{
-			if( string[j] == '\n' )
-			{
-				j++;
-				break;
-			}
-
-			if( len == sizeof( line ) - 1 )
-				break;
-
-			line[len] = string[j];
-
-			int uch = EngFuncs::UtfProcessChar( ( unsigned char )string[j] );
-
-			if( IsColorString( string + j )) // don't calc wides for colorstrings
-			{
-				line[len+1] = string[j+1];
-				len += 2;
-				j += 2;
-			}
-			else if( !uch ) // don't calc wides for invalid codepoints
-			{
-				len++;
-				j++;
-			}
-			else
-			{
-				int charWide;
-
-				// does we have free space for new line?
-				if( yy < (yy + h ) - charH )
-				{
-					if( uch == ' ' && pixelWide < w ) // remember last whitespace
-					{
-						save_pixelWide = pixelWide;
-						save_j = j;
-					}
-				}
-				else
-				{
-					// remember last position, when we still fit
-					if( pixelWide + ellipsisWide < w && j > 0 )
-					{
-						save_pixelWide = pixelWide;
-						save_j = j;
-					}
-				}
-
-				charWide = g_FontMgr.GetCharacterWidthScaled( font, uch, charH );
-
-				if( !(flags & ETF_NOSIZELIMIT) && pixelWide + charWide > w )
-				{
-					// do we have free space for new line?
-					if( yy < (yy + h) - charH )
-					{
-						// try to word wrap
-						if( save_j != 0 && save_pixelWide != 0 )
-						{
-							pixelWide = save_pixelWide;
-							len -= j - save_j; // skip whitespace
-							j = save_j + 1; // skip whitespace
-						}
-
-						break;
-					}
-					else
-					{
-
-						if( save_j != 0 && save_pixelWide != 0 )
-						{
-							pixelWide = save_pixelWide;
-							len -= j - save_j;
-							j = save_j;
-
-
-							if( len > 0 )
-							{
-								line[len] = '.';
-								line[len+1] = '.';
-								line[len+2] = '.';
-								len += 3;
-							}
-						}
-
-						// we don't have free space anymore, so just stop drawing
-						giveup = true;
-
-						break;
-					}
-				}
-				else
-				{
-					pixelWide += charWide;
-					j++;
-					len++;
-				}
-			}
-		}
-		line[len] = 0;
+		const textLine_t &line = layout->lines[i];
+		const int pixelWide = line.pixelWide;
 
 		// align the text as appropriate
 		if( justify & QM_LEFT  )
@@ -442,13 +337,13 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 		}
 
 		// draw it
-		l = line;
-		EngFuncs::UtfProcessChar( 0 );
-		while( *l )
+		for( int k = 0; k < line.numGlyphs; k++ )
 		{
-			if( IsColorString( l ))
+			ch = layout->glyphs[line.firstGlyph + k];
+
+			if( ch < 0 )
 			{
-				int colorNum = ColorIndex( *(l+1) );
+				int colorNum = TEXTLAYOUT_COLORNUM( ch );
 
 				if( colorNum == 7 && color != 0 )
 				{
@@ -459,18 +354,9 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 					modulate = PackAlpha( g_iColorTable[colorNum], UnpackAlpha( color ));
 				}
 
-				l += 2;
 				continue;
 			}
 
-			ch = *l++;
-			ch &= 255;
-
-// when using custom font render, we use utf-8
-			ch = EngFuncs::UtfProcessChar( (unsigned char) ch );
-			if( !ch )
-				continue;
-
 			if( flags & ETF_SHADOW )
 				g_FontMgr.DrawCharacter( font, ch, Point( xx + ofsX, yy + ofsY ), charH, shadowModulate, flags & ETF_ADDITIVE );
 
@@ -488,12 +374,8 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 			maxX = Q_max( xx, maxX );
 		}
 		yy += charH;
-
-		i = j;
 	}
 
-	EngFuncs::UtfProcessChar( 0 );
-
 	return maxX;
 }
 
@@ -1112,6 +994,8 @@ void UI_Init( void )
 	ui_show_window_stack = EngFuncs::CvarRegister( "ui_show_window_stack", "0", FCVAR_ARCHIVE );
 	ui_borderclip = EngFuncs::CvarRegister( "ui_borderclip", "0", FCVAR_ARCHIVE );
 	ui_language = EngFuncs::CvarRegister( "ui_language", "english", FCVAR_ARCHIVE );
+	ui_fontcache = EngFuncs::CvarRegister( "ui_fontcache", "1", FCVAR_ARCHIVE );
+	ui_fontlazy = EngFuncs::CvarRegister( "ui_fontlazy", "0", FCVAR_ARCHIVE );
 
 #ifdef CS16CLIENT
 	// autofill ammo after bought weapon
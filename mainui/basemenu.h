@@ -69,6 +69,8 @@ extern cvar_t	*ui_precache;
 extern cvar_t	*ui_showmodels;
 extern cvar_t   *ui_show_window_stack;
 extern cvar_t	*ui_borderclip;
+extern cvar_t	*ui_fontcache;
+extern cvar_t	*ui_fontlazy;
 extern cvar_t	*ui_language;
 
 typedef struct
@@ -256,10 +256,7 @@ public:
 	{ return engfuncs.pfnCompareFileTime( filename1, filename2, iCompare ); }
 	static inline const char *GetModeString( int mode )
 	{ return engfuncs.pfnGetModeString( mode ); }
-	static inline int COM_SaveFile( const char *filename, const void *buffer, int len )
-	{
-		return false;
-	}
+	static int COM_SaveFile( const char *filename, const void *buffer, int len );
 	static inline int DeleteFile( const char *filename )
 	{
 		return false;
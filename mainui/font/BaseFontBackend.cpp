@@ -15,14 +15,18 @@ GNU General Public License for more details.
 #include "BaseFontBackend.h"
 #include "FontManager.h"
 #include <math.h>
+#include <sys/stat.h>
 #include "Utils.h"
+#include "generichash.h"
 
 CBaseFont::CBaseFont()
 	: m_szName( ), m_iTall(), m_iWeight(), m_iFlags(),
 	m_iHeight(), m_iMaxCharWidth(), m_iAscent(),
 	m_iBlur(), m_fBrighten(),
-	m_iEllipsisWide( 0 ),
-	m_glyphs(0, 0)
+	m_iEllipsisWide( 0 ), m_iFontFileHash( 0 ),
+	m_glyphs(0, 0),
+	m_bLazyGlyphs( false ), m_iLazyCellW( 0 ), m_iLazyCellH( 0 ),
+	m_iLazyCellsPerRow( 0 ), m_iLazyCellsPerPage( 0 ), m_iLazyClock( 0 )
 {
 	SetDefLessFunc( m_glyphs );
 }
@@ -71,15 +75,262 @@ void CBaseFont::GetTextureName(char *dst, size_t len) const
 	}
 }
 
+/*
+=========================
+CBaseFont::SetFontFile
+
+Remember which file the glyphs come from, atlas cache is invalidated when it changes
+=========================
+*/
+void CBaseFont::SetFontFile( const char *path )
+{
+	struct stat st;
+
+	m_iFontFileHash = 0;
+
+	if( stat( path, &st ) )
+		return;
+
+	unsigned int stamp[2];
+	stamp[0] = (unsigned int)st.st_size;
+	stamp[1] = (unsigned int)st.st_mtime;
+
+	m_iFontFileHash = MurmurHash3_32( stamp, sizeof( stamp ), HashString( path, strlen( path ) ) );
+
+	// zero means "not cacheable"
+	if( !m_iFontFileHash )
+		m_iFontFileHash = 1;
+}
+
+#define FONTCACHE_DIR     "fontcache"
+#define FONTCACHE_IDENT   (('C'<<24)+('F'<<16)+('U'<<8)+'M') // "MUFC"
+#define FONTCACHE_VERSION 1
+
+// everything that changes rasterized glyphs or their placement
+struct fontcache_t
+{
+	int ident;
+	int version;
+	unsigned int fontFileHash;
+	unsigned int rangesHash;
+	int tall, weight, flags;
+	int blur;
+	float brighten;
+	int outlineSize;
+	int scanlineOffset;
+	float scanlineScale;
+	int height, maxCharWidth, ascent;
+	int numGlyphs;
+	int bitmapSize;
+};
+
+struct fontcacheglyph_t
+{
+	int ch;
+	wrect_t rect;
+};
+
+static unsigned int HashCharRanges( const charRange_t *range, int rangeSize )
+{
+	unsigned int hash = 0;
+
+	for( int i = 0; i < rangeSize; i++ )
+	{
+		int bounds[3] = { range[i].chMin, range[i].chMax, range[i].size };
+
+		hash = MurmurHash3_32( bounds, sizeof( bounds ), hash );
+		if( range[i].sequence )
+			hash = MurmurHash3_32( range[i].sequence, range[i].size * sizeof( int ), hash );
+	}
+
+	return hash;
+}
+
+void CBaseFont::FillAtlasCacheHeader( fontcache_t *hdr, unsigned int rangesHash ) const
+{
+	memset( hdr, 0, sizeof( *hdr ));
+	hdr->ident = FONTCACHE_IDENT;
+	hdr->version = FONTCACHE_VERSION;
+	hdr->fontFileHash = m_iFontFileHash;
+	hdr->rangesHash = rangesHash;
+	hdr->tall = m_iTall;
+	hdr->weight = m_iWeight;
+	hdr->flags = m_iFlags;
+	hdr->blur = m_iBlur;
+	hdr->brighten = m_fBrighten;
+	hdr->outlineSize = m_iOutlineSize;
+	hdr->scanlineOffset = m_iScanlineOffset;
+	hdr->scanlineScale = m_fScanlineScale;
+	hdr->height = m_iHeight;
+	hdr->maxCharWidth = m_iMaxCharWidth;
+	hdr->ascent = m_iAscent;
+}
+
+/*
+=========================
+CBaseFont::GetAtlasCachePath
+
+Cache files live in the game directory, named after the texture. The
+path is relative, for the engine filesystem
+=========================
+*/
+void CBaseFont::GetAtlasCachePath( const char *textureName, char *dst, size_t len ) const
+{
+	char base[256];
+
+	Q_strncpy( base, textureName, sizeof( base ));
+
+	char *ext = strrchr( base, '.' );
+	if( ext ) *ext = 0;
+
+	snprintf( dst, len, FONTCACHE_DIR "/%s.dat", base );
+	dst[len - 1] = 0;
+}
+
+/*
+=========================
+CBaseFont::LoadAtlasCache
+
+Returns uploaded texture, or 0 if cache is missing or doesn't match this font
+=========================
+*/
+HIMAGE CBaseFont::LoadAtlasCache( const char *textureName, unsigned int rangesHash )
+{
+	char path[512];
+	fontcache_t expected, hdr;
+	int length = 0;
+
+	if( !m_iFontFileHash || !ui_fontcache || !ui_fontcache->value )
+		return 0;
+
+	GetAtlasCachePath( textureName, path, sizeof( path ));
+
+	byte *data = EngFuncs::COM_LoadFile( path, &length );
+	if( !data )
+		return 0;
+
+	if( length < (int)sizeof( hdr ))
+	{
+		EngFuncs::COM_FreeFile( data );
+		return 0;
+	}
+
+	FillAtlasCacheHeader( &expected, rangesHash );
+	memcpy( &hdr, data, sizeof( hdr ));
+
+	// numGlyphs and bitmapSize are payload, not a part of the key
+	expected.numGlyphs = hdr.numGlyphs;
+	expected.bitmapSize = hdr.bitmapSize;
+
+	if( memcmp( &hdr, &expected, sizeof( hdr )) || hdr.numGlyphs <= 0 || hdr.bitmapSize <= (int)sizeof( bmp_t ))
+	{
+		Con_DPrintf( "Font cache %s is outdated\n", path );
+		EngFuncs::COM_FreeFile( data );
+		return 0;
+	}
+
+	// bitmap is handed to the engine as is
+	const int glyphsSize = hdr.numGlyphs * sizeof( fontcacheglyph_t );
+	const byte *bitmap = data + sizeof( hdr ) + glyphsSize;
+
+	if( hdr.numGlyphs > length / (int)sizeof( fontcacheglyph_t ) || hdr.bitmapSize > length
+		|| length != (int)sizeof( hdr ) + glyphsSize + hdr.bitmapSize || bitmap[0] != 'B' || bitmap[1] != 'M' )
+	{
+		Con_DPrintf( "Font cache %s is corrupted\n", path );
+		EngFuncs::COM_FreeFile( data );
+		return 0;
+	}
+
+	const fontcacheglyph_t *glyphs = (const fontcacheglyph_t *)( data + sizeof( hdr ));
+	for( int i = 0; i < hdr.numGlyphs; i++ )
+	{
+		glyph_t glyph;
+		glyph.ch = glyphs[i].ch;
+		glyph.rect = glyphs[i].rect;
+		glyph.texture = 0; // will be acquired later
+
+		m_glyphs.Insert( glyph );
+	}
+
+	HIMAGE hImage = EngFuncs::PIC_Load( textureName, bitmap, hdr.bitmapSize, 0 );
+	Con_DPrintf( "Uploaded %s to %i from font cache\n", textureName, hImage );
+	EngFuncs::COM_FreeFile( data );
+
+	return hImage;
+}
+
+void CBaseFont::SaveAtlasCache( const char *textureName, unsigned int rangesHash, const byte *bitmap, int bitmapSize )
+{
+	char path[512];
+	fontcache_t hdr;
+
+	if( !m_iFontFileHash || !ui_fontcache || !ui_fontcache->value || !m_glyphs.Count() )
+		return;
+
+	GetAtlasCachePath( textureName, path, sizeof( path ));
+
+	FillAtlasCacheHeader( &hdr, rangesHash );
+	hdr.numGlyphs = m_glyphs.Count();
+	hdr.bitmapSize = bitmapSize;
+
+	// one write, so a failed one leaves nothing that could match
+	const int glyphsSize = hdr.numGlyphs * sizeof( fontcacheglyph_t );
+	const int length = sizeof( hdr ) + glyphsSize + bitmapSize;
+	byte *data = new byte[length];
+
+	memcpy( data, &hdr, sizeof( hdr ));
+
+	fontcacheglyph_t *glyphs = (fontcacheglyph_t *)( data + sizeof( hdr ));
+	for( int i = m_glyphs.FirstInorder(); m_glyphs.IsValidIndex( i ); i = m_glyphs.NextInorder( i ), glyphs++ )
+	{
+		glyphs->ch = m_glyphs[i].ch;
+		glyphs->rect = m_glyphs[i].rect;
+	}
+
+	memcpy( data + sizeof( hdr ) + glyphsSize, bitmap, bitmapSize );
+
+	if( !EngFuncs::COM_SaveFile( path, data, length ))
+		Con_DPrintf( "Can't write font cache %s\n", path );
+
+	delete[] data;
+}
+
 #define MAX_PAGE_SIZE 256
 
 void CBaseFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
+{
+	char name[256];
+	const unsigned int rangesHash = HashCharRanges( range, rangeSize );
+
+	GetTextureName( name, sizeof( name ) );
+
+	HIMAGE hImage = LoadAtlasCache( name, rangesHash );
+
+	if( !hImage )
+	{
+		m_glyphs.RemoveAll();
+		hImage = RasterizeGlyphs( name, range, rangeSize, rangesHash );
+	}
+
+	for( int i = m_glyphs.FirstInorder();; i = m_glyphs.NextInorder( i ) )
+	{
+		if( !m_glyphs[i].texture )
+			m_glyphs[i].texture = hImage;
+		if( i == m_glyphs.LastInorder() )
+			break;
+	}
+
+	int dotWideA, dotWideB, dotWideC;
+	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
+	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+}
+
+HIMAGE CBaseFont::RasterizeGlyphs( const char *name, charRange_t *range, int rangeSize, unsigned int rangesHash )
 {
 	const int maxWidth = GetMaxCharWidth();
 	const int height = GetHeight();
 	const int tempSize = maxWidth * height * 4; // allocate temporary buffer for max possible glyph size
 	const Point nullPt( 0, 0 );
-	char name[256];
 
 	CBMP bmp( MAX_PAGE_SIZE, MAX_PAGE_SIZE );
 	byte *rgbdata = bmp.GetTextureData();
@@ -201,7 +452,6 @@ void CBaseFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
 		}
 	}
 
-	GetTextureName( name, sizeof( name ) );
 	// bmp.Increase( hdr->width * 2, hdr->height );
 	// bmp.Increase( hdr->width, hdr->height * 2 );
 	HIMAGE hImage = EngFuncs::PIC_Load( name, bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize, 0 );
@@ -209,17 +459,9 @@ void CBaseFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
 	//delete[] bmp;
 	delete[] temp;
 
-	for( int i = m_glyphs.FirstInorder();; i = m_glyphs.NextInorder( i ) )
-	{
-		if( !m_glyphs[i].texture )
-			m_glyphs[i].texture = hImage;
-		if( i == m_glyphs.LastInorder() )
-			break;
-	}
+	SaveAtlasCache( name, rangesHash, bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize );
 
-	int dotWideA, dotWideB, dotWideC;
-	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
-	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+	return hImage;
 }
 
 
@@ -228,6 +470,175 @@ CBaseFont::~CBaseFont()
 	char name[256];
 	GetTextureName( name, sizeof( name ) );
 	EngFuncs::PIC_Free( name );
+
+	for( int i = 0; i < m_LazyPages.Count(); i++ )
+	{
+		if( m_LazyPages[i].texture )
+		{
+			GetLazyPageName( i, name, sizeof( name ) );
+			EngFuncs::PIC_Free( name );
+		}
+
+		delete m_LazyPages[i].bmp;
+	}
+}
+
+#define LAZY_PAGE_SIZE 256
+#define LAZY_MAX_PAGES 4
+
+void CBaseFont::EnableLazyGlyphs()
+{
+	m_bLazyGlyphs = true;
+
+	// HACKHACK: same 1 pixel gap between rows as in UploadGlyphsForRanges
+	m_iLazyCellW = Q_min( GetMaxCharWidth(), LAZY_PAGE_SIZE );
+	m_iLazyCellH = Q_min( GetHeight() + 1, LAZY_PAGE_SIZE );
+
+	m_iLazyCellsPerRow = LAZY_PAGE_SIZE / Q_max( m_iLazyCellW, 1 );
+	m_iLazyCellsPerPage = m_iLazyCellsPerRow * ( LAZY_PAGE_SIZE / m_iLazyCellH );
+}
+
+void CBaseFont::GetLazyPageName( int page, char *dst, size_t len ) const
+{
+	char name[256];
+
+	GetTextureName( name, sizeof( name ) );
+
+	char *ext = strrchr( name, '.' );
+	if( ext ) *ext = 0;
+
+	snprintf( dst, len, "%s_page%i.bmp", name, page );
+	dst[len - 1] = 0;
+}
+
+/*
+=========================
+CBaseFont::TouchLazyGlyph
+
+Mark glyph as used, rasterizing it if needed. Returns index in m_glyphs
+=========================
+*/
+int CBaseFont::TouchLazyGlyph( int ch )
+{
+	// whitespace and control characters are never drawn
+	if( ch <= ' ' )
+		return m_glyphs.InvalidIndex();
+
+	CBaseFont::glyph_t find( ch );
+	int idx = m_glyphs.Find( find );
+
+	if( !m_glyphs.IsValidIndex( idx ) )
+		return RasterizeLazyGlyph( ch );
+
+	if( m_glyphs[idx].cell >= 0 )
+		m_LazyCells[m_glyphs[idx].cell].lastUsed = ++m_iLazyClock;
+
+	return idx;
+}
+
+/*
+=========================
+CBaseFont::RasterizeLazyGlyph
+
+Render glyph to a free or least recently used cell.
+Page is not uploaded here, so measuring a string and then drawing it costs one upload
+=========================
+*/
+int CBaseFont::RasterizeLazyGlyph( int ch )
+{
+	if( m_iLazyCellsPerPage <= 0 )
+		return m_glyphs.InvalidIndex();
+
+	int cell;
+
+	if( m_LazyCells.Count() < m_iLazyCellsPerPage * LAZY_MAX_PAGES )
+	{
+		cell = m_LazyCells.AddToTail();
+
+		if( cell / m_iLazyCellsPerPage >= m_LazyPages.Count() )
+		{
+			lazyPage_t page;
+			page.bmp = new CBMP( LAZY_PAGE_SIZE, LAZY_PAGE_SIZE );
+			page.texture = 0;
+			page.dirty = true;
+
+			m_LazyPages.AddToTail( page );
+		}
+	}
+	else
+	{
+		cell = 0;
+		for( int i = 1; i < m_LazyCells.Count(); i++ )
+		{
+			if( m_LazyCells[i].lastUsed < m_LazyCells[cell].lastUsed )
+				cell = i;
+		}
+
+		m_glyphs.Remove( glyph_t( m_LazyCells[cell].ch ) );
+	}
+
+	m_LazyCells[cell].ch = ch;
+	m_LazyCells[cell].lastUsed = ++m_iLazyClock;
+
+	lazyPage_t &page = m_LazyPages[cell / m_iLazyCellsPerPage];
+	const int local = cell % m_iLazyCellsPerPage;
+	const int maxWidth = GetMaxCharWidth();
+	const int height = GetHeight();
+	const int tempSize = maxWidth * height * 4;
+
+	bmp_t *hdr = page.bmp->GetBitmapHdr();
+	byte *rgbdata = page.bmp->GetTextureData();
+
+	// texture is reversed by Y coordinates
+	const int xstart = ( local % m_iLazyCellsPerRow ) * m_iLazyCellW;
+	const int ystart = hdr->height - 1 - ( local / m_iLazyCellsPerRow ) * m_iLazyCellH;
+
+	m_LazyScratch.EnsureCount( tempSize );
+	byte *temp = m_LazyScratch.Base();
+	memset( temp, 0, tempSize );
+
+	Size drawSize;
+	GetCharRGBA( ch, Point( 0, 0 ), Size( maxWidth, height ), temp, drawSize );
+	drawSize.w = Q_min( drawSize.w, m_iLazyCellW );
+
+	// evicted glyph could be wider, so clear whole cell
+	for( int y = 0; y < m_iLazyCellH - 1; y++ )
+	{
+		byte *dst = &rgbdata[( ( ystart - y ) * hdr->width + xstart ) * 4];
+
+		if( y < height - 1 )
+		{
+			memcpy( dst, &temp[y * maxWidth * 4], drawSize.w * 4 );
+			memset( dst + drawSize.w * 4, 0, ( m_iLazyCellW - drawSize.w ) * 4 );
+		}
+		else memset( dst, 0, m_iLazyCellW * 4 );
+	}
+
+	glyph_t glyph( ch );
+	glyph.rect.top    = hdr->height - ystart;
+	glyph.rect.bottom = hdr->height - ystart + height;
+	glyph.rect.left   = xstart;
+	glyph.rect.right  = xstart + drawSize.w;
+	glyph.cell = cell;
+
+	page.dirty = true;
+
+	return m_glyphs.Insert( glyph );
+}
+
+void CBaseFont::UploadLazyPage( int page )
+{
+	char name[256];
+	lazyPage_t &p = m_LazyPages[page];
+
+	GetLazyPageName( page, name, sizeof( name ) );
+
+	// engine can't update part of the image, reload it whole
+	if( p.texture )
+		EngFuncs::PIC_Free( name );
+
+	p.texture = EngFuncs::PIC_Load( name, p.bmp->GetBitmap(), p.bmp->GetBitmapHdr()->fileSize, 0 );
+	p.dirty = false;
 }
 
 bool CBaseFont::IsEqualTo(const char *name, int tall, int weight, int blur, int flags)  const
@@ -301,19 +712,40 @@ void CBaseFont::DebugDraw()
 
 }
 
-void CBaseFont::ApplyBlur(Size rgbaSz, byte *rgba)
+/*
+=========================
+CBaseFont::GetBlurKernel
+
+Gaussian taps for the current blur and brighten values, shared between fonts
+=========================
+*/
+struct blurKernel_t
 {
-	if( !m_iBlur )
-		return;
+	int blur;
+	float brighten;
+	int offset; // into blurKernelWeights
+};
 
-	const int size = rgbaSz.w * rgbaSz.h * 4;
-	byte *src = new byte[size];
-	double sigma2;
-	memcpy( src, rgba, size );
+static CUtlVector<blurKernel_t> blurKernels;
+static CUtlVector<float> blurKernelWeights;
 
-	sigma2 = 0.5 * m_iBlur;
+int CBaseFont::GetBlurKernel()
+{
+	for( int i = 0; i < blurKernels.Count(); i++ )
+	{
+		if( blurKernels[i].blur == m_iBlur && blurKernels[i].brighten == m_fBrighten )
+			return blurKernels[i].offset;
+	}
+
+	blurKernel_t kernel;
+	kernel.blur = m_iBlur;
+	kernel.brighten = m_fBrighten;
+	kernel.offset = blurKernelWeights.AddMultipleToTail( m_iBlur * 2 + 1 );
+
+	double sigma2 = 0.5 * m_iBlur;
 	sigma2 *= sigma2;
-	float * distribution = new float[m_iBlur * 2 + 1];
+
+	float *distribution = &blurKernelWeights[kernel.offset];
 	for( int x = 0; x <= m_iBlur * 2; x++ )
 	{
 		int val = x - m_iBlur;
@@ -323,86 +755,149 @@ void CBaseFont::ApplyBlur(Size rgbaSz, byte *rgba)
 		distribution[x] *= m_fBrighten;
 	}
 
+	blurKernels.AddToTail( kernel );
 
-	for( int y = 0; y < rgbaSz.h; y++ )
+	return kernel.offset;
+}
+
+/*
+=========================
+CBaseFont::ApplyBlur
+
+Gaussian is separable, so blur rows into a scratch buffer first, then columns.
+Taps cover [-blur, blur) on both axes, as the old 2D convolution did
+=========================
+*/
+void CBaseFont::ApplyBlur(Size rgbaSz, byte *rgba)
+{
+	if( !m_iBlur )
+		return;
+
+	const int w = rgbaSz.w, h = rgbaSz.h;
+	const float *distribution = &blurKernelWeights[GetBlurKernel()] + m_iBlur;
+
+	m_BlurScratch.EnsureCount( w * h );
+	float *temp = m_BlurScratch.Base();
+
+	// horizontal pass, alpha only
+	for( int y = 0; y < h; y++ )
 	{
-		for( int x = 0; x < rgbaSz.w; x++ )
+		const byte *src = &rgba[y * w * 4 + 3];
+		float *dst = &temp[y * w];
+
+		for( int x = 0; x < w; x++ )
 		{
-			GetBlurValueForPixel( distribution, src, Point(x, y), rgbaSz, rgba );
+			int minX = Q_max( x - m_iBlur, 0 );
+			int maxX = Q_min( x + m_iBlur, w );
+			float accum = 0.0f;
+
+			for( int i = minX; i < maxX; i++ )
+				accum += src[i * 4] * distribution[i - x];
 
-			rgba += 4;
+			dst[x] = accum;
 		}
 	}
 
-	delete[] distribution;
-	delete[] src;
-}
-
-void CBaseFont::GetBlurValueForPixel(float *distribution, byte *src, Point srcPt, Size srcSz, byte *dest)
-{
-	float accum = 0.0f;
-
-	// scan the positive x direction
-	int maxX = Q_min( srcPt.x + m_iBlur, srcSz.w );
-	int minX = Q_max( srcPt.x - m_iBlur, 0 );
-	for( int x = minX; x < maxX; x++ )
+	// vertical pass, all the values are the same for fonts, just use the calculated alpha
+	for( int y = 0; y < h; y++ )
 	{
-		int maxY = Q_min( srcPt.y + m_iBlur, srcSz.h );
-		int minY = Q_max( srcPt.y - m_iBlur, 0);
-		for (int y = minY; y < maxY; y++)
+		int minY = Q_max( y - m_iBlur, 0 );
+		int maxY = Q_min( y + m_iBlur, h );
+		byte *dst = &rgba[y * w * 4];
+
+		for( int x = 0; x < w; x++, dst += 4 )
 		{
-			byte *srcPos = src + ((x + (y * srcSz.w)) * 4);
+			float accum = 0.0f;
+
+			for( int i = minY; i < maxY; i++ )
+				accum += temp[i * w + x] * distribution[i - y];
 
-			// muliply by the value matrix
-			float weight = distribution[(x - srcPt.x) + m_iBlur];
-			float weight2 = distribution[(y - srcPt.y) + m_iBlur];
-			accum += ( srcPos[3] ) * (weight * weight2);
+			dst[0] = dst[1] = dst[2] = 255;
+			dst[3] = Q_min( (int)(accum + 0.5f), 255 );
 		}
 	}
-
-	// all the values are the same for fonts, just use the calculated alpha
-	dest[0] = dest[1] = dest[2] = 255;
-	dest[3] = Q_min( (int)(accum + 0.5f), 255);
 }
 
+/*
+=========================
+CBaseFont::ApplyOutline
+
+Fill transparent pixels that are within m_iOutlineSize (chessboard distance) of the glyph.
+Row pass stores the horizontal distance to the nearest glyph pixel,
+column pass counts rows in reach with a sliding window
+=========================
+*/
 void CBaseFont::ApplyOutline(Point pt, Size rgbaSz, byte *rgba)
 {
 	if( !m_iOutlineSize )
 		return;
 
-	int x, y;
+	const int w = rgbaSz.w, h = rgbaSz.h;
+	const int maxDist = Q_min( m_iOutlineSize + 1, 255 );
 
-	for( y = pt.x; y < rgbaSz.h; y++ )
+	m_OutlineScratch.EnsureCount( w * h );
+	byte *dist = m_OutlineScratch.Base();
+
+	for( int y = 0; y < h; y++ )
 	{
-		for( x = pt.y; x < rgbaSz.w; x++ )
+		const byte *src = &rgba[y * w * 4];
+		byte *row = &dist[y * w];
+		int d = maxDist;
+
+		// outline pixels are black, so they never grow the outline further
+		for( int x = 0; x < w; x++ )
 		{
-			byte *src = &rgba[(x + (y * rgbaSz.w)) * 4];
+			const byte *test = &src[x * 4];
 
-			if( src[3] != 0 )
-				continue;
+			if( test[0] != 0 && test[1] != 0 && test[3] != 0 )
+				d = 0;
+			else if( d < maxDist )
+				d++;
 
-			int shadowX, shadowY;
+			row[x] = d;
+		}
 
-			for( shadowX = -m_iOutlineSize; shadowX <= m_iOutlineSize; shadowX++ )
-			{
-				for( shadowY = -m_iOutlineSize; shadowY <= m_iOutlineSize; shadowY++ )
-				{
-					if( !shadowX && !shadowY )
-						continue;
+		d = maxDist;
+		for( int x = w - 1; x >= 0; x-- )
+		{
+			if( row[x] == 0 )
+				d = 0;
+			else if( d < maxDist )
+				d++;
 
-					int testX = shadowX + x, testY = shadowY + y;
-					if( testX < 0 || testX >= rgbaSz.w ||
-						testY < 0 || testY >= rgbaSz.h )
-						continue;
+			if( d < row[x] )
+				row[x] = d;
+		}
+	}
 
-					byte *test = &rgba[(testX + (testY * rgbaSz.w)) * 4];
-					if( test[0] == 0 || test[1] == 0 || test[3] == 0 )
-						continue;
+	for( int x = pt.y; x < w; x++ )
+	{
+		int inReach = 0;
 
-					src[0] = src[1] = src[2] = 0;
-					src[3] = -1;
-				}
-			}
+		// prime the window, the first step drops the row above it
+		for( int y = Q_max( pt.x - m_iOutlineSize - 1, 0 ); y < Q_min( pt.x + m_iOutlineSize, h ); y++ )
+		{
+			if( dist[y * w + x] <= m_iOutlineSize )
+				inReach++;
+		}
+
+		for( int y = pt.x; y < h; y++ )
+		{
+			int enter = y + m_iOutlineSize;
+			int leave = y - m_iOutlineSize - 1;
+
+			if( enter < h && dist[enter * w + x] <= m_iOutlineSize )
+				inReach++;
+			if( leave >= 0 && dist[leave * w + x] <= m_iOutlineSize )
+				inReach--;
+
+			byte *src = &rgba[(x + (y * w)) * 4];
+
+			if( src[3] != 0 || !inReach )
+				continue;
+
+			src[0] = src[1] = src[2] = 0;
+			src[3] = -1;
 		}
 	}
 }
@@ -470,13 +965,32 @@ int CBaseFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int col
 		}
 	}
 
-	CBaseFont::glyph_t find( ch );
-	int idx = m_glyphs.Find( find );
+	int idx;
+
+	if( m_bLazyGlyphs )
+	{
+		idx = TouchLazyGlyph( ch );
+	}
+	else
+	{
+		CBaseFont::glyph_t find( ch );
+		idx = m_glyphs.Find( find );
+	}
 
 	if( m_glyphs.IsValidIndex( idx ) )
 	{
 		CBaseFont::glyph_t &glyph = m_glyphs[idx];
 
+		if( glyph.cell >= 0 )
+		{
+			const int page = glyph.cell / m_iLazyCellsPerPage;
+
+			if( m_LazyPages[page].dirty )
+				UploadLazyPage( page );
+
+			glyph.texture = m_LazyPages[page].texture;
+		}
+
 		int r, g, b, alpha;
 
 		UnpackRGBA(r, g, b, alpha, color );
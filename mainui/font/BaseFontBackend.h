@@ -25,6 +25,8 @@ GNU General Public License for more details.
 #define SCALE_FONTS
 #endif
 
+struct fontcache_t;
+
 struct charRange_t
 {
 	int chMin;
@@ -52,6 +54,10 @@ public:
 	virtual void UploadGlyphsForRanges( charRange_t *range, int rangeSize );
 	virtual int DrawCharacter(int ch, Point pt, int charH, const unsigned int color, bool forceAdditive = false);
 
+	// rasterize glyphs outside of uploaded ranges on first use, see RasterizeLazyGlyph
+	void EnableLazyGlyphs();
+	inline void PrepareGlyph( int ch ) { if( m_bLazyGlyphs ) TouchLazyGlyph( ch ); }
+
 	inline int GetHeight() const       { return m_iHeight + GetEfxOffset(); }
 	inline int GetTall() const         { return m_iTall; }
 	inline const char *GetName() const { return m_szName; }
@@ -78,6 +84,9 @@ protected:
 	void ApplyScanline( Size rgbaSz, byte *rgba );
 	void ApplyStrikeout( Size rgbaSz, byte *rgba );
 
+	// backends call this with the file they load glyphs from to enable atlas cache
+	void SetFontFile( const char *path );
+
 	char m_szName[32];
 	int	 m_iTall, m_iWeight, m_iFlags, m_iHeight, m_iMaxCharWidth;
 	int  m_iAscent;
@@ -95,16 +104,31 @@ protected:
 	int  m_iOutlineSize;
 	int m_iEllipsisWide;
 
+	unsigned int m_iFontFileHash;
+
 private:
-	void GetBlurValueForPixel(float *distribution, byte *src, Point srcPt, Size srcSz, byte *dest);
+	HIMAGE RasterizeGlyphs( const char *name, charRange_t *range, int rangeSize, unsigned int rangesHash );
+
+	// on-disk copy of the packed atlas, skips rasterization on next launches
+	void FillAtlasCacheHeader( fontcache_t *hdr, unsigned int rangesHash ) const;
+	void GetAtlasCachePath( const char *textureName, char *dst, size_t len ) const;
+	HIMAGE LoadAtlasCache( const char *textureName, unsigned int rangesHash );
+	void SaveAtlasCache( const char *textureName, unsigned int rangesHash, const byte *bitmap, int bitmapSize );
+
+	int GetBlurKernel();
+
+	// reused between glyphs, so effects don't allocate per character
+	CUtlVector<float> m_BlurScratch;
+	CUtlVector<byte> m_OutlineScratch;
 
 	struct glyph_t
 	{
-		glyph_t() : ch( 0 ), texture( 0 ), rect() { }
-		glyph_t( int ch ) : ch( ch ), texture( 0 ), rect() { }
+		glyph_t() : ch( 0 ), texture( 0 ), rect(), cell( -1 ) { }
+		glyph_t( int ch ) : ch( ch ), texture( 0 ), rect(), cell( -1 ) { }
 		int ch;
 		HIMAGE texture;
 		wrect_t rect;
+		int cell; // lazy atlas cell, -1 if glyph is in the main atlas
 
 		bool operator< (const glyph_t &a) const
 		{
@@ -113,6 +137,35 @@ private:
 	};
 
 	CUtlRBTree<glyph_t, int> m_glyphs;
+
+	// lazy glyphs live in fixed size cells of a few atlas pages,
+	// least recently used cell is reused when all pages are full
+	struct lazyPage_t
+	{
+		CBMP *bmp;
+		HIMAGE texture;
+		bool dirty; // needs reupload before drawing
+	};
+
+	struct lazyCell_t
+	{
+		int ch; // 0 if free
+		unsigned int lastUsed;
+	};
+
+	void GetLazyPageName( int page, char *dst, size_t len ) const;
+	int  TouchLazyGlyph( int ch );
+	int  RasterizeLazyGlyph( int ch );
+	void UploadLazyPage( int page );
+
+	bool m_bLazyGlyphs;
+	int  m_iLazyCellW, m_iLazyCellH;
+	int  m_iLazyCellsPerRow, m_iLazyCellsPerPage;
+	unsigned int m_iLazyClock;
+	CUtlVector<lazyPage_t> m_LazyPages;
+	CUtlVector<lazyCell_t> m_LazyCells;
+	CUtlVector<byte> m_LazyScratch;
+
 	friend class CFontManager;
 };
 
@@ -18,6 +18,7 @@ GNU General Public License for more details.
 #include "Utils.h"
 
 #include "BaseFontBackend.h"
+#include "generichash.h"
 
 #if defined(MAINUI_USE_FREETYPE)
 #include "FreeTypeFont.h"
@@ -47,6 +48,8 @@ CFontManager::CFontManager()
 	FT_Init_FreeType( &CFreeTypeFont::m_Library );
 #endif
 	m_Fonts.EnsureCapacity( 4 );
+	m_iTextLayoutClock = 0;
+	FlushTextLayouts();
 }
 
 CFontManager::~CFontManager()
@@ -109,6 +112,7 @@ void CFontManager::DeleteAllFonts()
 		delete m_Fonts[i];
 	}
 	m_Fonts.RemoveAll();
+	FlushTextLayouts();
 }
 
 void CFontManager::DeleteFont(HFont hFont)
@@ -119,6 +123,7 @@ void CFontManager::DeleteFont(HFont hFont)
 		m_Fonts[hFont] = NULL;
 
 		delete font;
+		FlushTextLayouts();
 	}
 }
 
@@ -141,7 +146,11 @@ void CFontManager::GetCharABCWide(HFont font, int ch, int &a, int &b, int &c)
 {
 	CBaseFont *pFont = GetIFontFromHandle( font );
 	if( pFont )
+	{
+		// text is measured before it's drawn, so glyphs are ready in one page upload
+		pFont->PrepareGlyph( ch );
 		pFont->GetCharABCWidths( ch, a, b, c );
+	}
 	else
 		a = b = c = 0;
 }
@@ -207,6 +216,16 @@ void CFontManager::GetTextSize(HFont fontHandle, const char *text, int *wide, in
 		return;
 	}
 
+	bool found;
+	textLayout_t *layout = FindTextLayout( TEXTLAYOUT_SIZE, fontHandle, text, size, 0, 0, found );
+
+	if( found )
+	{
+		if( wide ) *wide = layout->wide;
+		if( tall ) *tall = layout->tall;
+		return;
+	}
+
 	int fontTall = font->GetHeight(), x = 0;
 	int _wide = 0, _tall;
 	const char *ch = text;
@@ -248,6 +267,9 @@ void CFontManager::GetTextSize(HFont fontHandle, const char *text, int *wide, in
 	}
 	EngFuncs::UtfProcessChar( 0 );
 
+	layout->wide = _wide;
+	layout->tall = _tall;
+
 	if( tall ) *tall = _tall;
 	if( wide ) *wide = _wide;
 }
@@ -407,6 +429,12 @@ int CFontManager::GetTextHeightExt( HFont fontHandle, const char *text, int heig
 		return 0;
 	}
 
+	bool found;
+	textLayout_t *layout = FindTextLayout( TEXTLAYOUT_HEIGHT, fontHandle, text, height, w, size, found );
+
+	if( found )
+		return layout->tall;
+
 	const char *text2 = text;
 	int y = 0;
 
@@ -420,6 +448,8 @@ int CFontManager::GetTextHeightExt( HFont fontHandle, const char *text, int heig
 		text2 += pos;
 	}
 
+	layout->tall = y;
+
 	return y;
 
 }
@@ -451,9 +481,246 @@ void CFontManager::UploadTextureForFont(CBaseFont *font)
 	{ 0x0400, 0x045F, NULL, 0 },		// cyrillic range
 	};
 
+	// everything beyond ascii is rendered on demand
+	if( ui_fontlazy && ui_fontlazy->value )
+	{
+		font->EnableLazyGlyphs();
+		font->UploadGlyphsForRanges( range, 1 );
+		return;
+	}
+
 	font->UploadGlyphsForRanges( range, ARRAYSIZE( range ) );
 }
 
+void CFontManager::FlushTextLayouts()
+{
+	for( int i = 0; i < TEXTLAYOUT_CACHE_SETS * TEXTLAYOUT_CACHE_WAYS; i++ )
+	{
+		m_TextLayouts[i].kind = TEXTLAYOUT_FREE;
+		m_TextLayouts[i].lastUsed = 0;
+	}
+}
+
+/*
+=========================
+CFontManager::FindTextLayout
+
+Returns cached entry, or prepares the least recently used one in the set for the caller to fill
+=========================
+*/
+textLayout_t *CFontManager::FindTextLayout( int kind, HFont font, const char *text, int param0, int param1, int param2, bool &found )
+{
+	const unsigned int hash = HashString( text, strlen( text ));
+	const unsigned int key = hash + kind * 0x9E3779B9 + font * 7919 + param0 * 131 + param1 * 31 + param2;
+	textLayout_t *set = &m_TextLayouts[( key % TEXTLAYOUT_CACHE_SETS ) * TEXTLAYOUT_CACHE_WAYS];
+	textLayout_t *victim = set;
+
+	m_iTextLayoutClock++;
+
+	for( int i = 0; i < TEXTLAYOUT_CACHE_WAYS; i++ )
+	{
+		textLayout_t *layout = &set[i];
+
+		if( layout->kind == kind && layout->font == font && layout->hash == hash &&
+			layout->param[0] == param0 && layout->param[1] == param1 && layout->param[2] == param2 &&
+			!strcmp( layout->text.String(), text ))
+		{
+			layout->lastUsed = m_iTextLayoutClock;
+			found = true;
+			return layout;
+		}
+
+		if( layout->lastUsed < victim->lastUsed )
+			victim = layout;
+	}
+
+	victim->kind = kind;
+	victim->font = font;
+	victim->hash = hash;
+	victim->param[0] = param0;
+	victim->param[1] = param1;
+	victim->param[2] = param2;
+	victim->text.Set( text );
+	victim->lastUsed = m_iTextLayoutClock;
+
+	found = false;
+	return victim;
+}
+
+const textLayout_t *CFontManager::GetTextLayout( HFont font, const char *text, int w, int h, int charH, uint flags )
+{
+	// only these affect line breaks, see BuildTextLayout
+	const int multiline = h > charH;
+	const int noSizeLimit = ( flags & ETF_NOSIZELIMIT ) ? 1 : 0;
+
+	bool found;
+	textLayout_t *layout = FindTextLayout( TEXTLAYOUT_DRAW, font, text, w, charH, multiline | noSizeLimit << 1, found );
+
+	if( !found )
+	{
+		BuildTextLayout( layout, font, text, w, h, charH, flags );
+	}
+	else
+	{
+		// building measures the text, which prepares its glyphs; a cached layout
+		// has to do the same or evicted glyphs cost a page upload each when drawn
+		CBaseFont *pFont = GetIFontFromHandle( font );
+
+		if( pFont )
+		{
+			for( int i = 0; i < layout->glyphs.Count(); i++ )
+			{
+				if( layout->glyphs[i] >= 0 )
+					pFont->PrepareGlyph( layout->glyphs[i] );
+			}
+		}
+	}
+
+	return layout;
+}
+
+/*
+=========================
+CFontManager::BuildTextLayout
+
+Word wrapping and ellipsis logic of UI_DrawString
+=========================
+*/
+void CFontManager::BuildTextLayout( textLayout_t *layout, HFont font, const char *string, int w, int h, int charH, uint flags )
+{
+	// this was "yy < (yy + h) - charH" for each line, which never changes
+	const bool multiline = h > charH;
+	const int maxLen = 1024 - 1; // UI_DrawString used to copy lines to fixed buffer
+	int ellipsisWide = GetEllipsisWide( font );
+	bool giveup = false;
+	int i = 0;
+
+	layout->lines.RemoveAll();
+	layout->glyphs.RemoveAll();
+
+	while( string[i] && !giveup )
+	{
+		textLine_t line;
+		int j = i, len = 0;
+		int pixelWide = 0;
+		int save_pixelWide = 0;
+		int save_j = 0;
+		int save_glyphs = 0;
+
+		line.firstGlyph = layout->glyphs.Count();
+
+		EngFuncs::UtfProcessChar( 0 );
+		while( string[j] )
+		{
+			if( string[j] == '\n' )
+			{
+				j++;
+				break;
+			}
+
+			if( len >= maxLen )
+				break;
+
+			int uch = EngFuncs::UtfProcessChar( ( unsigned char )string[j] );
+
+			if( IsColorString( string + j )) // don't calc wides for colorstrings
+			{
+				layout->glyphs.AddToTail( TEXTLAYOUT_COLOR( ColorIndex( string[j+1] )));
+				len += 2;
+				j += 2;
+			}
+			else if( !uch ) // don't calc wides for invalid codepoints
+			{
+				len++;
+				j++;
+			}
+			else
+			{
+				int charWide;
+
+				// does we have free space for new line?
+				if( multiline )
+				{
+					if( uch == ' ' && pixelWide < w ) // remember last whitespace
+					{
+						save_pixelWide = pixelWide;
+						save_j = j;
+						save_glyphs = layout->glyphs.Count();
+					}
+				}
+				else
+				{
+					// remember last position, when we still fit
+					if( pixelWide + ellipsisWide < w && j > 0 )
+					{
+						save_pixelWide = pixelWide;
+						save_j = j;
+						save_glyphs = layout->glyphs.Count();
+					}
+				}
+
+				charWide = GetCharacterWidthScaled( font, uch, charH );
+
+				if( !(flags & ETF_NOSIZELIMIT) && pixelWide + charWide > w )
+				{
+					if( save_j != 0 && save_pixelWide != 0 )
+					{
+						pixelWide = save_pixelWide;
+						len -= j - save_j;
+						layout->glyphs.RemoveMultipleFromTail( layout->glyphs.Count() - save_glyphs );
+					}
+
+					// do we have free space for new line?
+					if( multiline )
+					{
+						// try to word wrap, skip whitespace
+						if( save_j != 0 && save_pixelWide != 0 )
+							j = save_j + 1;
+					}
+					else
+					{
+						if( save_j != 0 && save_pixelWide != 0 )
+						{
+							j = save_j;
+
+							if( len > 0 )
+							{
+								layout->glyphs.AddToTail( '.' );
+								layout->glyphs.AddToTail( '.' );
+								layout->glyphs.AddToTail( '.' );
+							}
+						}
+
+						// we don't have free space anymore, so just stop drawing
+						giveup = true;
+					}
+
+					break;
+				}
+				else
+				{
+					layout->glyphs.AddToTail( uch );
+					pixelWide += charWide;
+					j++;
+					len++;
+				}
+			}
+		}
+
+		line.numGlyphs = layout->glyphs.Count() - line.firstGlyph;
+		line.pixelWide = pixelWide;
+		layout->lines.AddToTail( line );
+
+		// first character is wider than the box, it would never fit
+		if( j == i )
+			giveup = true;
+
+		i = j;
+	}
+
+	EngFuncs::UtfProcessChar( 0 );
+}
+
 int CFontManager::DrawCharacter(HFont fontHandle, int ch, Point pt, int charH, const unsigned int color, bool forceAdditive )
 {
 	CBaseFont *font = GetIFontFromHandle( fontHandle );
@@ -17,11 +17,56 @@ GNU General Public License for more details.
 #define FONTMANAGER_H
 
 #include "utlvector.h"
+#include "utlstring.h"
 #include "Primitive.h"
 #include "FontRenderer.h"
 
 class CBaseFont;
 
+#define TEXTLAYOUT_CACHE_SETS 128
+#define TEXTLAYOUT_CACHE_WAYS 4 // entries checked per lookup
+
+enum ETextLayoutKind
+{
+	TEXTLAYOUT_FREE = 0,
+	TEXTLAYOUT_DRAW,        // UI_DrawString lines
+	TEXTLAYOUT_SIZE,        // GetTextSize
+	TEXTLAYOUT_HEIGHT       // GetTextHeightExt
+};
+
+struct textLine_t
+{
+	int firstGlyph;
+	int numGlyphs;
+	int pixelWide;
+};
+
+// glyph runs store codepoints, color codes are stored as TEXTLAYOUT_COLOR( colorNum )
+#define TEXTLAYOUT_COLOR( x )     ( -1 - ( x ))
+#define TEXTLAYOUT_COLORNUM( x )  ( -1 - ( x ))
+
+/*
+ * Result of measuring or word wrapping a string, so static text is only walked once
+ **/
+struct textLayout_t
+{
+	// key
+	int kind;
+	HFont font;
+	unsigned int hash;
+	int param[3];
+	CUtlString text;
+
+	unsigned int lastUsed;
+
+	// TEXTLAYOUT_DRAW
+	CUtlVector<textLine_t> lines;
+	CUtlVector<int> glyphs;
+
+	// TEXTLAYOUT_SIZE and TEXTLAYOUT_HEIGHT
+	int wide, tall;
+};
+
 /*
  * Font manager is used for creating and operating with fonts
  **/
@@ -67,7 +112,14 @@ public:
 	CBaseFont *GetIFontFromHandle( HFont font );
 
 	int GetEllipsisWide( HFont font ); // cached wide of "..."
+
+	// word wrapped lines for UI_DrawString, valid until next call
+	const textLayout_t *GetTextLayout( HFont font, const char *text, int w, int h, int charH, uint flags );
+	void FlushTextLayouts();
 private:
+	textLayout_t *FindTextLayout( int kind, HFont font, const char *text, int param0, int param1, int param2, bool &found );
+	void BuildTextLayout( textLayout_t *layout, HFont font, const char *text, int w, int h, int charH, uint flags );
+
 	int  GetCharacterWidth( HFont font, int ch );
 	int  GetTextWide( HFont font, const char *text, int size = -1 );
 
@@ -75,6 +127,9 @@ private:
 
 	CUtlVector<CBaseFont*> m_Fonts;
 
+	textLayout_t m_TextLayouts[TEXTLAYOUT_CACHE_SETS * TEXTLAYOUT_CACHE_WAYS];
+	unsigned int m_iTextLayoutClock;
+
 	friend class CFontBuilder;
 };
 
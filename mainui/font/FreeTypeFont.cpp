@@ -148,6 +148,8 @@ bool CFreeTypeFont::Create(const char *name, int tall, int weight, int blur, flo
 		return false;
 	}
 
+	SetFontFile( m_szRealFontFile );
+
 	if( FT_New_Face( m_Library, m_szRealFontFile, 0, &face ))
 	{
 		return false;
@@ -255,6 +255,8 @@ bool CStbFont::Create(const char *name, int tall, int weight, int blur, float br
 		return false;
 	}
 
+	SetFontFile( m_szRealFontFile );
+
 
 	// EngFuncs::COM_LoadFile does not allow open files from /
 	FILE *fd = fopen( m_szRealFontFile, "r" );
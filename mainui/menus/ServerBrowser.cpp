@@ -25,23 +25,45 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Switch.h"
 #include "Field.h"
 #include "utlvector.h"
+#include "utlhashmap.h"
 
 #define ART_BANNER_INET		"gfx/shell/head_inetgames"
 #define ART_BANNER_LAN		"gfx/shell/head_lan"
 #define ART_BANNER_LOCK		"gfx/shell/lock"
 #define ART_BANNER_DEDICATE "gfx/shell/dedicated"
 
+// info keys the browser reads, interned so CInfoIndex lookups are pointer compares
+static const char *k_gamedir = Info_InternKey( "gamedir" );
+static const char *k_host = Info_InternKey( "host" );
+static const char *k_map = Info_InternKey( "map" );
+static const char *k_numcl = Info_InternKey( "numcl" );
+static const char *k_maxcl = Info_InternKey( "maxcl" );
+static const char *k_password = Info_InternKey( "password" );
+static const char *k_dedicated = Info_InternKey( "dedicated" );
+static const char *k_bots = Info_InternKey( "bots" );
+static const char *k_secure = Info_InternKey( "secure" );
+static const char *k_version = Info_InternKey( "version" );
+static const char *k_protocol = Info_InternKey( "p" );
+static const char *k_region = Info_InternKey( "region" );
+
 struct server_t
 {
 	netadr_t adr;
 	char info[256];
+	CInfoIndex fields;
 	float ping;
 	char name[64];
 	char mapname[64];
 	char clientsstr[64];
 	char pingstr[64];
+	char botsstr[8];
+	char version[32];
+	int numcl;
+	int bots;
+	int region;			// -1 if not reported
 	bool havePassword;
 	bool IsDedicated;
+	bool IsSecure;
 
 	static int NameCmpAscend( const void *_a, const void *_b )
 	{
@@ -70,11 +92,8 @@ struct server_t
 		const server_t *a = (const server_t*)_a;
 		const server_t *b = (const server_t*)_b;
 
-		int a_cl = atoi( Info_ValueForKey( a->info, "numcl" ));
-		int b_cl = atoi( Info_ValueForKey( b->info, "numcl" ));
-
-		if( a_cl > b_cl ) return 1;
-		else if( a_cl < b_cl ) return -1;
+		if( a->numcl > b->numcl ) return 1;
+		else if( a->numcl < b->numcl ) return -1;
 		return 0;
 	}
 	static int ClientCmpDescend( const void *a, const void *b )
@@ -95,6 +114,63 @@ struct server_t
 	{
 		return PingCmpAscend( b, a );
 	}
+
+	static int BotsCmpAscend( const void *_a, const void *_b )
+	{
+		const server_t *a = (const server_t*)_a;
+		const server_t *b = (const server_t*)_b;
+
+		if( a->bots > b->bots ) return 1;
+		else if( a->bots < b->bots ) return -1;
+		return 0;
+	}
+	static int BotsCmpDescend( const void *a, const void *b )
+	{
+		return BotsCmpAscend( b, a );
+	}
+
+	static int SecureCmpAscend( const void *_a, const void *_b )
+	{
+		const server_t *a = (const server_t*)_a;
+		const server_t *b = (const server_t*)_b;
+		return (int)a->IsSecure - (int)b->IsSecure;
+	}
+	static int SecureCmpDescend( const void *a, const void *b )
+	{
+		return SecureCmpAscend( b, a );
+	}
+
+	static int VersionCmpAscend( const void *_a, const void *_b )
+	{
+		const server_t *a = (const server_t*)_a;
+		const server_t *b = (const server_t*)_b;
+		return stricmp( a->version, b->version );
+	}
+	static int VersionCmpDescend( const void *a, const void *b )
+	{
+		return VersionCmpAscend( b, a );
+	}
+
+	static int RegionCmpAscend( const void *_a, const void *_b )
+	{
+		const server_t *a = (const server_t*)_a;
+		const server_t *b = (const server_t*)_b;
+
+		if( a->region > b->region ) return 1;
+		else if( a->region < b->region ) return -1;
+		return 0;
+	}
+	static int RegionCmpDescend( const void *a, const void *b )
+	{
+		return RegionCmpAscend( b, a );
+	}
+
+	// servers answering from the same address are the same server
+	static uint64 AddressKey( const netadr_t &adr )
+	{
+		return ((uint64)adr.type << 48) | ((uint64)adr.ip[0] << 40) | ((uint64)adr.ip[1] << 32)
+			| ((uint64)adr.ip[2] << 24) | ((uint64)adr.ip[3] << 16) | adr.port;
+	}
 };
 
 class CMenuGameListModel : public CMenuBaseModel
@@ -105,11 +181,11 @@ public:
 	void Update() override;
 	int GetColumns() const override
 	{
-		return 6; // IsDedicated, havePassword, game, mapname, maxcl, ping
+		return 10; // IsDedicated, havePassword, game, mapname, maxcl, ping, bots, secure, version, region
 	}
 	int GetRows() const override
 	{
-		return servers.Count();
+		return order.Count();
 	}
 	ECellType GetCellType( int line, int column ) override
 	{
@@ -119,14 +195,20 @@ public:
 	}
 	const char *GetCellText( int line, int column ) override
 	{
+		const server_t &server = Server( line );
+
 		switch( column )
 		{
-		case 0: return servers[line].IsDedicated ? ART_BANNER_DEDICATE : NULL;
-		case 1: return servers[line].havePassword ? ART_BANNER_LOCK : NULL;
-		case 2: return servers[line].name;
-		case 3: return servers[line].mapname;
-		case 4: return servers[line].clientsstr;
-		case 5: return servers[line].pingstr;
+		case 0: return server.IsDedicated ? ART_BANNER_DEDICATE : NULL;
+		case 1: return server.havePassword ? ART_BANNER_LOCK : NULL;
+		case 2: return server.name;
+		case 3: return server.mapname;
+		case 4: return server.clientsstr;
+		case 5: return server.pingstr;
+		case 6: return server.botsstr;
+		case 7: return server.IsSecure ? "VAC" : NULL;
+		case 8: return server.version;
+		case 9: return RegionName( server.region );
 		default: return NULL;
 		}
 	}
@@ -151,25 +233,53 @@ public:
 	void Flush()
 	{
 		servers.RemoveAll();
+		order.RemoveAll();
+		serverIndex.RemoveAll();
 		serversRefreshTime = gpGlobals->time;
 	}
 
+	server_t &Server( int line )
+	{
+		return servers[order[line]];
+	}
+
+	const server_t &Server( int line ) const
+	{
+		return servers[order[line]];
+	}
+
 	bool IsHavePassword( int line )
 	{
-		return servers[line].havePassword;
+		return Server( line ).havePassword;
 	}
 
-	void AddServerToList( netadr_t adr, const char *info );
+	int AddServerToList( netadr_t adr, const char *info, const CInfoIndex &fields, int *oldRow );
 
 	bool Sort(int column, bool ascend) override;
 
 	float serversRefreshTime;
-	CUtlVector<server_t> servers;
+	CUtlVector<server_t> servers;	// in order of arrival, never reordered
+	CUtlVector<int> order;			// table rows, indices into servers
+	CUtlHashMap<uint64, int> serverIndex; // address key to index into servers
 private:
+	typedef int (*pfnServerCmp)( const void *a, const void *b );
+
+	pfnServerCmp GetSortFunc() const;
+	int CompareRows( int a, int b ) const;
+	int FindSortedRow( int idx ) const;
+	void UpdateServerFields( server_t &server );
+
+	static const char *RegionName( int region );
+
+	static int RowCmp( const void *a, const void *b );
+	static const CMenuGameListModel *s_pSortModel;
+
 	int m_iSortingColumn;
 	bool m_bAscend;
 };
 
+const CMenuGameListModel *CMenuGameListModel::s_pSortModel;
+
 class CMenuServerBrowser: public CMenuFramework
 {
 public:
@@ -223,6 +333,55 @@ static bool staticWaitingPassword = false;
 
 static CMenuServerBrowser	uiServerBrowser;
 
+CMenuGameListModel::pfnServerCmp CMenuGameListModel::GetSortFunc() const
+{
+	switch( m_iSortingColumn )
+	{
+	case 2: return m_bAscend ? server_t::NameCmpAscend : server_t::NameCmpDescend;
+	case 3: return m_bAscend ? server_t::MapCmpAscend : server_t::MapCmpDescend;
+	case 4: return m_bAscend ? server_t::ClientCmpAscend : server_t::ClientCmpDescend;
+	case 5: return m_bAscend ? server_t::PingCmpAscend : server_t::PingCmpDescend;
+	case 6: return m_bAscend ? server_t::BotsCmpAscend : server_t::BotsCmpDescend;
+	case 7: return m_bAscend ? server_t::SecureCmpAscend : server_t::SecureCmpDescend;
+	case 8: return m_bAscend ? server_t::VersionCmpAscend : server_t::VersionCmpDescend;
+	case 9: return m_bAscend ? server_t::RegionCmpAscend : server_t::RegionCmpDescend;
+	}
+
+	return NULL;
+}
+
+// ties are broken by arrival order, so rows don't swap places on every update
+int CMenuGameListModel::CompareRows( int a, int b ) const
+{
+	pfnServerCmp cmp = GetSortFunc();
+	int result = cmp ? cmp( &servers[a], &servers[b] ) : 0;
+
+	return result ? result : a - b;
+}
+
+int CMenuGameListModel::RowCmp( const void *a, const void *b )
+{
+	return s_pSortModel->CompareRows( *(const int *)a, *(const int *)b );
+}
+
+// binary search for the row where servers[idx] belongs
+int CMenuGameListModel::FindSortedRow( int idx ) const
+{
+	int lo = 0, hi = order.Count();
+
+	while( lo < hi )
+	{
+		int mid = ( lo + hi ) / 2;
+
+		if( CompareRows( order[mid], idx ) < 0 )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
 bool CMenuGameListModel::Sort(int column, bool ascend)
 {
 	m_iSortingColumn = column;
@@ -230,30 +389,15 @@ bool CMenuGameListModel::Sort(int column, bool ascend)
 		return false; // disabled
 
 	m_bAscend = ascend;
-	switch( column )
-	{
-	case 0: // is dedicated
-	case 1: // has password
+
+	if( !GetSortFunc() )
 		return false;
-	case 2:
-		qsort( servers.Base(), servers.Count(), sizeof( server_t ),
-			ascend ? server_t::NameCmpAscend : server_t::NameCmpDescend );
-		return true;
-	case 3:
-		qsort( servers.Base(), servers.Count(), sizeof( server_t ),
-			ascend ? server_t::MapCmpAscend : server_t::MapCmpDescend );
-		return true;
-	case 4:
-		qsort( servers.Base(), servers.Count(), sizeof( server_t ),
-			ascend ? server_t::ClientCmpAscend : server_t::ClientCmpDescend );
-		return true;
-	case 5:
-		qsort( servers.Base(), servers.Count(), sizeof( server_t ),
-			ascend ? server_t::PingCmpAscend : server_t::PingCmpDescend );
-		return true;
-	}
-
-	return false;
+
+	s_pSortModel = this;
+	qsort( order.Base(), order.Count(), sizeof( int ), RowCmp );
+	s_pSortModel = NULL;
+
+	return true;
 }
 
 /*
@@ -261,28 +405,58 @@ bool CMenuGameListModel::Sort(int column, bool ascend)
 CMenuServerBrowser::GetGamesList
 =================
 */
+// GoldSrc master server region codes
+const char *CMenuGameListModel::RegionName( int region )
+{
+	switch( region )
+	{
+	case -1: return NULL;
+	case 0: return "US East";
+	case 1: return "US West";
+	case 2: return "S. America";
+	case 3: return "Europe";
+	case 4: return "Asia";
+	case 5: return "Australia";
+	case 6: return "Mid. East";
+	case 7: return "Africa";
+	default: return "World";
+	}
+}
+
+// fills columns from the already parsed info string
+void CMenuGameListModel::UpdateServerFields( server_t &server )
+{
+	const CInfoIndex &fields = server.fields;
+	const char *region = fields.ValueForKey( k_region );
+	const char *version = fields.ValueForKey( k_version );
+
+	Q_strncpy( server.name, fields.ValueForKey( k_host ), sizeof( server.name ) );
+	Q_strncpy( server.mapname, fields.ValueForKey( k_map ), sizeof( server.mapname ) );
+	snprintf( server.clientsstr, 64, "%s\\%s", fields.ValueForKey( k_numcl ), fields.ValueForKey( k_maxcl ) );
+	snprintf( server.pingstr, 64, "%.f ms", server.ping * 1000 );
+
+	// xash servers only send the protocol number
+	if( !version[0] )
+		version = fields.ValueForKey( k_protocol );
+	Q_strncpy( server.version, version, sizeof( server.version ) );
+
+	server.numcl = atoi( fields.ValueForKey( k_numcl ));
+	server.bots = atoi( fields.ValueForKey( k_bots ));
+	server.region = region[0] ? atoi( region ) : -1;
+	Q_strncpy( server.botsstr, fields.ValueForKey( k_bots ), sizeof( server.botsstr ) );
+
+	server.havePassword = !stricmp( fields.ValueForKey( k_password ), "1" );
+	server.IsDedicated = !stricmp( fields.ValueForKey( k_dedicated ), "1" ); // added in 0.19.4
+	server.IsSecure = !stricmp( fields.ValueForKey( k_secure ), "1" );
+}
+
 void CMenuGameListModel::Update( void )
 {
 	int		i;
-	const char *info;
-	char passwd[2], dedicated[2];
 
 	// regenerate table data
 	for( i = 0; i < servers.Count(); i++ )
-	{
-		info = servers[i].info;
-
-		Q_strncpy( passwd, Info_ValueForKey( info, "password" ), sizeof( passwd ) );
-		Q_strncpy( dedicated, Info_ValueForKey( info, "dedicated" ), sizeof( dedicated ) ); // added in 0.19.4
-
-		Q_strncpy( servers[i].name, Info_ValueForKey( info, "host" ), sizeof( servers[i].name ) );
-		Q_strncpy( servers[i].mapname, Info_ValueForKey( info, "map" ), sizeof( servers[i].mapname ) );
-		snprintf( servers[i].clientsstr, 64, "%s\\%s", Info_ValueForKey( info, "numcl" ), Info_ValueForKey( info, "maxcl" ) );
-		snprintf( servers[i].pingstr, 64, "%.f ms", servers[i].ping * 1000 );
-
-		servers[i].havePassword = passwd[0] && !stricmp( passwd, "1");
-		servers[i].IsDedicated = dedicated[0] && !stricmp( dedicated, "1");
-	}
+		UpdateServerFields( servers[i] );
 
 	if( servers.Count() )
 	{
@@ -294,9 +468,9 @@ void CMenuGameListModel::Update( void )
 
 void CMenuGameListModel::OnActivateEntry( int line )
 {
-	if( servers.Count() )
+	if( order.Count() )
 	{
-		CMenuServerBrowser::Connect( servers[line] );
+		CMenuServerBrowser::Connect( Server( line ));
 	}
 	else
 	{
@@ -304,42 +478,63 @@ void CMenuGameListModel::OnActivateEntry( int line )
 	}
 }
 
-void CMenuGameListModel::AddServerToList(netadr_t adr, const char *info)
+/*
+=================
+CMenuGameListModel::AddServerToList
+
+Returns the table row of the server, or -1 if nothing has changed.
+oldRow is set to the row it was taken from when a known server is updated
+=================
+*/
+int CMenuGameListModel::AddServerToList(netadr_t adr, const char *info, const CInfoIndex &fields, int *oldRow)
 {
-	int i;
-	char passwd[2], dedicated[2];
+	uint64 key = server_t::AddressKey( adr );
+	int idx = serverIndex.Find( key );
+	int row;
 
-	// ignore if duplicated
-	for( i = 0; i < servers.Count(); i++ )
+	*oldRow = -1;
+
+	if( idx != serverIndex.InvalidIndex() )
 	{
-		if( !stricmp( servers[i].info, info ))
-			return;
-	}
+		server_t &server = servers[serverIndex[idx]];
+
+		// ignore if duplicated
+		if( !stricmp( server.info, info ))
+			return -1;
 
-	server_t server;
+		// same server with new state, keep the first ping and move its row
+		idx = serverIndex[idx];
+		Q_strncpy( server.info, info, sizeof( server.info ));
+		server.fields = fields;
+		UpdateServerFields( server );
+		*oldRow = order.Find( idx );
+		order.Remove( *oldRow );
+	}
+	else
+	{
+		server_t server;
 
-	Q_strncpy( passwd, Info_ValueForKey( info, "password" ), sizeof( passwd ) );
-	Q_strncpy( dedicated, Info_ValueForKey( info, "dedicated" ), sizeof( dedicated ) );
+		server.adr = adr;
+		server.ping = Sys_DoubleTime() - serversRefreshTime;
+		server.ping = bound( 0, server.ping, 9.999 );
+		Q_strncpy( server.info, info, sizeof( server.info ));
+		server.fields = fields;
+		UpdateServerFields( server );
 
-	server.adr = adr;
-	server.ping = Sys_DoubleTime() - serversRefreshTime;
-	server.ping = bound( 0, server.ping, 9.999 );
-	Q_strncpy( server.info, info, sizeof( server.info ));
-	Q_strncpy( server.name, Info_ValueForKey( info, "host" ), sizeof( server.name ) );
-	Q_strncpy( server.mapname, Info_ValueForKey( info, "map" ), sizeof( server.mapname ) );
-	snprintf( server.clientsstr, 64, "%s\\%s", Info_ValueForKey( info, "numcl" ), Info_ValueForKey( info, "maxcl" ) );
+		uiServerBrowser.iServerCount++;
+		snprintf( uiServerBrowser.szServer, sizeof( uiServerBrowser.szServer ), "%s (%d)", L( "Name" ), uiServerBrowser.iServerCount );
 
-	server.havePassword = passwd[0] && !stricmp( passwd, "1" );
-	server.IsDedicated = dedicated[0] && !stricmp( dedicated, "1" );
+		idx = servers.AddToTail( server );
+		serverIndex.Insert( key, idx );
+	}
 
-	snprintf( server.pingstr, 64, "%.f ms", server.ping * 1000 );
+	if( m_iSortingColumn != -1 && GetSortFunc() )
+		row = FindSortedRow( idx );
+	else row = order.Count();
 
-	uiServerBrowser.iServerCount++;
-	snprintf( uiServerBrowser.szServer, sizeof( uiServerBrowser.szServer ), "%s (%d)", L( "Name" ), uiServerBrowser.iServerCount );
-	servers.AddToTail( server );
+	order.InsertBefore( row, idx );
 
-	if( m_iSortingColumn != -1 )
-		Sort( m_iSortingColumn, m_bAscend );
+	return row;
 }
 
 void CMenuServerBrowser::Connect( server_t &server )
@@ -486,8 +681,12 @@ void CMenuServerBrowser::_Init( void )
 	gameList.SetupColumn( 1, NULL, 24.0f, true ); // havepassword
 	gameList.SetupColumn( 2, szServer, 0.40f );
 	gameList.SetupColumn( 3, L( "GameUI_Map" ), 0.25f );
-	gameList.SetupColumn( 4, L( "Players" ), 100.0f, true );
-	gameList.SetupColumn( 5, L( "Ping" ), 120.0f, true );
+	gameList.SetupColumn( 4, L( "Players" ), 80.0f, true );
+	gameList.SetupColumn( 5, L( "Ping" ), 80.0f, true );
+	gameList.SetupColumn( 6, L( "Bots" ), 50.0f, true );
+	gameList.SetupColumn( 7, "VAC", 50.0f, true );
+	gameList.SetupColumn( 8, L( "Version" ), 70.0f, true );
+	gameList.SetupColumn( 9, L( "Region" ), 90.0f, true );
 	gameList.SetModel( &gameListModel );
 	gameList.bFramedHintText = true;
 	gameList.bAllowSorting = true;
@@ -588,8 +787,7 @@ void CMenuServerBrowser::Show()
 
 void CMenuServerBrowser::AddServerToList(netadr_t adr, const char *info)
 {
-	if( stricmp( gMenu.m_gameinfo.gamefolder, Info_ValueForKey( info, "gamedir" )) != 0 )
-		return;
+	CInfoIndex fields;
 
 	if( !WasInit() )
 		return;
@@ -597,7 +795,32 @@ void CMenuServerBrowser::AddServerToList(netadr_t adr, const char *info)
 	if( !IsVisible() )
 		return;
 
-	gameListModel.AddServerToList( adr, info );
+	fields.Parse( info );
+
+	if( stricmp( gMenu.m_gameinfo.gamefolder, fields.ValueForKey( k_gamedir )) != 0 )
+		return;
+
+	int cur = gameList.GetCurrentIndex();
+	bool empty = !gameListModel.GetRows();
+	int oldRow;
+	int row = gameListModel.AddServerToList( adr, info, fields, &oldRow );
+
+	// keep the selection on the same server when rows move around it
+	if( row != -1 && !empty )
+	{
+		if( oldRow == cur )
+			cur = row;
+		else
+		{
+			if( oldRow != -1 && oldRow < cur )
+				cur--;
+			if( row <= cur )
+				cur++;
+		}
+
+		if( cur != gameList.GetCurrentIndex() )
+			gameList.SetCurrentIndex( cur );
+	}
 
 	joinGame->SetGrayed( false );
 }
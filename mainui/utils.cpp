@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Utils.h"
 #include "keydefs.h"
 #include "BtnsBMPTable.h"
+#include "utlhashmap.h"
 
 #ifdef _DEBUG
 void DBG_AssertFunction( bool fExpr, const char* szExpr, const char* szFile, int szLine, const char* szMessage )
@@ -293,6 +294,110 @@ const char *Info_ValueForKey( const char *s, const char *key )
 }
 
 
+static CUtlHashMap<const char *, const char *> &Info_InternTable( void )
+{
+	// function scope, keys get interned from static initializers
+	static CUtlHashMap<const char *, const char *> table;
+
+	return table;
+}
+
+/*
+===============
+Info_InternKey
+===============
+*/
+const char *Info_InternKey( const char *key )
+{
+	CUtlHashMap<const char *, const char *> &table = Info_InternTable();
+	int i = table.Find( key );
+
+	if( i != table.InvalidIndex() )
+		return table[i];
+
+	char *copy = StringCopy( key );
+	table.Insert( copy, copy );
+
+	return copy;
+}
+
+/*
+===============
+CInfoIndex::Parse
+
+Same tokenizing rules as Info_ValueForKey, the first of duplicated keys wins
+===============
+*/
+void CInfoIndex::Parse( const char *s )
+{
+	CUtlHashMap<const char *, const char *> &table = Info_InternTable();
+	char pkey[MAX_INFO_STRING];
+	int out = 0;
+
+	m_iNumKeys = 0;
+
+	if( *s == '\\' ) s++;
+
+	while( *s )
+	{
+		char *o = pkey;
+		int start = out;
+
+		while( *s != '\\' && *s != '\n' )
+		{
+			if( !*s ) return;
+			if( o < pkey + sizeof( pkey ) - 1 )
+				*o++ = *s;
+			s++;
+		}
+
+		*o = 0;
+		s++;
+
+		while( *s != '\\' && *s != '\n' && *s )
+		{
+			if( out < (int)sizeof( m_szValues ) - 1 )
+				m_szValues[out++] = *s;
+			s++;
+		}
+
+		m_szValues[out++] = 0;
+
+		int i = table.Find( pkey );
+
+		if( i == table.InvalidIndex() || m_iNumKeys >= MAX_INFO_INDEX_KEYS || FindKey( table[i] ) != -1 )
+			out = start; // not asked for, duplicated or no room
+		else
+		{
+			m_pKeys[m_iNumKeys] = table[i];
+			m_iOffsets[m_iNumKeys] = start;
+			m_iNumKeys++;
+		}
+
+		if( !*s || out >= (int)sizeof( m_szValues ) - 1 )
+			return;
+		s++;
+	}
+}
+
+int CInfoIndex::FindKey( const char *internedKey ) const
+{
+	for( int i = 0; i < m_iNumKeys; i++ )
+	{
+		if( m_pKeys[i] == internedKey )
+			return i;
+	}
+
+	return -1;
+}
+
+const char *CInfoIndex::ValueForKey( const char *internedKey ) const
+{
+	int i = FindKey( internedKey );
+
+	return i != -1 ? m_szValues + m_iOffsets[i] : "";
+}
+
 /* 
 ===================
 Key_GetKey
@@ -152,12 +152,39 @@ extern const unsigned int g_iColorTable[8];
 extern void COM_FileBase( const char *in, char *out );		// ripped out from hlsdk 2.3
 extern int UI_FadeAlpha( int starttime, int endtime );
 extern const char *Info_ValueForKey( const char *s, const char *key );
+extern const char *Info_InternKey( const char *key );	// returns shared copy of key, for CInfoIndex lookups
 extern int KEY_GetKey( const char *binding );			// ripped out from engine
 extern char *StringCopy( const char *input );			// copy string into new memory
 extern int COM_CompareSaves( const void **a, const void **b );
 extern void Com_EscapeCommand( char *newCommand, const char *oldCommand, int len );
 extern void UI_EnableTextInput( bool enable );
 
+/*
+ * CInfoIndex
+ *
+ * Info string split into key/value pairs in one pass. Only keys which were
+ * passed through Info_InternKey before parsing are indexed, lookups then
+ * compare interned pointers instead of strings.
+ */
+#define MAX_INFO_INDEX_KEYS	24
+
+class CInfoIndex
+{
+public:
+	CInfoIndex() : m_iNumKeys( 0 ) { m_szValues[0] = 0; }
+
+	void Parse( const char *s );
+	const char *ValueForKey( const char *internedKey ) const;
+
+private:
+	int FindKey( const char *internedKey ) const;
+
+	const char *m_pKeys[MAX_INFO_INDEX_KEYS];
+	unsigned char m_iOffsets[MAX_INFO_INDEX_KEYS];	// into m_szValues
+	int m_iNumKeys;
+	char m_szValues[MAX_INFO_STRING];
+};
+
 void UI_LoadCustomStrings( void );
 const char *L( const char *szStr ); // L means Localize!
 void UI_FreeCustomStrings( void );
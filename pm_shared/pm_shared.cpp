@@ -49,6 +49,10 @@ int pm_gcTextures = 0;
 char pm_grgszTextureName[1024][17];
 char pm_grgchTextureType[1024];
 
+// open addressing over pm_grgszTextureName, keeps the table at most half full
+#define CTEXTUREHASHSIZE	(CTEXTURESMAX * 2)	// must be power of two
+short pm_grgiTextureHash[CTEXTUREHASHSIZE];		// texture index + 1, 0 is an empty slot
+
 playermove_t *pmove = NULL;
 int g_onladder = 0;
 
@@ -82,21 +86,68 @@ int PM_IsThereGrassTexture()
 	return 0;
 }
 
+int PM_CompareTextures(const void *a, const void *b)
+{
+	return stricmp(pm_grgszTextureName[*(const short *)a], pm_grgszTextureName[*(const short *)b]);
+}
+
 void PM_SortTextures()
 {
-	// Bubble sort, yuck, but this only occurs at startup and it's only 512 elements...
-	int i, j;
+	static char szNames[CTEXTURESMAX][CBTEXTURENAMEMAX];
+	static char chTypes[CTEXTURESMAX];
+	short order[CTEXTURESMAX];
+	int i;
+
+	for (i = 0; i < pm_gcTextures; ++i)
+		order[i] = i;
+
+	qsort(order, pm_gcTextures, sizeof(order[0]), PM_CompareTextures);
+
+	memcpy(szNames, pm_grgszTextureName, sizeof(szNames));
+	memcpy(chTypes, pm_grgchTextureType, sizeof(chTypes));
+
+	for (i = 0; i < pm_gcTextures; ++i)
+	{
+		strcpy(pm_grgszTextureName[i], szNames[order[i]]);
+		pm_grgchTextureType[i] = chTypes[order[i]];
+	}
+}
+
+unsigned int PM_HashTextureName(const char *name)
+{
+	// case insensitive FNV-1a over the part of the name materials.txt keeps
+	unsigned int hash = 2166136261u;
+
+	for (int i = 0; i < CBTEXTURENAMEMAX - 1 && name[i]; ++i)
+	{
+		hash ^= (unsigned char)tolower(name[i]);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+void PM_BuildTextureHash()
+{
+	int i, slot;
+
+	memset(pm_grgiTextureHash, 0, sizeof(pm_grgiTextureHash));
 
 	for (i = 0; i < pm_gcTextures; ++i)
 	{
-		for (j = i + 1; j < pm_gcTextures; j++)
+		slot = PM_HashTextureName(pm_grgszTextureName[i]) & (CTEXTUREHASHSIZE - 1);
+
+		while (pm_grgiTextureHash[slot])
 		{
-			if (stricmp(pm_grgszTextureName[i], pm_grgszTextureName[j]) > 0)
-			{
-				// Swap
-				PM_SwapTextures(i, j);
-			}
+			// duplicate line in materials.txt, first one wins
+			if (!strnicmp(pm_grgszTextureName[i], pm_grgszTextureName[pm_grgiTextureHash[slot] - 1], CBTEXTURENAMEMAX - 1))
+				break;
+
+			slot = (slot + 1) & (CTEXTUREHASHSIZE - 1);
 		}
+
+		if (!pm_grgiTextureHash[slot])
+			pm_grgiTextureHash[slot] = i + 1;
 	}
 }
 
@@ -118,13 +169,12 @@ void PM_InitTextureTypes()
 	memset(buffer, 0, sizeof(buffer));
 
 	fileSize = pmove->COM_FileSize((char*)"sound/materials.txt");
-	pMemFile = pmove->COM_LoadFile((char*)"sound/materials.txt", 5, NULL);
+	pMemFile = pmove->COM_LoadFile((char*)"sound/materials.txt", 5, &fileSize);
 
 	if (!pMemFile)
 		return;
 
 	filePos = 0;
-	fileSize = 0;
 
 	// for each line in the file...
 	while (pmove->memfgets(pMemFile, fileSize, &filePos, buffer, sizeof(buffer) - 1) != NULL && (pm_gcTextures < CTEXTURESMAX))
@@ -170,37 +220,24 @@ void PM_InitTextureTypes()
 	pmove->COM_FreeFile(pMemFile);
 
 	PM_SortTextures();
+	PM_BuildTextureHash();
 	bTextureTypeInit = true;
 }
 
 char PM_FindTextureType(char *name)
 {
-	int left, right, pivot;
-	int val;
+	int slot, index;
 
 	assert(pm_shared_initialized);
 
-	left = 0;
-	right = pm_gcTextures - 1;
+	slot = PM_HashTextureName(name) & (CTEXTUREHASHSIZE - 1);
 
-	while (left <= right)
+	while ((index = pm_grgiTextureHash[slot]) != 0)
 	{
-		pivot = (left + right) / 2;
-
-		val = strnicmp(name, pm_grgszTextureName[pivot], CBTEXTURENAMEMAX - 1);
+		if (!strnicmp(name, pm_grgszTextureName[index - 1], CBTEXTURENAMEMAX - 1))
+			return pm_grgchTextureType[index - 1];
 
-		if (val == 0)
-		{
-			return pm_grgchTextureType[pivot];
-		}
-		else if (val > 0)
-		{
-			left = pivot + 1;
-		}
-		else if (val < 0)
-		{
-			right = pivot - 1;
-		}
+		slot = (slot + 1) & (CTEXTUREHASHSIZE - 1);
 	}
 
 	return CHAR_TEX_CONCRETE;
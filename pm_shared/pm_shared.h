@@ -85,6 +85,8 @@
 void PM_SwapTextures(int i, int j);
 int PM_IsThereGrassTexture();
 void PM_SortTextures();
+unsigned int PM_HashTextureName(const char *name);
+void PM_BuildTextureHash();
 void PM_InitTextureTypes();
 char PM_FindTextureType(char *name);
 void PM_PlayStepSound(int step, float fvol);